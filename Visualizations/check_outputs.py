@@ -1,28 +1,56 @@
+import os
+
 import numpy as np
 from matplotlib import pyplot as plt
 
-arr_with_sine = np.zeros(1024)
-arr_with_fft_calc = np.zeros(1024)
+BUILD_DIR = "../cmake-build-debug"
+
+# mirrors AnalysisFileHeader in inc/SpctAnalysisFile.h (version 1, native byte order)
+ANALYSIS_HEADER = np.dtype([("magic", "S8"), ("version", "<u4"), ("header_size", "<u4"), ("byte_order_tag", "<u4"),
+                            ("bin_fraction_bits", "<u4"), ("fft_size", "<u4"), ("hop_size", "<u4"),
+                            ("max_entries", "<u4"), ("first_frame_end", "<u4"), ("sampling_freq", "<f8"),
+                            ("num_frames", "<u8"), ("num_peaks", "<u8"), ("frame_table_offset", "<u8")])
+PACKED_PEAK = np.dtype([("bin_high", "<u2"), ("bin_low", "<u2"), ("magnitude", "<f2")])
+
+
+def read_samples(file_name):
+    """The sample dumps are raw doubles, mapped instead of parsed."""
+    return np.memmap(file_name, dtype="<f8", mode="r")
+
+
+def read_analysis(file_name):
+    """Returns the header and a function that decodes the (bins, magnitudes) of a frame."""
+    header = np.memmap(file_name, dtype=ANALYSIS_HEADER, mode="r", shape=(1,))[0]
+    assert header["magic"] == b"SPCTANLY" and header["version"] == 1
+    peaks = np.memmap(file_name, dtype=PACKED_PEAK, mode="r", offset=ANALYSIS_HEADER.itemsize,
+                      shape=(int(header["num_peaks"]),))
+    frame_table = np.memmap(file_name, dtype="<u8", mode="r", offset=int(header["frame_table_offset"]),
+                            shape=(int(header["num_frames"]) + 1,))
+
+    def frame(index):
+        stored = peaks[frame_table[index]:frame_table[index + 1]]
+        fixed_point_bins = (stored["bin_high"].astype(np.uint32) << 16) | stored["bin_low"]
+        bins = fixed_point_bins / float(1 << int(header["bin_fraction_bits"]))
+        return bins, stored["magnitude"].astype(np.float64) * header["fft_size"] / 2
 
-def fill_array_with_read_vals(array_to_fill, text_file):
-    with open(text_file) as f:
-        text_output = f.readlines()
-        print(text_output[300])
-        for index, value in enumerate(text_output):
-            value = value.strip('\n')
-            array_to_fill[index] = float(value)
+    return header, frame
 
 
-fill_array_with_read_vals(arr_with_sine, "../cmake-build-debug/raw_sine_values.txt")
-fill_array_with_read_vals(arr_with_fft_calc, "../cmake-build-debug/resynthesized_values.txt")
+arr_with_sine = read_samples(os.path.join(BUILD_DIR, "raw_sine_values.f64"))
+arr_with_fft_calc = read_samples(os.path.join(BUILD_DIR, "resynthesized_values.f64"))
 
 # arr_with_fft_calc = - 20 * np.log10(arr_with_fft_calc)
-x_axis = np.arange(0, 1024, 1)
+x_axis = np.arange(0, arr_with_sine.size, 1)
 
 lib_algo_fft = np.fft.fft(arr_with_sine)
 lib_algo_fft = np.abs(lib_algo_fft)
 
-fig,ax = plt.subplots(2)
+fig, ax = plt.subplots(3)
 ax[0].plot(x_axis, arr_with_sine)
 ax[1].plot(x_axis, arr_with_fft_calc)
+analysis_header, analysis_frame = read_analysis(os.path.join(BUILD_DIR, "analysed_frames.spct"))
+if analysis_header["num_frames"] > 0:
+    frame_bins, frame_magnitudes = analysis_frame(0)
+    ax[2].stem(frame_bins, frame_magnitudes)
+    ax[2].plot(np.arange(lib_algo_fft.size // 2), lib_algo_fft[:lib_algo_fft.size // 2], alpha=0.4)
 plt.show()
@@ -0,0 +1,438 @@
+/**
+ * Author: Lucas Scheidt
+ * Date: 14.10.26
+ *
+ * Description: Microbenchmarks of the processing stages for every FFT size (16 .. 2048) in float and double. Kept
+ * apart from spectral_main so the asserts of the tests don't end up in the numbers. Every benchmark is measured twice:
+ * batched (as many calls as needed to last 50us, the median of the batch means is the typical cost per call) and call
+ * by call (every call timed on its own, the p99 and the maximum show the spikes a batch averages away). The single
+ * call numbers include one read of the clock, its cost is printed once at the start.
+ *
+ * Usage: spectral_bench [filter], only the benchmarks whose name contains the filter are run.
+ */
+
+#include "SpctBufferManager.h"
+#include "SpctDomainSpecific.h"
+#include "SpctExponentLUT.h"
+#include "SpctIfftResynth.h"
+#include "SpctOfflineRenderer.h"
+#include "SpctOscillators.h"
+#include "SpctProcessingFunctions.h"
+#include "SpctSimd.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace LBTS::Spectral;
+
+namespace
+{
+using BenchClock = std::chrono::steady_clock;
+
+/// @brief Keeps the compiler from dropping a result that is never read.
+template <typename T>
+void keep_alive(const T& value) noexcept
+{
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    // no inline assembly (MSVC), a volatile read of the value can't be dropped either.
+    static volatile unsigned char sink;
+    sink = *reinterpret_cast<const volatile unsigned char*>(&value);
+#endif
+}
+
+struct BenchmarkResult
+{
+    // median of the means of the batches
+    double m_batch_median_ns;
+    // distribution of the single calls
+    double m_call_median_ns;
+    double m_call_p99_ns;
+    double m_call_max_ns;
+};
+
+/// @brief Value below which the given fraction of the sorted values lies.
+double percentile(const std::vector<double>& sorted_values, const double fraction)
+{
+    const auto index = static_cast<size_t>(std::ceil(fraction * static_cast<double>(sorted_values.size())));
+    return sorted_values[std::max<size_t>(index, 1) - 1];
+}
+
+/// @brief Cost of one read of the clock (the smallest single call measurement possible).
+double clock_overhead_ns()
+{
+    std::vector<double> reads(10001);
+    for (auto& value : reads)
+    {
+        const auto start = BenchClock::now();
+        value = std::chrono::duration<double, std::nano>(BenchClock::now() - start).count();
+    }
+    std::ranges::sort(reads);
+    return percentile(reads, 0.5);
+}
+
+/// @brief Time a callable. A batch covers as many calls as needed to last at least min_measurement (the clock
+/// resolution would dominate the small sizes otherwise), the calibration doubles as warmup. The single calls are
+/// timed afterwards, one after the other.
+template <typename FN>
+BenchmarkResult measure(FN&& function)
+{
+    constexpr auto min_measurement = std::chrono::microseconds{50};
+    constexpr size_t num_warmup_measurements = 20;
+    constexpr size_t num_measurements = 201;
+    constexpr size_t num_single_calls = 2001;
+    const auto time_calls = [&function](const size_t num_calls)
+    {
+        const auto start = BenchClock::now();
+        for (size_t call = 0; call < num_calls; ++call)
+        {
+            function();
+        }
+        return BenchClock::now() - start;
+    };
+    size_t calls_per_measurement = 1;
+    while (time_calls(calls_per_measurement) < min_measurement)
+    {
+        calls_per_measurement <<= 1;
+    }
+    for (size_t measurement = 0; measurement < num_warmup_measurements; ++measurement)
+    {
+        time_calls(calls_per_measurement);
+    }
+    std::vector<double> ns_per_call(num_measurements);
+    for (auto& value : ns_per_call)
+    {
+        value = std::chrono::duration<double, std::nano>(time_calls(calls_per_measurement)).count() /
+                static_cast<double>(calls_per_measurement);
+    }
+    std::ranges::sort(ns_per_call);
+    std::vector<double> ns_single_call(num_single_calls);
+    for (auto& value : ns_single_call)
+    {
+        value = std::chrono::duration<double, std::nano>(time_calls(1)).count();
+    }
+    std::ranges::sort(ns_single_call);
+    return {percentile(ns_per_call, 0.5),
+            percentile(ns_single_call, 0.5),
+            percentile(ns_single_call, 0.99),
+            ns_single_call.back()};
+}
+
+/// @brief Runs and prints one benchmark if it passes the filter.
+class BenchmarkReporter
+{
+  public:
+    explicit BenchmarkReporter(const std::string_view filter) : m_filter{filter}
+    {
+        std::cout << "clock read: " << std::fixed << std::setprecision(1) << clock_overhead_ns()
+                  << " ns (included in the call columns)" << std::endl;
+        std::cout << std::left << std::setw(30) << "benchmark" << std::setw(8) << "type" << std::right
+                  << std::setw(6) << "N" << std::setw(18) << "batch mean [ns]" << std::setw(16) << "call p50 [ns]"
+                  << std::setw(16) << "call p99 [ns]" << std::setw(16) << "call max [ns]" << std::setw(16)
+                  << "MSamples/s" << std::endl;
+    }
+
+    /// @param samples_per_call: Number of samples one call processes (throughput is based on the batch mean).
+    template <FloatingPt T, typename FN>
+    void run(const std::string_view name, const size_t num_samples, const size_t samples_per_call, FN&& function)
+    {
+        if (name.find(m_filter) == std::string_view::npos)
+        {
+            return;
+        }
+        const auto result = measure(std::forward<FN>(function));
+        std::cout << std::left << std::setw(30) << name << std::setw(8)
+                  << (std::is_same_v<T, float> ? "float" : "double") << std::right << std::setw(6) << num_samples
+                  << std::fixed << std::setprecision(1) << std::setw(18) << result.m_batch_median_ns << std::setw(16)
+                  << result.m_call_median_ns << std::setw(16) << result.m_call_p99_ns << std::setw(16)
+                  << result.m_call_max_ns << std::setprecision(2) << std::setw(16)
+                  << static_cast<double>(samples_per_call) * 1e3 / result.m_batch_median_ns << std::endl;
+    }
+
+  private:
+    std::string_view m_filter;
+};
+
+/// @brief The same noise in every run (fixed seed), so two runs measure the same work.
+template <FloatingPt T>
+T next_noise_sample(std::mt19937& generator)
+{
+    return std::uniform_real_distribution<T>{static_cast<T>(-1), static_cast<T>(1)}(generator);
+}
+
+template <FloatingPt T, size_t DEG_TWO>
+void bench_fourier_transforms(BenchmarkReporter& reporter)
+{
+    constexpr auto num_samples = pow_two_value_of_degree(DEG_TWO);
+    std::mt19937 generator{42};
+    ComplexArr<T, num_samples> input{};
+    for (auto& value : input)
+    {
+        value = {next_noise_sample<T>(generator), next_noise_sample<T>(generator)};
+    }
+    // the transformations work in place, every call starts from the same input again (the copy is part of the
+    // numbers, it is small compared to the transformation).
+    auto samples = std::make_unique<ComplexArr<T, num_samples>>();
+    const ExponentLUT<T> exponent_lut{};
+    reporter.run<T>("spct_fourier_transform",
+                    num_samples,
+                    num_samples,
+                    [&]
+                    {
+                        *samples = input;
+                        spct_fourier_transform<T, DEG_TWO>(*samples, exponent_lut);
+                        keep_alive((*samples)[1]);
+                    });
+    const auto radix_four_lut = std::make_unique<const RadixFourLUT<T, DEG_TWO>>();
+    reporter.run<T>("fourier_transform_radix_four",
+                    num_samples,
+                    num_samples,
+                    [&]
+                    {
+                        *samples = input;
+                        spct_fourier_transform_radix_four<T, DEG_TWO>(*samples, *radix_four_lut);
+                        keep_alive((*samples)[1]);
+                    });
+    const auto soa_lut = std::make_unique<const SoaRadixFourLUT<T, DEG_TWO>>();
+    auto split_samples = std::make_unique<SplitComplexArr<T, num_samples>>();
+    reporter.run<T>("fourier_transform_simd",
+                    num_samples,
+                    num_samples,
+                    [&]
+                    {
+                        *samples = input;
+                        spct_fourier_transform_simd<T, DEG_TWO>(*samples, *split_samples, *soa_lut);
+                        keep_alive((*samples)[1]);
+                    });
+
+    // the real input FFT of the same number of (real) samples
+    std::array<T, num_samples> real_input{};
+    for (auto& value : real_input)
+    {
+        value = next_noise_sample<T>(generator);
+    }
+    const auto real_fourier_lut = std::make_unique<const RealFourierLUT<T, DEG_TWO>>();
+    auto spectrum = std::make_unique<ComplexArr<T, (num_samples >> 1)>>();
+    auto split_spectrum = std::make_unique<SplitComplexArr<T, (num_samples >> 1)>>();
+    reporter.run<T>("real_fourier_transform",
+                    num_samples,
+                    num_samples,
+                    [&]
+                    {
+                        pack_real_samples<T, DEG_TWO>(real_input, *spectrum);
+                        spct_real_fourier_transform<T, DEG_TWO>(*spectrum, *split_spectrum, *real_fourier_lut);
+                        keep_alive((*spectrum)[1]);
+                    });
+
+    // peak picking on the spectrum of the real input
+    pack_real_samples<T, DEG_TWO>(real_input, *spectrum);
+    spct_real_fourier_transform<T, DEG_TWO>(*spectrum, *split_spectrum, *real_fourier_lut);
+    auto peaks = std::make_unique<PeakArr<T, max_partials>>();
+    reporter.run<T>("calculate_max_map",
+                    num_samples,
+                    num_samples,
+                    [&]
+                    {
+                        keep_alive(calculate_max_map<T, num_samples>(
+                            *spectrum, *peaks, static_cast<T>(0), max_oscillators));
+                    });
+    reporter.run<T>("calculate_peak_map",
+                    num_samples,
+                    num_samples,
+                    [&]
+                    {
+                        keep_alive(calculate_peak_map<T, num_samples>(
+                            *spectrum, *peaks, static_cast<T>(0), max_oscillators));
+                    });
+}
+
+template <FloatingPt T, size_t DEG_TWO>
+void bench_resynthesis(BenchmarkReporter& reporter)
+{
+    constexpr auto num_samples = pow_two_value_of_degree(DEG_TWO);
+    constexpr size_t block_size = 512;
+    // the oscillators play the peaks of a noise frame of the given size
+    std::mt19937 generator{7};
+    std::array<T, num_samples> real_input{};
+    for (auto& value : real_input)
+    {
+        value = next_noise_sample<T>(generator);
+    }
+    const auto real_fourier_lut = std::make_unique<const RealFourierLUT<T, DEG_TWO>>();
+    auto spectrum = std::make_unique<ComplexArr<T, (num_samples >> 1)>>();
+    spct_real_fourier_transform<T, DEG_TWO>(real_input, *spectrum, *real_fourier_lut);
+    auto peaks = std::make_unique<PeakArr<T, max_partials>>();
+    const size_t valid_entries =
+        calculate_peak_map<T, num_samples>(*spectrum, *peaks, static_cast<T>(0), max_oscillators);
+
+    auto oscillators = std::make_unique<ResynthOscs<T, BoundedPowTwo_v<size_t, 512>, num_samples>>(44100.0);
+    oscillators->tune_oscillators(*peaks, valid_entries);
+    reporter.run<T>("ResynthOscs::receive_output",
+                    num_samples,
+                    block_size,
+                    [&]
+                    {
+                        T sum = 0;
+                        for (size_t sample = 0; sample < block_size; ++sample)
+                        {
+                            sum += oscillators->receive_output();
+                        }
+                        keep_alive(sum);
+                    });
+    std::array<T, block_size> block{};
+    reporter.run<T>("ResynthOscs::process",
+                    num_samples,
+                    block_size,
+                    [&]
+                    {
+                        oscillators->process(block.data(), block.size());
+                        keep_alive(block[0]);
+                    });
+
+    // the whole chain with a typical host block, the input is renewed every call (the output overwrites it).
+    std::vector<T> noise(16 * block_size);
+    for (auto& value : noise)
+    {
+        value = next_noise_sample<T>(generator);
+    }
+    auto buffer_manager = std::make_unique<BufferManager<T, num_samples>>(44100.0);
+    size_t noise_offset = 0;
+    reporter.run<T>("process_daw_chunk",
+                    num_samples,
+                    block_size,
+                    [&]
+                    {
+                        std::copy_n(noise.begin() + static_cast<std::ptrdiff_t>(noise_offset), block_size, block.begin());
+                        noise_offset = (noise_offset + block_size) % noise.size();
+                        buffer_manager->process_daw_chunk(block.data(), block.size());
+                        keep_alive(block[0]);
+                    });
+}
+
+/// @brief Oscillator bank against inverse FFT, one retune and one hop (a quarter of N) per call, for a growing number
+/// of partials (the crossover is documented in SpctIfftResynth.h).
+template <FloatingPt T, size_t FFT_SIZE>
+void bench_resynthesis_engines(BenchmarkReporter& reporter)
+{
+    constexpr size_t fft_size = FFT_SIZE;
+    constexpr size_t hop_size = fft_size >> 2;
+    constexpr size_t capacity = fft_size >> 1;
+    auto peaks = std::make_unique<PeakArr<T, capacity>>();
+    for (size_t peak = 0; peak < capacity; ++peak)
+    {
+        peaks->set(peak, static_cast<T>(2 + 0.97 * static_cast<double>(peak)), static_cast<T>(10));
+    }
+    auto oscillators = std::make_unique<ResynthOscs<T, BoundedPowTwo_v<size_t, 512>, fft_size, capacity>>(44100.0);
+    auto ifft_resynth = std::make_unique<IfftResynth<T, fft_size, capacity>>(44100.0);
+    ifft_resynth->set_hop_size(hop_size);
+    std::array<T, hop_size> block{};
+    for (const size_t num_partials : {1, 4, 8, 16, 32, 64, 128, 256, 512})
+    {
+        if (num_partials > capacity)
+        {
+            break;
+        }
+        oscillators->set_partial_count(num_partials);
+        ifft_resynth->set_partial_count(num_partials);
+        const std::string suffix = "/" + std::to_string(num_partials) + " partials";
+        reporter.run<T>("oscillator bank" + suffix,
+                        fft_size,
+                        hop_size,
+                        [&]
+                        {
+                            oscillators->tune_oscillators(*peaks, num_partials);
+                            oscillators->process(block.data(), block.size());
+                            keep_alive(block[0]);
+                        });
+        reporter.run<T>("inverse FFT" + suffix,
+                        fft_size,
+                        hop_size,
+                        [&]
+                        {
+                            ifft_resynth->tune_oscillators(*peaks, num_partials);
+                            ifft_resynth->process(block.data(), block.size());
+                            keep_alive(block[0]);
+                        });
+    }
+}
+
+/// @brief A whole buffer streamed through process_daw_chunk against the offline render with one and with all cores.
+template <FloatingPt T, size_t FFT_SIZE>
+void bench_offline_render(BenchmarkReporter& reporter)
+{
+    constexpr size_t num_samples = 16384;
+    std::mt19937 generator{42};
+    std::vector<T> noise(num_samples);
+    for (auto& value : noise)
+    {
+        value = next_noise_sample<T>(generator);
+    }
+    auto buffer_manager = std::make_unique<BufferManager<T, FFT_SIZE>>(44100.0);
+    buffer_manager->select_hop_size(HopSize::QUARTER);
+    std::vector<T> samples(num_samples);
+    reporter.run<T>("process_daw_chunk/whole",
+                    FFT_SIZE,
+                    num_samples,
+                    [&]
+                    {
+                        std::ranges::copy(noise, samples.begin());
+                        buffer_manager->process_daw_chunk(samples.data(), samples.size());
+                        keep_alive(samples[0]);
+                    });
+    std::vector<size_t> thread_counts{1};
+    if (const size_t num_cores = std::thread::hardware_concurrency(); num_cores > 1)
+    {
+        thread_counts.push_back(num_cores);
+    }
+    for (const size_t num_threads : thread_counts)
+    {
+        OfflineRenderer<T, FFT_SIZE> renderer{num_threads};
+        reporter.run<T>("offline render/" + std::to_string(num_threads) + " threads",
+                        FFT_SIZE,
+                        num_samples,
+                        [&]
+                        {
+                            std::ranges::copy(noise, samples.begin());
+                            renderer.render(*buffer_manager, samples.data(), samples.size());
+                            keep_alive(samples[0]);
+                        });
+    }
+}
+
+template <FloatingPt T, size_t... DEGREES>
+void bench_all_sizes(BenchmarkReporter& reporter, std::index_sequence<DEGREES...>)
+{
+    (bench_fourier_transforms<T, 4 + DEGREES>(reporter), ...);
+    (bench_resynthesis<T, 4 + DEGREES>(reporter), ...);
+}
+} // namespace
+
+int main(const int argc, const char* const* argv)
+{
+    const std::string_view filter = argc > 1 ? argv[1] : "";
+    std::cout << "SIMD instruction set: " << simd_instruction_set << ", register width (float): " << SimdVec<float>::width
+              << std::endl;
+    BenchmarkReporter reporter{filter};
+    // 16 .. 2048
+    constexpr auto sizes = std::make_index_sequence<max_pow_two_degree - 3>{};
+    bench_all_sizes<float>(reporter, sizes);
+    bench_all_sizes<double>(reporter, sizes);
+    bench_resynthesis_engines<float, 256>(reporter);
+    bench_resynthesis_engines<float, 1024>(reporter);
+    bench_resynthesis_engines<double, 256>(reporter);
+    bench_resynthesis_engines<double, 1024>(reporter);
+    bench_offline_render<float, 1024>(reporter);
+    bench_offline_render<double, 1024>(reporter);
+    return 0;
+}
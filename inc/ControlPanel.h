@@ -0,0 +1,158 @@
+/**
+ * Author: Lucas Scheidt
+ * Date: 14.10.26
+ *
+ * Description: The control panel is the only way in which the control (UI / automation) thread changes parameters of
+ * the audio processing. Every change is queued and applied by the audio thread at the start of the next block, so no
+ * parameter is ever changed in the middle of a block or read half written.
+ */
+
+#pragma once
+#include "SpctBufferManager.h"
+#include "SpctDomainSpecific.h"
+#include "SpctSpscQueue.h"
+
+namespace LBTS::Spectral
+{
+/// @brief Parameters that can be changed from the control thread.
+enum class ParameterId : uint8_t
+{
+    THRESHOLD,
+    WAVEFORM,
+    FFT_SIZE,
+    PARTIAL_COUNT,
+    HOP_SIZE,
+    ANALYSIS_WINDOW,
+    INTERPOLATION
+};
+
+/// @brief Payload of a queued change, the id tells which member is valid: the threshold is a real number, sizes and
+/// enums are integers (no round trip through floating point).
+union ParameterValue
+{
+    double m_real;
+    uint64_t m_integer;
+};
+
+/// @brief One queued change.
+struct ParameterUpdate
+{
+    ParameterId m_id;
+    ParameterValue m_value;
+};
+
+/// @brief Passes the parameter changes of the control thread to a BufferManager running on the audio thread.
+/// @tparam T: Type of the samples.
+/// @tparam BUFFER_SIZE: Maximum FFT size of the BufferManager.
+/// @tparam QUEUE_SIZE: Number of changes that can be pending, changes that don't fit get rejected.
+///
+/// @note
+/// The select_ / set_ functions are meant for exactly one control thread, process_daw_chunk for exactly one audio
+/// thread (single producer single consumer).
+template <FloatingPt T, size_t BUFFER_SIZE = BoundedPowTwo_v<size_t, 1024>, size_t QUEUE_SIZE = 256>
+    requires(is_bounded_pow_two(BUFFER_SIZE))
+class ControlPanel
+{
+  public:
+    /// @param buffer_manager: Has to outlive the control panel, mustn't be changed by anyone else in the meantime.
+    explicit ControlPanel(BufferManager<T, BUFFER_SIZE>& buffer_manager) : m_buffer_manager{buffer_manager} {}
+
+    /// @note Deleted! The control panel is tied to one BufferManager.
+    ControlPanel(const ControlPanel&) = delete;
+    /// @note Deleted! The control panel is tied to one BufferManager.
+    ControlPanel& operator=(const ControlPanel&) = delete;
+
+    ~ControlPanel() = default;
+
+    /**
+     * CONTROL THREAD
+     * Every function returns false if the queue is full, the change has to be sent again later in that case.
+     */
+    bool set_threshold(const T threshold) noexcept { return push_real(ParameterId::THRESHOLD, threshold); }
+    bool select_osc_waveform(const OscWaveform waveform) noexcept
+    {
+        return push_integer(ParameterId::WAVEFORM, waveform);
+    }
+    bool select_fft_size(const size_t fft_size) noexcept { return push_integer(ParameterId::FFT_SIZE, fft_size); }
+    bool select_partial_count(const size_t count) noexcept { return push_integer(ParameterId::PARTIAL_COUNT, count); }
+    bool select_hop_size(const HopSize hop_size) noexcept { return push_integer(ParameterId::HOP_SIZE, hop_size); }
+    bool select_analysis_window(const AnalysisWindow window) noexcept
+    {
+        return push_integer(ParameterId::ANALYSIS_WINDOW, window);
+    }
+    bool select_interpolation(const WTInterpolation interpolation) noexcept
+    {
+        return push_integer(ParameterId::INTERPOLATION, interpolation);
+    }
+
+    /**
+     * AUDIO THREAD
+     */
+    /// @brief Apply every pending change and process the chunk afterwards.
+    void process_daw_chunk(T* daw_chunk, const size_t t_size)
+    {
+        apply_parameter_updates();
+        m_buffer_manager.process_daw_chunk(daw_chunk, t_size, m_threshold);
+    }
+
+    /// @brief Apply every pending change in the order it was queued (the latest change of a parameter wins).
+    /// @return Number of applied changes.
+    size_t apply_parameter_updates() noexcept;
+
+    /// @brief Threshold as seen by the audio thread.
+    [[nodiscard]] T threshold() const noexcept { return m_threshold; }
+
+  private:
+    bool push_real(const ParameterId id, const double value) noexcept
+    {
+        return m_parameter_queue.push({id, {.m_real = value}});
+    }
+
+    template <typename V>
+    bool push_integer(const ParameterId id, const V value) noexcept
+    {
+        return m_parameter_queue.push({id, {.m_integer = static_cast<uint64_t>(value)}});
+    }
+
+    BufferManager<T, BUFFER_SIZE>& m_buffer_manager;
+    SpscQueue<ParameterUpdate, QUEUE_SIZE> m_parameter_queue{};
+    // only touched by the audio thread
+    T m_threshold = 1;
+};
+
+template <FloatingPt T, size_t BUFFER_SIZE, size_t QUEUE_SIZE>
+    requires(is_bounded_pow_two(BUFFER_SIZE))
+size_t ControlPanel<T, BUFFER_SIZE, QUEUE_SIZE>::apply_parameter_updates() noexcept
+{
+    size_t applied_updates = 0;
+    while (const auto update = m_parameter_queue.pop())
+    {
+        switch (update->m_id)
+        {
+        case ParameterId::THRESHOLD:
+            m_threshold = static_cast<T>(update->m_value.m_real);
+            break;
+        case ParameterId::WAVEFORM:
+            m_buffer_manager.select_osc_waveform(static_cast<OscWaveform>(update->m_value.m_integer));
+            break;
+        case ParameterId::FFT_SIZE:
+            m_buffer_manager.select_fft_size(static_cast<size_t>(update->m_value.m_integer));
+            break;
+        case ParameterId::PARTIAL_COUNT:
+            m_buffer_manager.select_partial_count(static_cast<size_t>(update->m_value.m_integer));
+            break;
+        case ParameterId::HOP_SIZE:
+            m_buffer_manager.select_hop_size(static_cast<HopSize>(update->m_value.m_integer));
+            break;
+        case ParameterId::ANALYSIS_WINDOW:
+            m_buffer_manager.select_analysis_window(static_cast<AnalysisWindow>(update->m_value.m_integer));
+            break;
+        case ParameterId::INTERPOLATION:
+            m_buffer_manager.select_interpolation(static_cast<WTInterpolation>(update->m_value.m_integer));
+            break;
+        }
+        ++applied_updates;
+    }
+    return applied_updates;
+}
+} // namespace LBTS::Spectral
@@ -0,0 +1,479 @@
+/**
+ * Author: Lucas Scheidt
+ * Date: 14.10.26
+ *
+ * Description: Cached analyses. The peaks of every frame are stored in a compact binary file, re-renders map it and
+ * drive the oscillators from it without a single FFT.
+ *
+ * Layout (version 1, native byte order, checked through the byte order tag):
+ * 1. AnalysisFileHeader
+ * 2. the peaks of all frames, frame after frame (PackedPeak, 6 bytes each instead of 12 in a PeakArr of doubles)
+ * 3. the frame table at the header's m_frame_table_offset: num_frames + 1 uint64_t, frame k owns the peaks
+ *    [table[k], table[k + 1]). Any frame can be found without reading the ones before it.
+ * The bins are unsigned 32 bit fixed point with a power of two step (2^-23 bin at N = 1024). 16 bits would do for the
+ * pitch, but the oscillators run for the whole file and the error of a steady partial adds up to a phase drift (1 / 128
+ * bin is a quarter turn within a second). The magnitudes are divided by N / 2 (the amplitude of the partial) and stored
+ * in half precision.
+ */
+
+#pragma once
+#include "SpctDomainSpecific.h"
+#include "SpctOscillators.h"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#if __has_include(<sys/mman.h>)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define SPCT_HAS_MMAP 1
+#else
+#define SPCT_HAS_MMAP 0
+#endif
+
+namespace LBTS::Spectral
+{
+constexpr std::array<char, 8> analysis_file_magic{'S', 'P', 'C', 'T', 'A', 'N', 'L', 'Y'};
+constexpr uint32_t analysis_file_version = 1;
+// reads 0x04030201 if the file was written with the other byte order.
+constexpr uint32_t analysis_file_byte_order_tag = 0x01020304;
+
+/// @brief Everything needed to play the frames back the way they were analysed.
+struct AnalysisFileFormat
+{
+    uint32_t m_fft_size = 1024;
+    uint32_t m_hop_size = 1024;
+    // peaks per frame at most (the partial count of the analysis)
+    uint32_t m_max_entries = max_partials;
+    // samples from the start of the recording until the first frame is complete
+    uint32_t m_first_frame_end = 1024;
+    double m_sampling_freq = 44100.0;
+};
+
+struct AnalysisFileHeader
+{
+    std::array<char, 8> m_magic = analysis_file_magic;
+    uint32_t m_version = analysis_file_version;
+    uint32_t m_header_size = sizeof(AnalysisFileHeader);
+    uint32_t m_byte_order_tag = analysis_file_byte_order_tag;
+    uint32_t m_bin_fraction_bits = 0;
+    AnalysisFileFormat m_format{};
+    uint64_t m_num_frames = 0;
+    uint64_t m_num_peaks = 0;
+    uint64_t m_frame_table_offset = 0;
+};
+// the layout is part of the format (Visualizations/check_outputs.py reads it as well).
+static_assert(sizeof(AnalysisFileHeader) == 72);
+
+/// @brief One peak as it is stored, the bin is split so nothing needs more than 2 byte alignment.
+struct PackedPeak
+{
+    uint16_t m_bin_high;
+    uint16_t m_bin_low;
+    uint16_t m_magnitude;
+
+    [[nodiscard]] uint32_t bin() const noexcept { return (static_cast<uint32_t>(m_bin_high) << 16) | m_bin_low; }
+};
+static_assert(sizeof(PackedPeak) == 6);
+
+/// @brief Round to the nearest half precision value (ties to even), out of range values become infinity.
+[[nodiscard]] inline uint16_t float_to_half_bits(const float value) noexcept
+{
+    const uint32_t bits = std::bit_cast<uint32_t>(value);
+    const auto sign = static_cast<uint16_t>((bits >> 16) & 0x8000U);
+    uint32_t abs_bits = bits & 0x7FFFFFFFU;
+    if (abs_bits >= 0x7F800000U)
+    {
+        // infinity stays infinity, NaN stays (a quiet) NaN
+        return sign | (abs_bits > 0x7F800000U ? 0x7E00U : 0x7C00U);
+    }
+    if (abs_bits >= 0x477FF000U)
+    {
+        // 65520 and above round to infinity
+        return sign | 0x7C00U;
+    }
+    if (abs_bits < 0x38800000U)
+    {
+        // subnormal, the step is 2^-24
+        return sign | static_cast<uint16_t>(std::lrint(std::bit_cast<float>(abs_bits) * 0x1p24f));
+    }
+    // rebias the exponent (127 -> 15) and round away the 13 lower bits of the mantissa
+    abs_bits += 0x0FFFU + ((abs_bits >> 13) & 1U);
+    return sign | static_cast<uint16_t>((abs_bits - (112U << 23)) >> 13);
+}
+
+[[nodiscard]] inline float half_bits_to_float(const uint16_t half) noexcept
+{
+    const uint32_t sign = static_cast<uint32_t>(half & 0x8000U) << 16;
+    const uint32_t exponent = (half >> 10) & 0x1FU;
+    const uint32_t mantissa = half & 0x3FFU;
+    if (exponent == 0)
+    {
+        const float magnitude = static_cast<float>(mantissa) * 0x1p-24f;
+        return sign != 0 ? -magnitude : magnitude;
+    }
+    if (exponent == 0x1F)
+    {
+        return std::bit_cast<float>(sign | 0x7F800000U | (mantissa << 13));
+    }
+    return std::bit_cast<float>(sign | ((exponent + 112U) << 23) | (mantissa << 13));
+}
+
+/// @brief As many fraction bits as the highest bin (N / 2) leaves in 32 bits.
+[[nodiscard]] constexpr uint32_t bin_fraction_bits(const size_t fft_size) noexcept
+{
+    return 32U - static_cast<uint32_t>(std::bit_width(std::max<size_t>(fft_size >> 1, 1)) - 1);
+}
+
+/// @brief Writes the frames one after another while they get analysed (not real-time safe, writes to disk).
+class AnalysisFileWriter
+{
+  public:
+    /// @throws std::runtime_error if the file can't be created.
+    explicit AnalysisFileWriter(const std::string& path) : m_file{path, std::ios::binary | std::ios::trunc}
+    {
+        if (!m_file)
+        {
+            throw std::runtime_error("Could not create the analysis file " + path);
+        }
+        // placeholder, the counts are known at finish.
+        write(m_header);
+    }
+
+    AnalysisFileWriter(const AnalysisFileWriter&) = delete;
+    AnalysisFileWriter& operator=(const AnalysisFileWriter&) = delete;
+
+    /// @brief Finishes the file if that didn't happen yet.
+    ~AnalysisFileWriter()
+    {
+        try
+        {
+            finish();
+        }
+        catch (...)
+        {
+            // nothing sensible to do in a destructor, call finish to see the error.
+        }
+    }
+
+    /// @brief Has to be called before the first frame.
+    void begin(const AnalysisFileFormat& format) noexcept
+    {
+        assert(is_bounded_pow_two(format.m_fft_size));
+        m_header.m_format = format;
+        m_header.m_bin_fraction_bits = bin_fraction_bits(format.m_fft_size);
+        m_magnitude_scale = 2.0 / static_cast<double>(format.m_fft_size);
+        m_begun = true;
+    }
+
+    [[nodiscard]] bool begun() const noexcept { return m_begun; }
+
+    [[nodiscard]] const AnalysisFileFormat& format() const noexcept { return m_header.m_format; }
+
+    [[nodiscard]] size_t num_frames() const noexcept { return m_frame_table.size() - 1; }
+
+    /// @brief Append the valid peaks of the next frame (at most max_entries of them).
+    template <FloatingPt T, size_t CAPACITY>
+    void append_frame(const PeakArr<T, CAPACITY>& peaks, const size_t valid_entries)
+    {
+        assert(m_begun);
+        // the file has at least as many fraction bits as the peaks, the bins are stored exactly.
+        const uint32_t bin_shift = m_header.m_bin_fraction_bits - PeakArr<T, CAPACITY>::bin_fraction_bits;
+        const size_t num_peaks = std::min<size_t>({valid_entries, CAPACITY, m_header.m_format.m_max_entries});
+        m_packed.resize(num_peaks);
+        for (size_t peak = 0; peak < num_peaks; ++peak)
+        {
+            const uint32_t bin = peaks.m_bins[peak] << bin_shift;
+            m_packed[peak].m_bin_high = static_cast<uint16_t>(bin >> 16);
+            m_packed[peak].m_bin_low = static_cast<uint16_t>(bin);
+            const double amplitude = static_cast<double>(peaks.m_magnitudes[peak]) * m_magnitude_scale;
+            m_packed[peak].m_magnitude = float_to_half_bits(static_cast<float>(amplitude));
+        }
+        m_file.write(reinterpret_cast<const char*>(m_packed.data()),
+                     static_cast<std::streamsize>(num_peaks * sizeof(PackedPeak)));
+        m_frame_table.push_back(m_frame_table.back() + num_peaks);
+    }
+
+    /// @brief Write the frame table and the final header, nothing can be appended afterwards.
+    /// @throws std::runtime_error if writing failed at any point.
+    void finish()
+    {
+        if (!m_file.is_open())
+        {
+            return;
+        }
+        // the table is aligned to its entries, so a mapped file can be read in place.
+        const auto peaks_end = sizeof(AnalysisFileHeader) + m_frame_table.back() * sizeof(PackedPeak);
+        const auto table_offset = (peaks_end + alignof(uint64_t) - 1) & ~(alignof(uint64_t) - 1);
+        constexpr std::array<char, alignof(uint64_t)> padding{};
+        m_file.write(padding.data(), static_cast<std::streamsize>(table_offset - peaks_end));
+        m_file.write(reinterpret_cast<const char*>(m_frame_table.data()),
+                     static_cast<std::streamsize>(m_frame_table.size() * sizeof(uint64_t)));
+        m_header.m_num_frames = num_frames();
+        m_header.m_num_peaks = m_frame_table.back();
+        m_header.m_frame_table_offset = table_offset;
+        m_file.seekp(0);
+        write(m_header);
+        m_file.close();
+        if (m_file.fail())
+        {
+            throw std::runtime_error("Could not write the analysis file");
+        }
+    }
+
+  private:
+    template <typename U>
+    void write(const U& value)
+    {
+        m_file.write(reinterpret_cast<const char*>(&value), sizeof(U));
+    }
+
+    std::ofstream m_file;
+    AnalysisFileHeader m_header{};
+    std::vector<uint64_t> m_frame_table{0};
+    std::vector<PackedPeak> m_packed{};
+    double m_magnitude_scale = 1.0;
+    bool m_begun = false;
+};
+
+/// @brief Read only view of an analysis file, mapped into memory (read as a whole where there is no mmap).
+class MappedAnalysisFile
+{
+  public:
+    /// @throws std::runtime_error if the file can't be read or isn't a valid analysis file of this version.
+    explicit MappedAnalysisFile(const std::string& path);
+
+    MappedAnalysisFile(const MappedAnalysisFile&) = delete;
+    MappedAnalysisFile& operator=(const MappedAnalysisFile&) = delete;
+
+    ~MappedAnalysisFile();
+
+    [[nodiscard]] const AnalysisFileFormat& format() const noexcept { return m_header.m_format; }
+
+    [[nodiscard]] size_t num_frames() const noexcept { return m_header.m_num_frames; }
+
+    /// @brief The stored peaks of a frame (seek is constant time).
+    [[nodiscard]] std::span<const PackedPeak> frame(const size_t frame_index) const noexcept
+    {
+        const uint64_t first = m_frame_table[frame_index];
+        return {m_peaks + first, static_cast<size_t>(m_frame_table[frame_index + 1] - first)};
+    }
+
+    /// @brief Decode a frame into the representation of the analysis (real-time safe).
+    /// @return Number of valid entries.
+    template <FloatingPt T, size_t CAPACITY>
+    size_t load_frame(const size_t frame_index, PeakArr<T, CAPACITY>& peaks) const noexcept
+    {
+        const auto stored = frame(frame_index);
+        const size_t num_peaks = std::min(stored.size(), CAPACITY);
+        // rounded to the steps of the peaks, which are never finer than the ones of the file.
+        const uint32_t bin_shift = m_header.m_bin_fraction_bits - PeakArr<T, CAPACITY>::bin_fraction_bits;
+        const uint64_t half_step = (uint64_t{1} << bin_shift) >> 1;
+        for (size_t peak = 0; peak < num_peaks; ++peak)
+        {
+            peaks.m_bins[peak] = static_cast<uint32_t>((stored[peak].bin() + half_step) >> bin_shift);
+            peaks.m_magnitudes[peak] =
+                static_cast<T>(half_bits_to_float(stored[peak].m_magnitude) * m_magnitude_scale);
+        }
+        return num_peaks;
+    }
+
+  private:
+    void validate(const std::string& path);
+
+    const std::byte* m_data = nullptr;
+    size_t m_size = 0;
+    // only used without mmap
+    std::vector<std::byte> m_contents{};
+    AnalysisFileHeader m_header{};
+    const PackedPeak* m_peaks = nullptr;
+    const uint64_t* m_frame_table = nullptr;
+    double m_magnitude_scale = 1.0;
+};
+
+/// @brief Resynthesizes a mapped analysis with its own oscillators, the frames are retuned on the grid they were
+/// analysed on. The oscillators are big, allocate it on the heap.
+/// @tparam FFT_SIZE: Largest FFT size of the files that can be played.
+template <FloatingPt T, size_t FFT_SIZE = BoundedPowTwo_v<size_t, 1024>>
+class AnalysisPlayback
+{
+  public:
+    /// @param smooth_retuning: Glide between the frames over one hop (BufferManager::enable_smooth_retuning).
+    /// @throws std::invalid_argument if the file was analysed with a larger FFT size than FFT_SIZE.
+    explicit AnalysisPlayback(const MappedAnalysisFile& file, const bool smooth_retuning = false)
+        : m_file{file}, m_oscillators{file.format().m_sampling_freq}
+    {
+        const auto& format = file.format();
+        if (format.m_fft_size > FFT_SIZE)
+        {
+            throw std::invalid_argument("The analysis file needs a larger FFT size than the playback provides");
+        }
+        m_oscillators.set_fft_size(format.m_fft_size);
+        m_oscillators.set_partial_count(format.m_max_entries);
+        m_oscillators.set_retune_ramp(smooth_retuning ? format.m_hop_size : 0);
+        m_oscillators.set_hop_size(format.m_hop_size);
+        seek(0);
+    }
+
+    /// @brief Render the next block, every frame boundary the oscillators are tuned to the next stored frame.
+    /// Past the last frame the partials of the last one keep playing.
+    void process(T* output, const size_t num_samples) noexcept
+    {
+        for (size_t index = 0; index < num_samples;)
+        {
+            const size_t segment_size = std::min(num_samples - index, m_samples_to_next_frame);
+            m_oscillators.process(output + index, segment_size);
+            index += segment_size;
+            m_samples_to_next_frame -= segment_size;
+            if (m_samples_to_next_frame == 0)
+            {
+                if (m_next_frame < m_file.num_frames())
+                {
+                    const size_t valid_entries = m_file.load_frame(m_next_frame, m_peaks);
+                    m_oscillators.tune_oscillators(m_peaks, valid_entries);
+                    ++m_next_frame;
+                }
+                m_samples_to_next_frame = m_file.format().m_hop_size;
+            }
+        }
+    }
+
+    /// @brief Continue with the given frame, the next boundary is as far away as the first one of the recording.
+    void seek(const size_t frame_index) noexcept
+    {
+        m_next_frame = std::min(frame_index, m_file.num_frames());
+        m_samples_to_next_frame = std::max<size_t>(m_file.format().m_first_frame_end, 1);
+    }
+
+    [[nodiscard]] size_t next_frame() const noexcept { return m_next_frame; }
+
+  private:
+    static constexpr size_t partial_capacity = partial_capacity_of(FFT_SIZE);
+
+    const MappedAnalysisFile& m_file;
+    ResynthOscs<T, BoundedPowTwo_v<size_t, 512>, FFT_SIZE, partial_capacity> m_oscillators;
+    PeakArr<T, partial_capacity> m_peaks{};
+    size_t m_next_frame = 0;
+    size_t m_samples_to_next_frame = 0;
+};
+
+/**
+ * IMPLEMENTATION
+ */
+inline MappedAnalysisFile::MappedAnalysisFile(const std::string& path)
+{
+#if SPCT_HAS_MMAP
+    const int descriptor = ::open(path.c_str(), O_RDONLY);
+    if (descriptor < 0)
+    {
+        throw std::runtime_error("Could not open the analysis file " + path);
+    }
+    struct stat file_status{};
+    if (::fstat(descriptor, &file_status) != 0 || file_status.st_size <= 0)
+    {
+        ::close(descriptor);
+        throw std::runtime_error("Could not read the analysis file " + path);
+    }
+    m_size = static_cast<size_t>(file_status.st_size);
+    void* mapping = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+    // the mapping keeps the file alive.
+    ::close(descriptor);
+    if (mapping == MAP_FAILED)
+    {
+        throw std::runtime_error("Could not map the analysis file " + path);
+    }
+    m_data = static_cast<const std::byte*>(mapping);
+#else
+    std::ifstream file{path, std::ios::binary | std::ios::ate};
+    if (!file)
+    {
+        throw std::runtime_error("Could not open the analysis file " + path);
+    }
+    m_contents.resize(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(m_contents.data()), static_cast<std::streamsize>(m_contents.size()));
+    m_data = m_contents.data();
+    m_size = m_contents.size();
+#endif
+    try
+    {
+        validate(path);
+    }
+    catch (...)
+    {
+#if SPCT_HAS_MMAP
+        ::munmap(const_cast<std::byte*>(m_data), m_size);
+#endif
+        throw;
+    }
+}
+
+inline MappedAnalysisFile::~MappedAnalysisFile()
+{
+#if SPCT_HAS_MMAP
+    ::munmap(const_cast<std::byte*>(m_data), m_size);
+#endif
+}
+
+inline void MappedAnalysisFile::validate(const std::string& path)
+{
+    const auto invalid = [&path](const char* reason) { return std::runtime_error(path + ": " + reason); };
+    if (m_size < sizeof(AnalysisFileHeader))
+    {
+        throw invalid("too small for an analysis file");
+    }
+    std::memcpy(&m_header, m_data, sizeof(AnalysisFileHeader));
+    if (m_header.m_magic != analysis_file_magic)
+    {
+        throw invalid("not an analysis file");
+    }
+    if (m_header.m_byte_order_tag != analysis_file_byte_order_tag)
+    {
+        throw invalid("written with a different byte order");
+    }
+    if (m_header.m_version != analysis_file_version || m_header.m_header_size != sizeof(AnalysisFileHeader))
+    {
+        throw invalid("unsupported version");
+    }
+    const auto& format = m_header.m_format;
+    if (!is_bounded_pow_two(format.m_fft_size) || format.m_hop_size == 0 || format.m_hop_size > format.m_fft_size ||
+        m_header.m_bin_fraction_bits != bin_fraction_bits(format.m_fft_size))
+    {
+        throw invalid("invalid format");
+    }
+    // the counts come from the file, they are checked against the file size before they get multiplied (a crafted
+    // count could wrap the products around and pass the bounds check otherwise).
+    if (m_header.m_num_frames >= m_size / sizeof(uint64_t) || m_header.m_num_peaks > m_size / sizeof(PackedPeak) ||
+        m_header.m_frame_table_offset > m_size)
+    {
+        throw invalid("truncated");
+    }
+    const uint64_t table_size = (m_header.m_num_frames + 1) * sizeof(uint64_t);
+    if (m_header.m_frame_table_offset % alignof(uint64_t) != 0 ||
+        m_header.m_frame_table_offset < sizeof(AnalysisFileHeader) + m_header.m_num_peaks * sizeof(PackedPeak) ||
+        table_size > m_size - m_header.m_frame_table_offset)
+    {
+        throw invalid("truncated");
+    }
+    m_peaks = reinterpret_cast<const PackedPeak*>(m_data + sizeof(AnalysisFileHeader));
+    m_frame_table = reinterpret_cast<const uint64_t*>(m_data + m_header.m_frame_table_offset);
+    // the frames have to be in order and inside the peaks, frame() doesn't check anything.
+    if (m_frame_table[0] != 0 || m_frame_table[m_header.m_num_frames] != m_header.m_num_peaks ||
+        !std::is_sorted(m_frame_table, m_frame_table + m_header.m_num_frames + 1))
+    {
+        throw invalid("corrupt frame table");
+    }
+    m_magnitude_scale = static_cast<double>(format.m_fft_size) / 2.0;
+}
+} // namespace LBTS::Spectral
@@ -0,0 +1,80 @@
+/**
+ * Author: Lucas Scheidt
+ * Date: 14.10.26
+ *
+ * Description: Compile-time tables of the analysis windows that get applied while a frame is copied from the ring
+ * buffer into the FFT buffer.
+ */
+
+#pragma once
+#include "SpctConstexprMath.h"
+#include "SpctDomainSpecific.h"
+#include <array>
+
+namespace LBTS::Spectral
+{
+
+/// @brief Table of one analysis window. The periodic version of the window is used (the right place for an STFT) and
+/// normalized to a coherent gain of one (sum of all values = N). That way the magnitudes of a windowed frame are
+/// comparable to the ones of an unwindowed frame, so neither the threshold nor the amplitude correction of the
+/// oscillators has to know about the window.
+/// This is a compile-time struct and NOT intended to be an object.
+/// @tparam T: Type of the window values.
+/// @tparam N_SAMPLES: Length of the window (= size of the FFT).
+/// @tparam WINDOW: The window to generate.
+template <FloatingPt T, size_t N_SAMPLES, AnalysisWindow WINDOW>
+    requires(is_bounded_pow_two(N_SAMPLES))
+struct AnalysisWindowTable
+{
+    AnalysisWindowTable() = delete;
+    static constexpr std::array<T, N_SAMPLES> value = []
+    {
+        // calculated in double precision and narrowed afterwards.
+        std::array<double, N_SAMPLES> window{};
+        double window_sum = 0;
+        for (size_t index = 0; index < N_SAMPLES; ++index)
+        {
+            const double phase = two_pi<double> * static_cast<double>(index) / static_cast<double>(N_SAMPLES);
+            switch (WINDOW)
+            {
+            case AnalysisWindow::RECTANGULAR:
+                window[index] = 1.0;
+                break;
+            case AnalysisWindow::HANN:
+                window[index] = 0.5 - 0.5 * constexpr_cos(phase);
+                break;
+            case AnalysisWindow::BLACKMAN:
+                window[index] = 0.42 - 0.5 * constexpr_cos(phase) + 0.08 * constexpr_cos(2 * phase);
+                break;
+            }
+            window_sum += window[index];
+        }
+        std::array<T, N_SAMPLES> normalized{};
+        for (size_t index = 0; index < N_SAMPLES; ++index)
+        {
+            normalized[index] = static_cast<T>(window[index] * static_cast<double>(N_SAMPLES) / window_sum);
+        }
+        return normalized;
+    }();
+};
+
+/// @brief For conveniance the table can be accessed directly with the "_v" suffix.
+template <FloatingPt T, size_t N_SAMPLES, AnalysisWindow WINDOW>
+constexpr const auto& AnalysisWindowTable_v = AnalysisWindowTable<T, N_SAMPLES, WINDOW>::value;
+
+/// @brief Get the table of a window that is chosen at runtime.
+template <FloatingPt T, size_t N_SAMPLES>
+    requires(is_bounded_pow_two(N_SAMPLES))
+constexpr const std::array<T, N_SAMPLES>& analysis_window_table(const AnalysisWindow window) noexcept
+{
+    switch (window)
+    {
+    case AnalysisWindow::HANN:
+        return AnalysisWindowTable_v<T, N_SAMPLES, AnalysisWindow::HANN>;
+    case AnalysisWindow::BLACKMAN:
+        return AnalysisWindowTable_v<T, N_SAMPLES, AnalysisWindow::BLACKMAN>;
+    default:
+        return AnalysisWindowTable_v<T, N_SAMPLES, AnalysisWindow::RECTANGULAR>;
+    }
+}
+} // namespace LBTS::Spectral
@@ -0,0 +1,147 @@
+/**
+ * Author: Lucas Scheidt
+ * Date: 14.10.26
+ *
+ * Description: Background thread that analyses the frames of a BufferManager. The audio thread only copies the frame
+ * and picks up the peaks of the previous one, the FFT itself no longer lands in a single DAW callback.
+ */
+
+#pragma once
+#include "SpctAnalysisWindows.h"
+#include "SpctDenormals.h"
+#include "SpctDomainSpecific.h"
+#include "SpctFrameAnalyser.h"
+#include "SpctTripleBuffer.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+namespace LBTS::Spectral
+{
+/// @brief A frame waiting for the analysis.
+template <FloatingPt T, size_t BUFFER_SIZE>
+struct AnalysisJob
+{
+    // the valid range of the ring buffer, as it was when the frame was complete.
+    std::array<T, BUFFER_SIZE> m_ring_samples{};
+    size_t m_oldest_index = 0;
+    size_t m_fft_size = BUFFER_SIZE;
+    AnalysisWindow m_analysis_window = AnalysisWindow::RECTANGULAR;
+    T m_threshold = 1;
+    size_t m_max_entries = 0;
+};
+
+/// @brief The peaks of an analysed frame.
+template <FloatingPt T, size_t BUFFER_SIZE>
+struct AnalysisResult
+{
+    // as many peaks as the BufferManager can play.
+    PeakArr<T, partial_capacity_of(BUFFER_SIZE)> m_peaks{};
+    size_t m_valid_entries = 0;
+    // the bins only make sense with the size they were calculated with.
+    size_t m_fft_size = BUFFER_SIZE;
+};
+
+/// @brief Owns the analysis thread. Frames go in through one triple buffer, results come out through another one, so
+/// the audio thread never waits. If the worker falls behind, it skips to the latest frame.
+/// @tparam T: Type of the samples.
+/// @tparam MIN_FFT_SIZE: Smallest FFT size of the frames.
+/// @tparam BUFFER_SIZE: Largest FFT size of the frames.
+template <FloatingPt T, size_t MIN_FFT_SIZE, size_t BUFFER_SIZE>
+    requires(is_bounded_pow_two(BUFFER_SIZE))
+class AnalysisWorker
+{
+  public:
+    using Job = AnalysisJob<T, BUFFER_SIZE>;
+    using Result = AnalysisResult<T, BUFFER_SIZE>;
+
+    /// @brief Starts the thread (allocates, not real-time safe).
+    AnalysisWorker() : m_thread{[this] { run(); }} {}
+
+    /// @note Deleted! The thread refers to this instance.
+    AnalysisWorker(const AnalysisWorker&) = delete;
+    /// @note Deleted! The thread refers to this instance.
+    AnalysisWorker& operator=(const AnalysisWorker&) = delete;
+
+    /// @brief Stops and joins the thread, a frame in progress gets finished first.
+    ~AnalysisWorker()
+    {
+        m_running.store(false, std::memory_order_relaxed);
+        m_submitted_jobs.fetch_add(1, std::memory_order_release);
+        m_submitted_jobs.notify_one();
+        m_thread.join();
+    }
+
+    /// @brief Audio thread only. The job to fill before submit.
+    Job& job() noexcept { return m_jobs.write_buffer(); }
+
+    /// @brief Audio thread only. Hands the filled job to the worker and wakes it up, never blocks.
+    void submit() noexcept
+    {
+        m_jobs.publish();
+        m_submitted_jobs.fetch_add(1, std::memory_order_release);
+        m_submitted_jobs.notify_one();
+    }
+
+    /// @brief Audio thread only.
+    /// @return The result that was finished since the last call or nullptr. Stays valid until the next call.
+    const Result* latest_result() noexcept { return m_results.update() ? &m_results.read_buffer() : nullptr; }
+
+    /// @brief Block until every submitted job is analysed (offline rendering and tests, never on the audio thread).
+    void wait_until_idle() const noexcept
+    {
+        const uint32_t submitted_jobs = m_submitted_jobs.load(std::memory_order_acquire);
+        uint32_t finished_jobs = m_finished_jobs.load(std::memory_order_acquire);
+        while (finished_jobs != submitted_jobs)
+        {
+            m_finished_jobs.wait(finished_jobs, std::memory_order_acquire);
+            finished_jobs = m_finished_jobs.load(std::memory_order_acquire);
+        }
+    }
+
+  private:
+    void run() noexcept
+    {
+        // same floating point mode as the audio thread, for the whole life of the thread.
+        const ScopedFlushDenormals flush_denormals{};
+        uint32_t seen_jobs = 0;
+        while (true)
+        {
+            m_submitted_jobs.wait(seen_jobs, std::memory_order_acquire);
+            seen_jobs = m_submitted_jobs.load(std::memory_order_acquire);
+            if (!m_running.load(std::memory_order_relaxed))
+            {
+                return;
+            }
+            // several submissions since the last wake up only give one (the latest) job.
+            if (m_jobs.update())
+            {
+                const Job& job = m_jobs.read_buffer();
+                Result& result = m_results.write_buffer();
+                m_frame_analyser.select_fft_size(job.m_fft_size);
+                result.m_valid_entries = m_frame_analyser.analyse(job.m_ring_samples,
+                                                                  job.m_oldest_index,
+                                                                  job.m_analysis_window,
+                                                                  result.m_peaks,
+                                                                  job.m_threshold,
+                                                                  job.m_max_entries);
+                result.m_fft_size = job.m_fft_size;
+                m_results.publish();
+            }
+            m_finished_jobs.store(seen_jobs, std::memory_order_release);
+            m_finished_jobs.notify_all();
+        }
+    }
+
+    TripleBuffer<Job> m_jobs{};
+    TripleBuffer<Result> m_results{};
+    FrameAnalyser<T, MIN_FFT_SIZE, BUFFER_SIZE> m_frame_analyser{};
+    std::atomic<bool> m_running{true};
+    alignas(64) std::atomic<uint32_t> m_submitted_jobs{0};
+    alignas(64) std::atomic<uint32_t> m_finished_jobs{0};
+    // started last, everything it touches is constructed by then.
+    std::thread m_thread;
+};
+} // namespace LBTS::Spectral
@@ -4,58 +4,279 @@
  * them to the FourierMap.
  */
 #pragma once
+#include "SpctAnalysisWindows.h"
+#include "SpctAnalysisWorker.h"
 #include "SpctCircularBuffer.h"
+#include "SpctDenormals.h"
 #include "SpctDomainSpecific.h"
-#include "SpctExponentLUT.h"
+#include "SpctFrameAnalyser.h"
+#include "SpctFrameScheduler.h"
+#include "SpctIfftResynth.h"
 #include "SpctOscillators.h"
-#include "SpctProcessingFunctions.h"
-#include <cmath>
+#include "SpctProfiler.h"
+#include <algorithm>
+#include <memory>
+#include <optional>
 
 /**
  * DECLARATION
  */
 namespace LBTS::Spectral
 {
+/// @brief Whatever turns the analysed peaks back into audio (the own oscillators of the BufferManager or e.g. the
+/// voices of a VoiceManager).
+template <typename R, typename T, size_t CAPACITY>
+concept Resynthesizer = requires(R resynthesizer, T* output, const PeakArr<T, CAPACITY>& peaks) {
+    resynthesizer.process(output, size_t{});
+    resynthesizer.tune_oscillators(peaks, size_t{});
+};
+
+/// @tparam T: Type of the samples.
+/// @tparam BUFFER_SIZE: Maximum FFT size, everything is preallocated for it. The actual size is chosen at runtime.
 template <FloatingPt T, size_t BUFFER_SIZE = BoundedPowTwo_v<size_t, 1024>>
     requires(is_bounded_pow_two(BUFFER_SIZE))
 class BufferManager
 {
   public:
+    /// @brief Smallest FFT size that can be selected at runtime.
+    static constexpr size_t min_fft_size = std::min<size_t>(BoundedPowTwo_v<size_t, 16>, BUFFER_SIZE);
+    /// @brief There can't be more peaks than bins, so the capacity is limited by the FFT size as well.
+    static constexpr size_t partial_capacity = partial_capacity_of(BUFFER_SIZE);
+
     BufferManager() = default;
-    explicit BufferManager(const double sampling_freq) : m_sampling_freq{sampling_freq}, m_oscillators{sampling_freq} {}
-    /// @note the runtime implementation of a changing size for the fft may be more complex than expected and will
-    /// therefore be postponed.
-    // explicit BufferManager(const size_t i_range)
-    // {
-    //     m_ring_buffers.resize_valid_range(i_range);
-    //     m_buffer_size = m_ring_buffers.size();
-    // }
+    explicit BufferManager(const double sampling_freq)
+        : m_sampling_freq{sampling_freq},
+          m_oscillators{sampling_freq}
+    {}
+    BufferManager(const double sampling_freq, const size_t fft_size) : BufferManager(sampling_freq)
+    {
+        select_fft_size(fft_size);
+    }
 
     /// @brief main processing is done in here since Juce works with C-style arrays this takes in T* as first address
     /// of the array.
-    void process_daw_chunk(T* daw_chunk, const size_t t_size, const T threshold = 1.0);
+    void process_daw_chunk(T* daw_chunk, const size_t t_size, const T threshold = 1.0)
+    {
+        if (m_resynthesis_engine == ResynthesisEngine::INVERSE_FFT)
+        {
+            process_daw_chunk(daw_chunk, t_size, threshold, *m_ifft_resynth);
+            return;
+        }
+        process_daw_chunk(daw_chunk, t_size, threshold, m_oscillators);
+    }
+
+    /// @brief Same as above but the chunk is resynthesized by another resynthesizer, which gets retuned with the peaks
+    /// of every analysed frame (the analysis is done once, no matter how many oscillators render it).
+    template <Resynthesizer<T, partial_capacity_of(BUFFER_SIZE)> RESYNTH>
+    void process_daw_chunk(T* daw_chunk, const size_t t_size, const T threshold, RESYNTH& resynthesizer);
+
+    /// @brief Peaks of the latest analysed frame, only the first valid_entries are valid.
+    [[nodiscard]] const PeakArr<T, partial_capacity>& peaks() const noexcept { return m_peaks; }
+
+    [[nodiscard]] size_t valid_entries() const noexcept { return m_valid_entries; }
 
     void reset(const double sampling_freq) noexcept
     {
         m_sampling_freq = sampling_freq;
         m_ring_buffer.reset_buffers();
         m_oscillators.reset(sampling_freq);
+        if (m_ifft_resynth)
+        {
+            m_ifft_resynth->reset(sampling_freq);
+        }
     }
 
     void select_osc_waveform(const OscWaveform& osc_waveform) noexcept { m_oscillators.select_waveform(osc_waveform); }
 
+    void select_interpolation(const WTInterpolation interpolation) noexcept
+    {
+        m_oscillators.select_interpolation(interpolation);
+    }
+
+    [[nodiscard]] WTInterpolation interpolation() const noexcept { return m_oscillators.interpolation(); }
+
+    /// @brief Maximum number of partials that get resynthesized (clamped to partial_capacity).
+    void select_partial_count(const size_t partial_count) noexcept
+    {
+        m_oscillators.set_partial_count(partial_count);
+        if (m_ifft_resynth)
+        {
+            m_ifft_resynth->set_partial_count(partial_count);
+        }
+    }
+
+    /// @brief Oscillator bank or inverse FFT, the inverse FFT is cheaper from about 4 to 16 partials on (depending on
+    /// the hop, see SpctIfftResynth.h) but only plays sines. The engine that is switched to starts with the next frame.
+    /// @note The inverse FFT gets allocated the first time it is selected (and kept), so select it while preparing
+    /// playback, not from the audio callback.
+    void select_resynthesis_engine(const ResynthesisEngine engine);
+
+    [[nodiscard]] ResynthesisEngine resynthesis_engine() const noexcept { return m_resynthesis_engine; }
+
+    [[nodiscard]] size_t partial_count() const noexcept { return m_oscillators.partial_count(); }
+
+    [[nodiscard]] double sampling_freq() const noexcept { return m_sampling_freq; }
+
+    /// @brief Distance between two analysed frames, smaller hops track transients more tightly without a larger FFT
+    /// (at the cost of more transformations).
+    void select_hop_size(const HopSize hop_size) noexcept
+    {
+        m_ring_buffer.set_hop_size(hop_size);
+        update_hop_size();
+    }
+
+    /// @brief Window that gets applied to every frame while it is copied into the FFT buffer.
+    void select_analysis_window(const AnalysisWindow analysis_window) noexcept { m_analysis_window = analysis_window; }
+
+    /// @brief Switch the size of the analysed frames without another instance. Nothing gets allocated, the kernel of
+    /// the new size is constructed in place. The ring buffer starts over, the oscillators keep playing until the first
+    /// frame of the new size is complete.
+    /// @param fft_size: Clipped to a power of two in the range of min_fft_size .. BUFFER_SIZE.
+    void select_fft_size(const size_t fft_size) noexcept;
+
+    [[nodiscard]] size_t fft_size() const noexcept { return m_ring_buffer.size(); }
+
+    [[nodiscard]] size_t hop_size() const noexcept { return m_ring_buffer.hop_size(); }
+
+    /// @brief Track the partials from frame to frame and glide every oscillator to its new frequency and amplitude
+    /// during the hop instead of jumping at the frame boundary. Hides the steps of short frames and small hops.
+    void enable_smooth_retuning(const bool enable) noexcept
+    {
+        m_smooth_retuning = enable;
+        update_hop_size();
+    }
+
+    [[nodiscard]] bool smooth_retuning() const noexcept { return m_smooth_retuning; }
+
+    /// @brief Move the FFT onto a background thread. The audio thread then only copies every frame and picks up the
+    /// peaks of the previous one, which spreads the cost evenly over the callbacks at the price of a latency of one
+    /// hop (see analysis_latency).
+    /// @note Starts or stops a thread, so call it while preparing playback, not from the audio callback.
+    void enable_async_analysis(const bool enable);
+
+    [[nodiscard]] bool async_analysis() const noexcept { return m_analysis_worker != nullptr; }
+
+    /// @brief For hosts without a worker thread: analyse every frame step by step during the following hop instead of
+    /// all at once. Every incoming sample pays the same share of the steps, so the worst case of a callback is
+    /// predictable (about one step per hop / steps samples). The latency is one hop as in the asynchronous mode,
+    /// which gets disabled.
+    /// @note Starts over if the FFT size changes while a frame is pending.
+    void enable_incremental_analysis(const bool enable);
+
+    [[nodiscard]] bool incremental_analysis() const noexcept { return m_incremental_analysis; }
+
+    /// @brief Additional delay of the resynthesis in samples: the peaks of a frame get played from the next frame on
+    /// in the asynchronous mode (provided the worker finished in time, otherwise they are dropped in favour of the
+    /// next frame). Zero in the synchronous mode. The frame phase (see enable_staggered_frames) doesn't change it.
+    [[nodiscard]] size_t analysis_latency() const noexcept
+    {
+        return async_analysis() || incremental_analysis() ? m_ring_buffer.hop_size() : 0;
+    }
+
+    /// @brief For sessions with many instances: take a slot of the process-wide FramePhaseScheduler and complete the
+    /// frames at its phase of the hop instead of in the same callback as all the other instances. Every frame is still
+    /// the latest fft_size samples and is analysed exactly as before, so the latency stays the same (see
+    /// analysis_latency), only the callbacks that do the FFTs differ. Disabling frees the slot and realigns the frames.
+    /// @note Locks a mutex, so call it while preparing playback, not from the audio callback.
+    void enable_staggered_frames(const bool enable)
+    {
+        if (enable && !m_frame_phase_slot)
+        {
+            m_frame_phase_slot.emplace();
+        }
+        else if (!enable)
+        {
+            m_frame_phase_slot.reset();
+        }
+        m_ring_buffer.set_frame_phase(m_frame_phase_slot ? m_frame_phase_slot->phase() : 0.0);
+    }
+
+    [[nodiscard]] bool staggered_frames() const noexcept { return m_frame_phase_slot.has_value(); }
+
+    /// @brief Position of the frame boundaries as fraction of the hop (0 unless staggered).
+    [[nodiscard]] double frame_phase() const noexcept { return m_ring_buffer.frame_phase(); }
+
+    /// @brief Block until the worker analysed every submitted frame (offline rendering, never on the audio thread).
+    void wait_for_analysis() const noexcept
+    {
+        if (m_analysis_worker)
+        {
+            m_analysis_worker->wait_until_idle();
+        }
+    }
+
+    /// @brief Measurements of the stages of process_daw_chunk, drain them from a non-audio thread (e.g. with
+    /// ProfileHistogram::drain). Only filled if compiled with SPCT_ENABLE_PROFILING, empty otherwise.
+    /// @note In the asynchronous mode FFT and peak selection run on the worker and aren't recorded, the copy of the
+    /// frame counts as fill.
+    [[nodiscard]] StageProfiler<>& profiler() noexcept { return m_profiler; }
+
     /// @note this is only needed for testing purposes, could be deletet later on.
     [[nodiscard]] size_t ring_buffer_index() const noexcept { return m_ring_buffer.current_index(); }
 
+    /// @note renders whole files with the same state, only the analysis is taken out of the segment loop.
+    friend OfflineRenderer<T, BUFFER_SIZE>;
+
   private:
+    /// @brief Transform the latest frame and pick its peaks.
+    void analyse_frame(const T threshold) noexcept;
+
+    /// @brief Hand the latest frame to the worker.
+    void submit_frame(const T threshold) noexcept;
+
+    /// @brief At most that many steps of the previous frame are done at a frame boundary. In the regular schedule none
+    /// are left there, only a hop size or FFT size change in the middle of a frame leaves more.
+    static constexpr size_t max_catch_up_steps = 2;
+
+    /// @brief Do the share of the incremental analysis the samples of a segment pay for.
+    /// @return true if the analysis was completed.
+    bool advance_incremental_analysis(const size_t num_samples) noexcept;
+
+    /// @brief Take over the peaks the worker finished since the last frame.
+    /// @return false if there are none (or they belong to an FFT size that isn't selected anymore).
+    bool collect_analysis() noexcept;
+
+    /// @brief The retune ramps and the grains of the inverse FFT span one hop.
+    void update_hop_size() noexcept
+    {
+        m_oscillators.set_retune_ramp(m_smooth_retuning ? m_ring_buffer.hop_size() : 0);
+        m_oscillators.set_hop_size(m_ring_buffer.hop_size());
+        if (m_ifft_resynth)
+        {
+            m_ifft_resynth->set_hop_size(m_ring_buffer.hop_size());
+        }
+    }
+
+    template <typename RESYNTH>
+    void tune(RESYNTH& resynthesizer)
+    {
+        ScopedStageTimer timer{m_profiler, ProfileStage::TUNE};
+        resynthesizer.tune_oscillators(m_peaks, m_valid_entries);
+    }
+
     CircularSampleBuffer<T, BUFFER_SIZE> m_ring_buffer{};
-    size_t m_buffer_size = m_ring_buffer.size();
-    ExponentLUT<T> m_exponent_lut{};
-    BinMagArr<T, (BUFFER_SIZE >> 1)> m_bin_mag_arr;
+    AnalysisWindow m_analysis_window = AnalysisWindow::RECTANGULAR;
+    FrameAnalyser<T, min_fft_size, BUFFER_SIZE> m_frame_analyser{};
+    // only exists in the asynchronous mode.
+    std::unique_ptr<AnalysisWorker<T, min_fft_size, BUFFER_SIZE>> m_analysis_worker{};
+    bool m_incremental_analysis = false;
+    // only held while the frames are staggered.
+    std::optional<FramePhaseSlot> m_frame_phase_slot{};
+    bool m_smooth_retuning = false;
+    // samples * steps paid but not done yet, a step is due per hop size.
+    size_t m_step_credit = 0;
+    // samples of the pending frame the ring buffer overwrote since begin_analysis.
+    size_t m_overwritten_samples = 0;
+    PeakArr<T, partial_capacity> m_peaks{};
     size_t m_valid_entries = 0;
     // Juce uses double as sample frequency, since I'll use the framework for deployment I'll use double too.
     double m_sampling_freq = 44100.0;
-    ResynthOscs<T, BoundedPowTwo_v<size_t, 512>, BUFFER_SIZE> m_oscillators{m_sampling_freq};
+    ResynthOscs<T, BoundedPowTwo_v<size_t, 512>, BUFFER_SIZE, partial_capacity> m_oscillators{m_sampling_freq};
+    // only exists once the inverse FFT was selected, most instances never use it.
+    std::unique_ptr<IfftResynth<T, BUFFER_SIZE, partial_capacity>> m_ifft_resynth{};
+    ResynthesisEngine m_resynthesis_engine = ResynthesisEngine::OSCILLATOR_BANK;
+    // takes no space unless profiling is compiled in.
+    [[no_unique_address]] StageProfiler<> m_profiler{};
 };
 
 /**
@@ -63,50 +284,195 @@ class BufferManager
  */
 template <FloatingPt T, size_t BUFFER_SIZE>
     requires(is_bounded_pow_two(BUFFER_SIZE))
-void BufferManager<T, BUFFER_SIZE>::process_daw_chunk(T* daw_chunk, const size_t t_size, const T threshold)
+template <Resynthesizer<T, partial_capacity_of(BUFFER_SIZE)> RESYNTH>
+void BufferManager<T, BUFFER_SIZE>::process_daw_chunk(T* daw_chunk, const size_t t_size, const T threshold,
+                                                      RESYNTH& resynthesizer)
 {
-    // in case the daw buffer is greater that the internal one, more steps are needed.
-    // The narrowing conversion is WANTED!
-    // clang-format off
-     const size_t steps_needed = t_size > m_buffer_size ?
-         std::ceil(static_cast<float>(t_size) / m_buffer_size) : 1; // NOLINT(*-narrowing-conversions)
-    // clang-format on
-    size_t daw_chunk_write_index = 0;
-    bool do_transformation = false;
-    for (size_t step = 0; step < steps_needed; ++step)
-    {
-        // in case that chunk > internal size this while loop takes care of the complete filling porcess correctly
-        while (!do_transformation && daw_chunk_write_index < t_size)
-        {
-            m_ring_buffer.fill_input(daw_chunk[daw_chunk_write_index]);
-            daw_chunk[daw_chunk_write_index] = m_oscillators.receive_output(m_bin_mag_arr, m_valid_entries);
-            do_transformation = m_ring_buffer.advance();
-            ++daw_chunk_write_index;
-        }
-        if (do_transformation)
+    // fading partials and the tails of the ramps end up as denormals, they are flushed for the whole callback.
+    const ScopedFlushDenormals flush_denormals{};
+    // the chunk is cut into segments that end on a frame boundary (every hop). Within a segment the oscillators don't
+    // change, so the whole segment is copied into the ring buffer first (one bulk copy, no per sample advance) and then
+    // rendered in one block (which overwrites the input).
+    m_ring_buffer.for_each_segment(
+        t_size,
+        [&](const size_t offset, const size_t segment_size)
         {
-            // pass the whole array as reference to the FFT, will change the input array!
-            spct_fourier_transform<T, degree_of_pow_two_value(BUFFER_SIZE)>(m_ring_buffer.m_in_array, m_exponent_lut);
-            // calculate the dominant magnitudes, won't change the input array
-            m_valid_entries = calculate_max_map<T, BUFFER_SIZE>(m_ring_buffer.m_in_array, m_bin_mag_arr, threshold);
-            if (m_valid_entries > max_oscillators)
+            T* segment = daw_chunk + offset;
+            bool do_transformation = false;
             {
-                m_valid_entries = max_oscillators;
+                ScopedStageTimer timer{m_profiler, ProfileStage::FILL};
+                if (m_incremental_analysis)
+                {
+                    // the segment overwrites the oldest samples of the pending frame, they get packed just before.
+                    m_overwritten_samples += segment_size;
+                    m_frame_analyser.pack_frame_until(m_overwritten_samples);
+                }
+                do_transformation = m_ring_buffer.fill_span(segment, segment_size);
             }
-            m_oscillators.tune_oscillators(m_bin_mag_arr, m_valid_entries);
-            do_transformation = false;
-        }
+            {
+                ScopedStageTimer timer{m_profiler, ProfileStage::RENDER};
+                resynthesizer.process(segment, segment_size);
+            }
+            if (m_incremental_analysis && advance_incremental_analysis(segment_size))
+            {
+                tune(resynthesizer);
+            }
+            if (do_transformation && m_incremental_analysis)
+            {
+                // the hop is over so the previous frame is done, unless the hop size shrunk in between. Finishing it
+                // here would be the whole analysis in one callback again, so it gets a few steps and is dropped
+                // otherwise (the oscillators keep the previous tuning for one more hop).
+                bool completed = false;
+                for (size_t step = 0; step < max_catch_up_steps && m_frame_analyser.analysis_pending(); ++step)
+                {
+                    completed = m_frame_analyser.analysis_step(m_peaks, m_valid_entries, m_profiler);
+                }
+                if (completed)
+                {
+                    tune(resynthesizer);
+                }
+                m_frame_analyser.begin_analysis(m_ring_buffer.m_in_array,
+                                                m_ring_buffer.current_index(),
+                                                m_analysis_window,
+                                                threshold,
+                                                m_oscillators.partial_count());
+                m_step_credit = 0;
+                m_overwritten_samples = 0;
+            }
+            else if (do_transformation && !m_analysis_worker)
+            {
+                analyse_frame(threshold);
+                tune(resynthesizer);
+            }
+            else if (do_transformation)
+            {
+                // the previous frame had a whole hop to get analysed.
+                if (collect_analysis())
+                {
+                    tune(resynthesizer);
+                }
+                submit_frame(threshold);
+            }
+        });
+}
+
+template <FloatingPt T, size_t BUFFER_SIZE>
+    requires(is_bounded_pow_two(BUFFER_SIZE))
+void BufferManager<T, BUFFER_SIZE>::select_fft_size(const size_t fft_size) noexcept
+{
+    m_ring_buffer.resize_valid_range(std::max(fft_size, min_fft_size));
+    m_frame_analyser.select_fft_size(m_ring_buffer.size());
+    m_oscillators.set_fft_size(m_ring_buffer.size());
+    if (m_ifft_resynth)
+    {
+        m_ifft_resynth->set_fft_size(m_ring_buffer.size());
+    }
+    update_hop_size();
+}
+
+template <FloatingPt T, size_t BUFFER_SIZE>
+    requires(is_bounded_pow_two(BUFFER_SIZE))
+void BufferManager<T, BUFFER_SIZE>::select_resynthesis_engine(const ResynthesisEngine engine)
+{
+    if (engine == ResynthesisEngine::INVERSE_FFT && !m_ifft_resynth)
+    {
+        m_ifft_resynth = std::make_unique<IfftResynth<T, BUFFER_SIZE, partial_capacity>>(m_sampling_freq);
+        m_ifft_resynth->set_partial_count(m_oscillators.partial_count());
+        m_ifft_resynth->set_fft_size(m_ring_buffer.size());
+        m_ifft_resynth->set_hop_size(m_ring_buffer.hop_size());
     }
-    // tackle rest if chunk < internal size and while has been interrupted by transform flag
-    if (steps_needed == 1)
+    m_resynthesis_engine = engine;
+}
+
+template <FloatingPt T, size_t BUFFER_SIZE>
+    requires(is_bounded_pow_two(BUFFER_SIZE))
+void BufferManager<T, BUFFER_SIZE>::enable_async_analysis(const bool enable)
+{
+    if (!enable)
     {
-        while (daw_chunk_write_index < t_size)
-        {
-            m_ring_buffer.fill_input(daw_chunk[daw_chunk_write_index]);
-            daw_chunk[daw_chunk_write_index] = m_oscillators.receive_output(m_bin_mag_arr, m_valid_entries);
-            m_ring_buffer.advance();
-            ++daw_chunk_write_index;
-        }
+        m_analysis_worker.reset();
+    }
+    else if (!m_analysis_worker)
+    {
+        m_analysis_worker = std::make_unique<AnalysisWorker<T, min_fft_size, BUFFER_SIZE>>();
+        m_incremental_analysis = false;
+    }
+}
+
+template <FloatingPt T, size_t BUFFER_SIZE>
+    requires(is_bounded_pow_two(BUFFER_SIZE))
+void BufferManager<T, BUFFER_SIZE>::enable_incremental_analysis(const bool enable)
+{
+    if (enable)
+    {
+        m_analysis_worker.reset();
+    }
+    m_incremental_analysis = enable;
+    m_step_credit = 0;
+}
+
+template <FloatingPt T, size_t BUFFER_SIZE>
+    requires(is_bounded_pow_two(BUFFER_SIZE))
+bool BufferManager<T, BUFFER_SIZE>::advance_incremental_analysis(const size_t num_samples) noexcept
+{
+    if (!m_frame_analyser.analysis_pending())
+    {
+        return false;
+    }
+    // all steps are paid exactly when the next frame is complete: steps per sample = steps / hop size.
+    const size_t hop_size = m_ring_buffer.hop_size();
+    m_step_credit += num_samples * m_frame_analyser.num_analysis_steps();
+    bool completed = false;
+    for (; m_step_credit >= hop_size && !completed; m_step_credit -= hop_size)
+    {
+        completed = m_frame_analyser.analysis_step(m_peaks, m_valid_entries, m_profiler);
+    }
+    return completed;
+}
+
+template <FloatingPt T, size_t BUFFER_SIZE>
+    requires(is_bounded_pow_two(BUFFER_SIZE))
+void BufferManager<T, BUFFER_SIZE>::analyse_frame(const T threshold) noexcept
+{
+    // the frame starts at the oldest sample of the ring buffer, which is the one that gets overwritten next. The
+    // window is applied while the samples get packed into the spectrum array, the ring buffer stays untouched.
+    m_valid_entries = m_frame_analyser.analyse(m_ring_buffer.m_in_array,
+                                               m_ring_buffer.current_index(),
+                                               m_analysis_window,
+                                               m_peaks,
+                                               threshold,
+                                               m_oscillators.partial_count(),
+                                               m_profiler);
+}
+
+template <FloatingPt T, size_t BUFFER_SIZE>
+    requires(is_bounded_pow_two(BUFFER_SIZE))
+void BufferManager<T, BUFFER_SIZE>::submit_frame(const T threshold) noexcept
+{
+    // only the valid range gets copied, the worker wraps around the same way the ring buffer does.
+    ScopedStageTimer timer{m_profiler, ProfileStage::FILL};
+    auto& job = m_analysis_worker->job();
+    std::copy_n(m_ring_buffer.m_in_array.begin(), m_ring_buffer.size(), job.m_ring_samples.begin());
+    job.m_oldest_index = m_ring_buffer.current_index();
+    job.m_fft_size = m_ring_buffer.size();
+    job.m_analysis_window = m_analysis_window;
+    job.m_threshold = threshold;
+    job.m_max_entries = m_oscillators.partial_count();
+    m_analysis_worker->submit();
+}
+
+template <FloatingPt T, size_t BUFFER_SIZE>
+    requires(is_bounded_pow_two(BUFFER_SIZE))
+bool BufferManager<T, BUFFER_SIZE>::collect_analysis() noexcept
+{
+    const auto* result = m_analysis_worker->latest_result();
+    if (result == nullptr || result->m_fft_size != m_ring_buffer.size())
+    {
+        return false;
     }
+    // never more than the partial count, copying the valid entries only is cheap.
+    m_valid_entries = result->m_valid_entries;
+    m_peaks.assign(result->m_peaks, m_valid_entries);
+    return true;
 }
 } // namespace LBTS::Spectral
@@ -8,7 +8,9 @@
 
 #pragma once
 #include "SpctDomainSpecific.h"
+#include <algorithm>
 #include <array>
+#include <cmath>
 
 namespace LBTS::Spectral
 {
@@ -18,6 +20,14 @@ template <FloatingPt T, size_t BUFFER_SIZE>
     requires(is_bounded_pow_two(BUFFER_SIZE))
 class BufferManager;
 
+template <FloatingPt T, size_t BUFFER_SIZE, size_t MAX_CHANNELS>
+    requires(is_bounded_pow_two(BUFFER_SIZE) && MAX_CHANNELS > 0)
+class MultiChannelProcessor;
+
+template <FloatingPt T, size_t BUFFER_SIZE>
+    requires(is_bounded_pow_two(BUFFER_SIZE))
+class OfflineRenderer;
+
 /// @brief This is a circular buffer from which two instances will be used.
 /// 1. as input to the FFT
 /// 2. as output buffer from which the result will be read
@@ -33,8 +43,8 @@ struct CircularSampleBuffer
     ~CircularSampleBuffer() = default;
 
     /// @brief resizes the internal range the buffer works with (I know const is unnecessary here but I like it for
-    /// readability).
-    /// ON HOLD!
+    /// readability). The buffer gets cleared since the old samples don't form a frame of the new size.
+    /// @param i_range: New size, clipped to a power of two in the range of 1 .. MAX_BUFFER_SIZE.
     void resize_valid_range(const size_t i_range) noexcept;
 
     /// @brief as the name says, note that only values in the active valid range get cleared!
@@ -47,21 +57,75 @@ struct CircularSampleBuffer
     // T receive_output() const noexcept { return m_out_array[m_index]; }
 
     /// @brief advancing by one, this happens synchronousely for both buffers.
+    /// @return true if a new frame is complete (every hop size samples).
     bool advance() noexcept;
 
+    /// @brief Bulk version of fill_input + advance: copies a whole span in at most two pieces (before and after the
+    /// wrap), no branch per sample.
+    /// @param samples: Source of the span, may be nullptr to fill silence.
+    /// @param num_samples: Length of the span, up to the valid range.
+    /// @return true if the span ends on the start of a new frame. Frames completed within the span are not signaled,
+    /// so cut the input at samples_to_next_frame.
+    bool fill_span(const T* samples, const size_t num_samples) noexcept;
+
+    /// @brief Set the distance between two frames. With FULL a frame is signaled only when the buffer wraps.
+    void set_hop_size(const HopSize hop_size) noexcept;
+
+    /// @brief Shift the frame boundaries by a fraction of the hop (kept when the hop or the valid range changes). The
+    /// frame is always the valid range beginning at the current index, so any index can end a frame.
+    /// @param phase: 0 .. 1, wrapped otherwise.
+    void set_frame_phase(const double phase) noexcept;
+
+    [[nodiscard]] double frame_phase() const noexcept { return m_frame_phase; }
+
     [[nodiscard]] size_t current_index() const noexcept { return m_index; }
 
     [[nodiscard]] size_t size() const noexcept { return m_view_size; }
 
+    [[nodiscard]] size_t hop_size() const noexcept { return m_hop_mask + 1; }
+
+    /// @brief Samples that have to be filled in until the next frame is complete (1 .. hop size).
+    [[nodiscard]] size_t samples_to_next_frame() const noexcept
+    {
+        return m_hop_mask + 1 - ((m_index + m_frame_offset) & m_hop_mask);
+    }
+
+    /// @brief Cut a chunk into segments that end on a frame boundary at the latest and hand them to
+    /// process_segment(offset, size) one after the other. process_segment has to fill exactly size samples in (one
+    /// fill_span), the next segment is cut at the frame boundary after that.
+    /// @param num_samples: Length of the whole chunk.
+    template <typename SEGMENT_PROCESSOR>
+    void for_each_segment(const size_t num_samples, SEGMENT_PROCESSOR&& process_segment) const
+    {
+        size_t offset = 0;
+        while (offset < num_samples)
+        {
+            const size_t segment_size = std::min(num_samples - offset, samples_to_next_frame());
+            process_segment(offset, segment_size);
+            offset += segment_size;
+        }
+    }
+
     /// @note thought back and forth and came to the conclusion, that I preferred having a friend that knows what to
     /// do with the internal arrays than to allow reference getters for them (or make them public).
     /// That way access is limited and safety is increased. Only downside is the forward declaration...
     friend BufferManager<T, MAX_BUFFER_SIZE>;
+    template <FloatingPt U, size_t BUFFER_SIZE, size_t MAX_CHANNELS>
+        requires(is_bounded_pow_two(BUFFER_SIZE) && MAX_CHANNELS > 0)
+    friend class MultiChannelProcessor;
+    friend OfflineRenderer<T, MAX_BUFFER_SIZE>;
 
   private:
     size_t m_index{0};
     size_t m_view_size{MAX_BUFFER_SIZE};
-    ComplexArr<T, MAX_BUFFER_SIZE> m_in_array{0};
+    HopSize m_hop_size{HopSize::FULL};
+    // every index with (index & m_hop_mask) == 0 is the start of a new frame.
+    size_t m_hop_mask{MAX_BUFFER_SIZE - 1};
+    // a frame is complete at every index with ((index + m_frame_offset) & m_hop_mask) == 0.
+    double m_frame_phase{0};
+    size_t m_frame_offset{0};
+    // real samples only, they get packed into half as many complex numbers for the real input FFT.
+    alignas(64) std::array<T, MAX_BUFFER_SIZE> m_in_array{0};
     // std::array<T, MAX_BUFFER_SIZE> m_out_array{0};
 };
 
@@ -89,17 +153,57 @@ template <FloatingPt T, size_t MAX_BUFFER_SIZE>
 bool CircularSampleBuffer<T, MAX_BUFFER_SIZE>::advance() noexcept
 {
     ++m_index;
-    // transformation needs to be done when wrapping is needed.
-    const bool do_transformation = m_index == m_view_size;
     // mask with the flipped view size
     // m_index & ~m_view_size
     // 01101   & ~(10000) = 01101 & 01111 = 01101
     // 10000   & ~(10000) = 10000 & 01111 = 00000
     m_index &= ~m_view_size;
-    return do_transformation;
+    // transformation needs to be done every hop, with the full hop size this is exactly the wrap.
+    return ((m_index + m_frame_offset) & m_hop_mask) == 0;
+}
+
+template <FloatingPt T, size_t MAX_BUFFER_SIZE>
+    requires(is_bounded_pow_two(MAX_BUFFER_SIZE))
+bool CircularSampleBuffer<T, MAX_BUFFER_SIZE>::fill_span(const T* samples, const size_t num_samples) noexcept
+{
+    // the second piece is only non-empty if the span wraps around the end of the valid range.
+    const size_t first_piece = std::min(num_samples, m_view_size - m_index);
+    const size_t second_piece = num_samples - first_piece;
+    if (samples != nullptr)
+    {
+        std::copy_n(samples, first_piece, m_in_array.begin() + m_index);
+        std::copy_n(samples + first_piece, second_piece, m_in_array.begin());
+    }
+    else
+    {
+        std::fill_n(m_in_array.begin() + m_index, first_piece, static_cast<T>(0));
+        std::fill_n(m_in_array.begin(), second_piece, static_cast<T>(0));
+    }
+    m_index = (m_index + num_samples) & (m_view_size - 1);
+    return ((m_index + m_frame_offset) & m_hop_mask) == 0;
+}
+
+template <FloatingPt T, size_t MAX_BUFFER_SIZE>
+    requires(is_bounded_pow_two(MAX_BUFFER_SIZE))
+void CircularSampleBuffer<T, MAX_BUFFER_SIZE>::set_hop_size(const HopSize hop_size) noexcept
+{
+    m_hop_size = hop_size;
+    const size_t hop_samples = m_view_size >> static_cast<uint8_t>(hop_size);
+    // tiny buffers can't be divided any further, in that case every sample is a frame.
+    m_hop_mask = hop_samples > 0 ? hop_samples - 1 : 0;
+    set_frame_phase(m_frame_phase);
+}
+
+template <FloatingPt T, size_t MAX_BUFFER_SIZE>
+    requires(is_bounded_pow_two(MAX_BUFFER_SIZE))
+void CircularSampleBuffer<T, MAX_BUFFER_SIZE>::set_frame_phase(const double phase) noexcept
+{
+    m_frame_phase = phase - std::floor(phase);
+    // a boundary phase samples after the unshifted one: index + offset = 0 (mod hop) at index = phase.
+    const auto phase_samples = static_cast<size_t>(m_frame_phase * static_cast<double>(m_hop_mask + 1));
+    m_frame_offset = (m_hop_mask + 1 - phase_samples) & m_hop_mask;
 }
 
-// ON HOLD!
 template <FloatingPt T, size_t MAX_BUFFER_SIZE>
     requires(is_bounded_pow_two(MAX_BUFFER_SIZE))
 void CircularSampleBuffer<T, MAX_BUFFER_SIZE>::resize_valid_range(const size_t i_range) noexcept
@@ -108,10 +212,10 @@ void CircularSampleBuffer<T, MAX_BUFFER_SIZE>::resize_valid_range(const size_t i
     // allows (which is checked by is_power_of_two).
     if (i_range >= MAX_BUFFER_SIZE)
     {
-        return;
+        m_view_size = MAX_BUFFER_SIZE;
     }
     // valid range guaranteed by clipping to valid range.
-    if (!is_bounded_pow_two(i_range))
+    else if (!is_bounded_pow_two(i_range))
     {
         m_view_size = clip_to_lower_bounded_pow_two(i_range);
     }
@@ -119,5 +223,8 @@ void CircularSampleBuffer<T, MAX_BUFFER_SIZE>::resize_valid_range(const size_t i
     {
         m_view_size = i_range;
     }
+    // the index has to stay inside the view for advance to wrap correctly.
+    reset_buffers();
+    set_hop_size(m_hop_size);
 }
-} // namespace LBTS::Spectral
\ No newline at end of file
+} // namespace LBTS::Spectral
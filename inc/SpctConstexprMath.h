@@ -0,0 +1,111 @@
+/**
+ * Author: Lucas Scheidt
+ * Date: 14.10.26
+ *
+ * Description: Compile-time versions of the trigonometric functions needed for the lookup tables. std::sin and
+ * std::cos are not constexpr (yet), so the tables would have to be calculated at runtime in every instance otherwise.
+ */
+
+#pragma once
+#include "SpctDomainSpecific.h"
+#include <numbers>
+
+namespace LBTS::Spectral
+{
+/**
+ * @section this header contains:
+ * Function summary:
+ * - sin_taylor (only valid for |x| <= pi/4)
+ * - cos_taylor (only valid for |x| <= pi/4)
+ * - constexpr_sin
+ * - constexpr_cos
+ *
+ * @note
+ * The functions are calculated in double precision and narrowed afterwards, the error is in the range of a few ulp
+ * which is more than enough for the tables.
+ * They are NOT intended for the processing loop, use the std functions there.
+ */
+
+/// @brief Taylor series of the sine, converges fast enough for the reduced range of +-pi/4.
+constexpr double sin_taylor(const double value) noexcept
+{
+    const double squared = value * value;
+    double term = value;
+    double sum = value;
+    for (int order = 1; order <= 12; ++order)
+    {
+        term *= -squared / static_cast<double>((2 * order) * (2 * order + 1));
+        sum += term;
+    }
+    return sum;
+}
+
+/// @brief Taylor series of the cosine, converges fast enough for the reduced range of +-pi/4.
+constexpr double cos_taylor(const double value) noexcept
+{
+    const double squared = value * value;
+    double term = 1.0;
+    double sum = 1.0;
+    for (int order = 1; order <= 12; ++order)
+    {
+        term *= -squared / static_cast<double>((2 * order - 1) * (2 * order));
+        sum += term;
+    }
+    return sum;
+}
+
+/// @brief Reduce the value to the range of +-pi/4 around the closest multiple of pi/2.
+/// @param value: Angle in radians.
+/// @param quadrant: Out parameter, the multiple of pi/2 modulo 4.
+/// @return The remaining angle.
+constexpr double reduce_to_quadrant(const double value, int& quadrant) noexcept
+{
+    constexpr double half_pi = std::numbers::pi / 2.0;
+    const double scaled = value / half_pi;
+    const auto multiple = static_cast<long long>(scaled >= 0 ? scaled + 0.5 : scaled - 0.5);
+    quadrant = static_cast<int>(((multiple % 4) + 4) % 4);
+    return value - static_cast<double>(multiple) * half_pi;
+}
+
+/// @brief Compile-time sine.
+/// @tparam T: Type of the angle and the result.
+/// @param value: Angle in radians.
+template <FloatingPt T>
+constexpr T constexpr_sin(const T value) noexcept
+{
+    int quadrant = 0;
+    const double reduced = reduce_to_quadrant(static_cast<double>(value), quadrant);
+    switch (quadrant)
+    {
+    case 0:
+        return static_cast<T>(sin_taylor(reduced));
+    case 1:
+        return static_cast<T>(cos_taylor(reduced));
+    case 2:
+        return static_cast<T>(-sin_taylor(reduced));
+    default:
+        return static_cast<T>(-cos_taylor(reduced));
+    }
+}
+
+/// @brief Compile-time cosine.
+/// @tparam T: Type of the angle and the result.
+/// @param value: Angle in radians.
+template <FloatingPt T>
+constexpr T constexpr_cos(const T value) noexcept
+{
+    int quadrant = 0;
+    const double reduced = reduce_to_quadrant(static_cast<double>(value), quadrant);
+    switch (quadrant)
+    {
+    case 0:
+        return static_cast<T>(cos_taylor(reduced));
+    case 1:
+        return static_cast<T>(-sin_taylor(reduced));
+    case 2:
+        return static_cast<T>(-cos_taylor(reduced));
+    default:
+        return static_cast<T>(sin_taylor(reduced));
+    }
+}
+} // namespace LBTS::Spectral
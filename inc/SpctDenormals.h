@@ -0,0 +1,78 @@
+/**
+ * Author: Lucas Scheidt
+ * Date: 14.10.26
+ *
+ * Description: Scoped flush-to-zero of denormal numbers. When a signal fades out, the butterflies, the interpolation of
+ * the oscillators and their ramps run into denormals, which take a slow path in the FPU on most CPUs (the cost of the
+ * callback can rise tenfold). Flushed to zero they are inaudible and cost nothing.
+ */
+
+#pragma once
+#include <cstdint>
+#if defined(__SSE__) || defined(__x86_64__) || defined(_M_X64)
+#define SPCT_DENORMALS_SSE
+#include <xmmintrin.h>
+#elif defined(__aarch64__)
+#define SPCT_DENORMALS_AARCH64
+#elif defined(__arm__) && defined(__ARM_FP)
+#define SPCT_DENORMALS_ARM
+#endif
+
+namespace LBTS::Spectral
+{
+/// @brief Flushes denormal results (and on x86 denormal inputs) to zero until the end of the scope, the previous mode
+/// of the thread is restored afterwards, so it can be nested and doesn't leak into the host.
+/// x86: FTZ (bit 15) and DAZ (bit 6) of the MXCSR. ARM: FZ (bit 24) of the FPCR (AArch64) or the FPSCR (32 bit), which
+/// treats denormal inputs as zero as well. Does nothing on other platforms.
+/// @note The mode belongs to the thread, every thread that processes audio needs its own scope.
+class ScopedFlushDenormals
+{
+  public:
+#if defined(SPCT_DENORMALS_SSE) || defined(SPCT_DENORMALS_AARCH64) || defined(SPCT_DENORMALS_ARM)
+    static constexpr bool supported = true;
+#else
+    static constexpr bool supported = false;
+#endif
+
+    ScopedFlushDenormals() noexcept
+    {
+#if defined(SPCT_DENORMALS_SSE)
+        m_previous_mode = _mm_getcsr();
+        _mm_setcsr(m_previous_mode | flush_to_zero_bit | denormals_are_zero_bit);
+#elif defined(SPCT_DENORMALS_AARCH64)
+        asm volatile("mrs %0, fpcr" : "=r"(m_previous_mode));
+        asm volatile("msr fpcr, %0" : : "r"(m_previous_mode | flush_to_zero_bit));
+#elif defined(SPCT_DENORMALS_ARM)
+        asm volatile("vmrs %0, fpscr" : "=r"(m_previous_mode));
+        asm volatile("vmsr fpscr, %0" : : "r"(m_previous_mode | flush_to_zero_bit));
+#endif
+    }
+
+    ~ScopedFlushDenormals() noexcept
+    {
+#if defined(SPCT_DENORMALS_SSE)
+        _mm_setcsr(m_previous_mode);
+#elif defined(SPCT_DENORMALS_AARCH64)
+        asm volatile("msr fpcr, %0" : : "r"(m_previous_mode));
+#elif defined(SPCT_DENORMALS_ARM)
+        asm volatile("vmsr fpscr, %0" : : "r"(m_previous_mode));
+#endif
+    }
+
+    ScopedFlushDenormals(const ScopedFlushDenormals&) = delete;
+    ScopedFlushDenormals& operator=(const ScopedFlushDenormals&) = delete;
+
+  private:
+#if defined(SPCT_DENORMALS_SSE)
+    static constexpr uint32_t flush_to_zero_bit = 1U << 15;
+    static constexpr uint32_t denormals_are_zero_bit = 1U << 6;
+    uint32_t m_previous_mode = 0;
+#elif defined(SPCT_DENORMALS_AARCH64)
+    static constexpr uint64_t flush_to_zero_bit = uint64_t{1} << 24;
+    uint64_t m_previous_mode = 0;
+#elif defined(SPCT_DENORMALS_ARM)
+    static constexpr uint32_t flush_to_zero_bit = 1U << 24;
+    uint32_t m_previous_mode = 0;
+#endif
+};
+} // namespace LBTS::Spectral
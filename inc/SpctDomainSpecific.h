@@ -8,7 +8,9 @@
 
 #pragma once
 #include <algorithm>
+#include <array>
 #include <complex>
+#include <cstdint>
 #include <numbers>
 
 namespace LBTS::Spectral
@@ -50,14 +52,18 @@ namespace LBTS::Spectral
  * - degree_of_pow_two_value
  * - clip_to_lower_pow_two
  * - clip_to_lower_bounded_pow_two
+ * - partial_capacity_of
  *
  * Struct summary:
  * - BoundedPowTwo (value access with BoundedPowTwo_v)
  * - BoundedDegTwo (value access with BoundedDegTwo_v)
  *
  * Type aliases:
- * - IndexValueArr: array of index value pairs
  * - ComplexArr: array containing complex numbers
+ *
+ * Struct summary (data):
+ * - PeakArr: fixed point bins and magnitudes of the analysed peaks in separate arrays
+ * - SplitComplexArr: complex numbers with separate arrays for the real and imaginary parts
  */
 
 /// @brief This concept enforces the use of floating point types (float, double, long double)
@@ -73,12 +79,62 @@ enum class OscWaveform
     SQUARE
 };
 
+/// @brief How a wavetable oscillator reads between two table entries. The cubic Hermite interpolation reads two more
+/// entries but its error falls much faster with the table size, so a smaller table (less cache) does the same job.
+enum class WTInterpolation
+{
+    LINEAR,
+    CUBIC_HERMITE
+};
+
+/// @brief Window that gets applied to a frame before it is transformed.
+enum class AnalysisWindow
+{
+    RECTANGULAR,
+    HANN,
+    BLACKMAN
+};
+
+/// @brief Distance between two analysed frames relative to the FFT size. With anything but FULL the frames overlap
+/// and the spectrum (and therefore the oscillators) gets updated more often without a larger FFT.
+/// The value of an entry is the degree by which the FFT size gets divided.
+enum class HopSize : uint8_t
+{
+    FULL = 0,
+    HALF = 1,
+    QUARTER = 2,
+    EIGHTH = 3
+};
+
+/// @brief How the channels of a multi-channel track get analysed.
+/// INDEPENDENT: every channel is analysed and resynthesized on its own.
+/// LINKED: one analysis of the mean of all channels drives every channel.
+/// MID_SIDE: mid and side of a stereo pair are analysed and resynthesized, the output gets decoded back to left and
+/// right (falls back to INDEPENDENT for anything but two channels).
+enum class ChannelLink
+{
+    INDEPENDENT,
+    LINKED,
+    MID_SIDE
+};
+
+/// @brief How the peaks get turned back into audio.
+/// OSCILLATOR_BANK: one wavetable oscillator per partial (every waveform), the cost grows with partials * samples.
+/// INVERSE_FFT: overlapped grains of one inverse FFT per hop (sines only), the cost barely depends on the partials.
+enum class ResynthesisEngine
+{
+    OSCILLATOR_BANK,
+    INVERSE_FFT
+};
+
 /// @brief Plugin specific constants
 constexpr uint32_t min_pow_two_degree = 0;
 constexpr uint32_t max_pow_two_degree = 11;
 constexpr uint32_t min_num_of_samples = 1;
 constexpr uint32_t max_num_of_samples = 2048;
+// default number of resynthesized partials, can be raised at runtime up to max_partials.
 constexpr uint32_t max_oscillators = 10;
+constexpr uint32_t max_partials = 512;
 template <FloatingPt T>
 constexpr T two_pi = std::numbers::pi_v<T> * 2;
 
@@ -153,14 +209,61 @@ constexpr T pow_two_value_of_degree(const T degree) noexcept
     return correct_one << degree;
 }
 
-/// @brief Alias for an array that contains pairs of indices and values.
-/// Intended for the bin numbers (frequencies) and the respective magnitudes of a fourier transformed signal.
+/// @brief Number of partials an FFT of the given size can provide at most, there can't be more peaks than bins.
+/// @param fft_size: Has to be a bounded power of two.
+constexpr size_t partial_capacity_of(const size_t fft_size) noexcept
+{
+    return std::min<size_t>(max_partials, fft_size >> 1);
+}
+
+/// @brief The peaks of an analysed frame: the bin numbers (frequencies) and the respective magnitudes in separate
+/// arrays (structure of arrays). Only the peaks that get resynthesized are kept, so it is sized to the partial capacity
+/// instead of N/2 and the first entries (the ones that actually play) share a few cache lines.
+/// The bins are unsigned 32 bit fixed point, so interpolated peaks can sit between two bins. The largest FFT has
+/// 2^(max_pow_two_degree - 1) bins, the remaining bits are the fraction (steps of 2^-22 bin, finer than a float bin).
 /// @tparam T: Type of the magnitudes (typaclly float or double).
-/// @tparam N_SAMPLES: Number of samples that this array contains (typically half the size of the original FFT array).
-/// Has to be a power of two!
-template <FloatingPt T, size_t N_SAMPLES>
-    requires(is_bounded_pow_two(N_SAMPLES))
-using BinMagArr = std::array<std::pair<size_t, T>, N_SAMPLES>;
+/// @tparam CAPACITY: Maximum number of peaks (typically the partial capacity of the resynthesis).
+template <FloatingPt T, size_t CAPACITY>
+struct PeakArr
+{
+    static constexpr size_t capacity = CAPACITY;
+    static constexpr uint32_t bin_fraction_bits = 32 - (max_pow_two_degree - 1);
+
+    /// @brief Fixed point representation of a (non negative) bin, rounded to the nearest step.
+    [[nodiscard]] static constexpr uint32_t fixed_bin(const T bin) noexcept
+    {
+        return static_cast<uint32_t>(bin * static_cast<T>(1U << bin_fraction_bits) + static_cast<T>(0.5));
+    }
+
+    [[nodiscard]] constexpr T bin(const size_t entry) const noexcept
+    {
+        return static_cast<T>(m_bins[entry]) / static_cast<T>(1U << bin_fraction_bits);
+    }
+
+    /// @brief The bin without its fraction.
+    [[nodiscard]] constexpr size_t whole_bin(const size_t entry) const noexcept
+    {
+        return m_bins[entry] >> bin_fraction_bits;
+    }
+
+    [[nodiscard]] constexpr T magnitude(const size_t entry) const noexcept { return m_magnitudes[entry]; }
+
+    constexpr void set(const size_t entry, const T bin, const T magnitude) noexcept
+    {
+        m_bins[entry] = fixed_bin(bin);
+        m_magnitudes[entry] = magnitude;
+    }
+
+    /// @brief Take over the first num_entries peaks of another frame (the rest stays untouched).
+    constexpr void assign(const PeakArr& other, const size_t num_entries) noexcept
+    {
+        std::copy_n(other.m_bins.begin(), num_entries, m_bins.begin());
+        std::copy_n(other.m_magnitudes.begin(), num_entries, m_magnitudes.begin());
+    }
+
+    std::array<uint32_t, CAPACITY> m_bins{};
+    std::array<T, CAPACITY> m_magnitudes{};
+};
 
 /// @brief Alias for an array containing complex numbers (basically just for conveniance) will contain values of FFT.
 /// @tparam T: Type of the complex numbers.
@@ -169,6 +272,18 @@ template <FloatingPt T, size_t N_SAMPLES>
     requires(is_bounded_pow_two(N_SAMPLES))
 using ComplexArr = std::array<std::complex<T>, N_SAMPLES>;
 
+/// @brief Complex numbers in a split layout (structure of arrays), one array for the real and one for the imaginary
+/// parts. This is the working layout of the SIMD kernels since one register can be filled with a single load.
+/// @tparam T: Type of the complex numbers.
+/// @tparam N_SAMPLES: Number of samples, has to be a power of two.
+template <FloatingPt T, size_t N_SAMPLES>
+    requires(is_bounded_pow_two(N_SAMPLES))
+struct SplitComplexArr
+{
+    alignas(64) std::array<T, N_SAMPLES> m_real{};
+    alignas(64) std::array<T, N_SAMPLES> m_imag{};
+};
+
 /// @brief This struct is mainly used as a security check to be sure to initialize values according to a real
 /// power of two that is in the valid range of the samples used by this plugin. To assure that the maximum is always
 /// a valid value, the type given has to have at least 16 Bit.
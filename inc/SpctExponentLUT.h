@@ -6,98 +6,217 @@
  */
 #pragma once
 
+#include "SpctConstexprMath.h"
 #include "SpctDomainSpecific.h"
+#include <array>
 #include <complex>
+#include <numbers>
+#include <span>
+#include <stdexcept>
 
 namespace LBTS::Spectral
 {
 
-template <FloatingPt T, size_t ELEMENTS>
-    requires(is_bounded_pow_two(ELEMENTS))
-struct ExponentArray
+/// @brief Lookup table of all twiddle factors the radix-2 FFT needs for every allowed transformation size.
+/// The stages are stored one after the other in a single contiguous array that is generated at compile time:
+/// stage s contains W_(2^(s+1))^j = exp(-i pi j / 2^s) for j < 2^s at the offset 2^s - 1.
+/// So 2^0 + 2^1 + ... + 2^(max_pow_two_degree - 1) = max_num_of_samples - 1 values in total, stored in T.
+/// Since the table is a static constexpr member, every instance shares the same (read only) values.
+/// @tparam T: Type of the complex numbers.
+template <FloatingPt T>
+class ExponentLUT
 {
-    ExponentArray()
+  public:
+    /// @brief Stage s is needed for the butterflies of the size 2^(s+1).
+    static constexpr size_t num_stages = max_pow_two_degree;
+    static constexpr size_t num_twiddles = pow_two_value_of_degree<size_t>(num_stages) - 1;
+
+    ExponentLUT() = default;
+    ~ExponentLUT() = default;
+
+    /// @brief View on the twiddles of one stage.
+    /// WARNING! To have the maximum speed available there is NO CHECK of the stage index.
+    [[nodiscard]] static constexpr std::span<const std::complex<T>> stage(const size_t stage_index) noexcept
+    {
+        const size_t stage_size = pow_two_value_of_degree(stage_index);
+        return {m_twiddles.data() + stage_size - 1, stage_size};
+    }
+
+    /// @brief Same as stage but with a range check.
+    [[nodiscard]] static std::span<const std::complex<T>> stage_at(const size_t stage_index)
     {
-        using namespace std::complex_literals;
-        const T resolution = static_cast<T>(1) / ELEMENTS;
-        for (size_t index = 0; index < ELEMENTS; ++index)
+        if (stage_index >= num_stages)
         {
-            T rising_multiplier =index * resolution;
-            m_array_n[index] = std::exp(-1i * std::numbers::pi_v<T> * rising_multiplier);
+            throw std::out_of_range("Tried to access an omega stage that is out of range of the current table!");
         }
+        return stage(stage_index);
     }
-    ExponentArray(const ExponentArray&) = delete;
-    ExponentArray(ExponentArray&&) = delete;
-    ExponentArray& operator=(const ExponentArray&) = delete;
-    ExponentArray& operator=(const ExponentArray&&) = delete;
 
-    /// @brief WARNING! To have the maximum speed available there is NO CHECK with the bracket operator.
-    [[nodiscard]] std::complex<T> operator[](const size_t ndx) const { return m_array_n[ndx]; }
-    [[nodiscard]] std::complex<T> at(const size_t index) const
+  private:
+    static constexpr std::array<std::complex<T>, num_twiddles> m_twiddles = []
     {
-        if (index >= ELEMENTS)
+        std::array<std::complex<T>, num_twiddles> twiddles{};
+        for (size_t stage_index = 0; stage_index < num_stages; ++stage_index)
         {
-            throw std::out_of_range("Tried to access an omega value that is out of range of the current array!");
+            const size_t stage_size = pow_two_value_of_degree(stage_index);
+            for (size_t index = 0; index < stage_size; ++index)
+            {
+                // calculated in double precision and narrowed afterwards to keep rounding errors of float small.
+                const double angle = std::numbers::pi * static_cast<double>(index) / static_cast<double>(stage_size);
+                twiddles[stage_size - 1 + index] = {static_cast<T>(constexpr_cos(angle)),
+                                                    static_cast<T>(-constexpr_sin(angle))};
+            }
         }
-        return m_array_n[index];
+        return twiddles;
+    }();
+};
+
+/// @brief Compile-time permutation table for the bit-reversal step of the FFT. Rebuilding every index bit by bit in
+/// each transformation is unnecessary since the permutation only depends on the degree.
+/// This is a compile-time struct and NOT intended to be an object (like BoundedPowTwo).
+/// @tparam DEG_TWO: Degree of the power of two of the transformation size.
+template <size_t DEG_TWO>
+    requires(is_bounded_degree(DEG_TWO))
+struct BitReversalTable
+{
+    BitReversalTable() = delete;
+    static constexpr auto value = []
+    {
+        // uint16_t is sufficient since max_num_of_samples is 2048.
+        std::array<uint16_t, pow_two_value_of_degree(DEG_TWO)> table{};
+        for (size_t array_index = 0; array_index < table.size(); ++array_index)
+        {
+            size_t reversed = 0;
+            for (size_t degree_index = 0; degree_index < DEG_TWO; ++degree_index)
+            {
+                reversed = (reversed << 1) | ((array_index >> degree_index) & 1);
+            }
+            table[array_index] = static_cast<uint16_t>(reversed);
+        }
+        return table;
+    }();
+};
+
+/// @brief For conveniance the table can be accessed directly with the "_v" suffix.
+template <size_t DEG_TWO>
+constexpr const auto& BitReversalTable_v = BitReversalTable<DEG_TWO>::value;
+
+/// @brief Compile-time twiddle factors for the radix-4 FFT engine of one specific transformation size.
+/// Every radix-4 stage with a quarter length of m needs W^i, W^2i and W^3i (W = exp(-2 pi i / 4m)) for i < m, which
+/// are stored interleaved so that one butterfly reads three neighbouring values.
+/// If DEG_TWO is odd, the engine starts with a single (twiddle free) radix-2 stage, so the first quarter length is 2
+/// instead of 1.
+/// @tparam T: Type of the complex numbers.
+/// @tparam DEG_TWO: Degree of the power of two of the transformation size.
+template <FloatingPt T, size_t DEG_TWO>
+    requires(is_bounded_degree(DEG_TWO))
+struct RadixFourLUT
+{
+    static constexpr size_t num_samples = pow_two_value_of_degree(DEG_TWO);
+    static constexpr size_t first_quarter = (DEG_TWO & 1) ? 2 : 1;
+    static constexpr size_t num_twiddles = []
+    {
+        size_t count = 0;
+        for (size_t quarter = first_quarter; quarter * 4 <= num_samples; quarter <<= 2)
+        {
+            count += 3 * quarter;
+        }
+        return count;
+    }();
+
+    /// @brief WARNING! To have the maximum speed available there is NO CHECK with the bracket operator.
+    [[nodiscard]] constexpr const std::complex<T>& operator[](const size_t index) const noexcept
+    {
+        return m_twiddles[index];
     }
 
   private:
-    ComplexArr<T, ELEMENTS> m_array_n{};
+    // at least one element so that the degrees 0 and 1 (no radix-4 stage at all) are still a valid std::array.
+    // Derived from the ExponentLUT stages at compile time: W_4q^x with x >= 2q is -W_4q^(x-2q).
+    static constexpr std::array<std::complex<T>, (num_twiddles > 0 ? num_twiddles : 1)> m_twiddles = []
+    {
+        std::array<std::complex<T>, (num_twiddles > 0 ? num_twiddles : 1)> twiddles{};
+        size_t offset = 0;
+        // the stage with butterflies of size 4q
+        size_t stage_index = degree_of_pow_two_value<size_t>(first_quarter) + 1;
+        for (size_t quarter = first_quarter; quarter * 4 <= num_samples; quarter <<= 2, stage_index += 2)
+        {
+            const auto stage_twiddles = ExponentLUT<T>::stage(stage_index);
+            for (size_t index = 0; index < quarter; ++index)
+            {
+                for (size_t power = 1; power <= 3; ++power)
+                {
+                    const size_t exponent = power * index;
+                    twiddles[offset++] = exponent < 2 * quarter
+                                             ? stage_twiddles[exponent]
+                                             : std::complex<T>{-stage_twiddles[exponent - 2 * quarter].real(),
+                                                               -stage_twiddles[exponent - 2 * quarter].imag()};
+                }
+            }
+        }
+        return twiddles;
+    }();
 };
 
-template <FloatingPt T>
-class ExponentLUT
+/// @brief The twiddles of RadixFourLUT in a split layout for the SIMD engine. Per stage with the quarter length q the
+/// values are stored as [Re(W^i)] [Im(W^i)] [Re(W^2i)] [Im(W^2i)] [Re(W^3i)] [Im(W^3i)], each of them q values long,
+/// so that consecutive butterflies read consecutive values.
+/// @tparam T: Type of the complex numbers.
+/// @tparam DEG_TWO: Degree of the power of two of the transformation size.
+template <FloatingPt T, size_t DEG_TWO>
+    requires(is_bounded_degree(DEG_TWO))
+struct SoaRadixFourLUT
 {
-  public:
-    ExponentLUT() = default;
-    ExponentLUT(const ExponentLUT& to_copy) = delete;
-    ExponentLUT& operator=(const ExponentLUT& to_copy) = delete;
-    ExponentLUT(ExponentLUT&& to_move) = delete;
-    ExponentLUT& operator=(ExponentLUT&& to_move) = delete;
-    ~ExponentLUT() = default;
-    /// @note just a bit of safety, overhead probably tolerable due to sparse call of function.
-    void choose_array(const size_t array_index) noexcept { m_act_array_index = std::clamp<size_t>(array_index, 0, 9); }
-    std::complex<T> operator[](const size_t index) const noexcept
+    static constexpr size_t num_values = 2 * RadixFourLUT<T, DEG_TWO>::num_twiddles;
+
+    /// @brief First value of the stage that starts at the given offset (offset in values, not complex numbers).
+    [[nodiscard]] const T* data(const size_t offset) const noexcept { return m_values.data() + offset; }
+
+  private:
+    alignas(64) static constexpr std::array<T, (num_values > 0 ? num_values : 1)> m_values = []
     {
-        switch (m_act_array_index)
+        constexpr RadixFourLUT<T, DEG_TWO> interleaved_lut{};
+        std::array<T, (num_values > 0 ? num_values : 1)> values{};
+        size_t offset = 0;
+        for (size_t quarter = RadixFourLUT<T, DEG_TWO>::first_quarter; quarter * 4 <= (1u << DEG_TWO);
+             quarter <<= 2)
         {
-        case 0:
-            return m_array_2p0[index];
-        case 1:
-            return m_array_2p1[index];
-        case 2:
-            return m_array_2p2[index];
-        case 3:
-            return m_array_2p3[index];
-        case 4:
-            return m_array_2p4[index];
-        case 5:
-            return m_array_2p5[index];
-        case 6:
-            return m_array_2p6[index];
-        case 7:
-            return m_array_2p7[index];
-        case 8:
-            return m_array_2p8[index];
-        case 9:
-            return m_array_2p9[index];
-        default:
-            return std::complex<T>{0};
+            for (size_t index = 0; index < quarter; ++index)
+            {
+                for (size_t power = 0; power < 3; ++power)
+                {
+                    const auto& twiddle = interleaved_lut[offset / 2 + 3 * index + power];
+                    values[offset + 2 * power * quarter + index] = twiddle.real();
+                    values[offset + (2 * power + 1) * quarter + index] = twiddle.imag();
+                }
+            }
+            offset += 6 * quarter;
         }
+        return values;
+    }();
+};
+
+/// @brief Everything the real input FFT of N samples needs: the twiddles of the N/2 point complex FFT and the post
+/// twiddles W_N^k (k < N/4) that split the packed spectrum into the spectrum of the real signal (both are views on the
+/// compile-time tables).
+/// @tparam T: Type of the complex numbers.
+/// @tparam DEG_TWO: Degree of the power of two of the number of real samples (at least 1).
+template <FloatingPt T, size_t DEG_TWO>
+    requires(is_bounded_degree(DEG_TWO) && DEG_TWO >= 1)
+struct RealFourierLUT
+{
+    static constexpr size_t num_samples = pow_two_value_of_degree(DEG_TWO);
+
+    /// @brief WARNING! No range check, returns W_N^index (index < N/4).
+    [[nodiscard]] static constexpr const std::complex<T>& split_twiddle(const size_t index) noexcept
+    {
+        // W_N^k is part of the last stage of the N point radix-2 transformation.
+        return ExponentLUT<T>::stage(DEG_TWO - 1)[index];
     }
 
-  private:
-    size_t m_act_array_index = 0;
-    ExponentArray<double, 1> m_array_2p0{};
-    ExponentArray<double, 2> m_array_2p1{};
-    ExponentArray<double, 4> m_array_2p2{};
-    ExponentArray<double, 8> m_array_2p3{};
-    ExponentArray<double, 16> m_array_2p4{};
-    ExponentArray<double, 32> m_array_2p5{};
-    ExponentArray<double, 64> m_array_2p6{};
-    ExponentArray<double, 128> m_array_2p7{};
-    ExponentArray<double, 256> m_array_2p8{};
-    ExponentArray<double, 512> m_array_2p9{};
+    /// @brief Twiddles of the inner N/2 point complex transformation.
+    const RadixFourLUT<T, DEG_TWO - 1> m_half_lut{};
+    /// @brief The same in the layout of the SIMD engine.
+    const SoaRadixFourLUT<T, DEG_TWO - 1> m_half_soa_lut{};
 };
-} // namespace LBTS::Spectral
\ No newline at end of file
+} // namespace LBTS::Spectral
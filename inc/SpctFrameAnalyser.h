@@ -0,0 +1,338 @@
+/**
+ * Author: Lucas Scheidt
+ * Date: 14.10.26
+ *
+ * Description: Analysis of one frame (window, real FFT, peak picking) for every FFT size between a minimum and a
+ * maximum. Used by the BufferManager on the audio thread and by the AnalysisWorker in the background.
+ */
+
+#pragma once
+#include "SpctAnalysisWindows.h"
+#include "SpctDomainSpecific.h"
+#include "SpctExponentLUT.h"
+#include "SpctProcessingFunctions.h"
+#include "SpctProfiler.h"
+#include <algorithm>
+#include <array>
+#include <utility>
+#include <variant>
+
+namespace LBTS::Spectral
+{
+/// @brief Everything the analysis of one frame size needs: the twiddles and the working arrays of exactly that size.
+/// @tparam T: Type of the samples.
+/// @tparam DEG_TWO: Degree of the power of two of the frame size.
+template <FloatingPt T, size_t DEG_TWO>
+    requires(is_bounded_degree(DEG_TWO) && DEG_TWO >= 1)
+struct FrameKernel
+{
+    static constexpr size_t num_samples = pow_two_value_of_degree(DEG_TWO);
+
+    /// @brief Window, transform and pick the peaks of the latest frame. A frame that can't have a bin above the
+    /// threshold (see is_silent_frame) skips the transform and the peak picking, it simply has no peaks then. With
+    /// zero valid entries ResynthOscs fades its partials out over the hop (see ResynthOscs::tune_oscillators).
+    /// @param ring_samples: The ring buffer, its valid range has to be num_samples.
+    /// @param oldest_index: Index of the oldest sample of the ring buffer (= first sample of the frame).
+    /// @param profiler: Gets the cost of the transform (FFT) and the peak picking (PEAK_SELECT).
+    /// @return The number of valid entries in peaks.
+    template <size_t RING_SIZE, size_t CAPACITY, typename PROFILER = StageProfiler<false>>
+    size_t analyse(const std::array<T, RING_SIZE>& ring_samples, const size_t oldest_index,
+                   const AnalysisWindow analysis_window, PeakArr<T, CAPACITY>& peaks, const T threshold,
+                   const size_t max_entries, PROFILER&& profiler = PROFILER{}) noexcept
+    {
+        {
+            ScopedStageTimer timer{profiler, ProfileStage::FFT};
+            const T energy = pack_real_frame<T, DEG_TWO>(
+                ring_samples, oldest_index, analysis_window_table<T, num_samples>(analysis_window), m_spectrum);
+            if (is_silent_energy<T, num_samples>(energy, threshold))
+            {
+                return 0;
+            }
+            spct_real_fourier_transform<T, DEG_TWO>(m_spectrum, m_split_spectrum, m_real_fourier_lut);
+        }
+        ScopedStageTimer timer{profiler, ProfileStage::PEAK_SELECT};
+        return calculate_peak_map<T, num_samples>(m_spectrum, peaks, threshold, max_entries);
+    }
+
+    /// @brief The window and the packing of the frame take the first steps of the incremental analysis, half of the
+    /// frame each (the silence check comes with the last of them).
+    static constexpr size_t num_pack_steps = 2;
+
+    /// @brief Steps of the incremental analysis: the packing, the bit-reversed gather, every butterfly pass, the split
+    /// into the real spectrum and the peak picking. Each step is about N/2 operations (the peak picking a bit more).
+    static constexpr size_t num_analysis_steps = num_pack_steps + num_butterfly_passes_v<DEG_TWO - 1> + 3;
+
+    /// @brief Start an analysis that is done step by step (analysis_step) instead of all at once. Only remembers where
+    /// the frame is, nothing gets packed yet: the ring buffer has to stay untouched until the frame is packed, so the
+    /// caller packs the part it is about to overwrite first (pack_frame_until). A silent frame (see analyse) is done
+    /// with the last packing step.
+    template <size_t RING_SIZE>
+    void begin_analysis(const std::array<T, RING_SIZE>& ring_samples, const size_t oldest_index,
+                        const AnalysisWindow analysis_window, const T threshold, const size_t max_entries) noexcept
+    {
+        m_ring_samples = ring_samples.data();
+        m_oldest_index = oldest_index;
+        m_window = &analysis_window_table<T, num_samples>(analysis_window);
+        m_packed_samples = 0;
+        m_energy = 0;
+        m_threshold = threshold;
+        m_max_entries = max_entries;
+        m_next_step = 0;
+    }
+
+    /// @brief Window and pack the frame of the pending analysis up to (at least) its sample num_frame_samples, nothing
+    /// is done twice. Bounded by num_frame_samples, so a caller that packs only what it is about to overwrite never
+    /// does more than the size of its copy.
+    void pack_frame_until(const size_t num_frame_samples) noexcept
+    {
+        const size_t end_packed = std::min((num_frame_samples + 1) >> 1, num_samples >> 1);
+        if (m_ring_samples == nullptr || end_packed <= m_packed_samples)
+        {
+            return;
+        }
+        m_energy += pack_real_frame_part<T, DEG_TWO>(
+            m_ring_samples, m_oldest_index, *m_window, m_spectrum, m_packed_samples, end_packed);
+        m_packed_samples = end_packed;
+    }
+
+    /// @brief Do the next step of the analysis started by begin_analysis.
+    /// @param valid_entries: Out parameter, set after the last step only.
+    /// @param profiler: Gets the cost of the step, the last one is PEAK_SELECT, all others FFT.
+    /// @return true if that was the last step (peaks is only written then).
+    template <size_t CAPACITY, typename PROFILER = StageProfiler<false>>
+    bool analysis_step(PeakArr<T, CAPACITY>& peaks, size_t& valid_entries,
+                       PROFILER&& profiler = PROFILER{}) noexcept
+    {
+        constexpr size_t last_pass = num_pack_steps + num_butterfly_passes_v<DEG_TWO - 1>;
+        const size_t step = m_next_step++;
+        ScopedStageTimer timer{profiler, step == last_pass + 2 ? ProfileStage::PEAK_SELECT : ProfileStage::FFT};
+        if (step < num_pack_steps)
+        {
+            pack_frame_until((step + 1) * num_samples / num_pack_steps);
+            if (step + 1 == num_pack_steps && is_silent_energy<T, num_samples>(m_energy, m_threshold))
+            {
+                m_next_step = num_analysis_steps;
+                valid_entries = 0;
+                return true;
+            }
+        }
+        else if (step == num_pack_steps)
+        {
+            gather_bit_reversed<T, DEG_TWO - 1>(m_spectrum, m_split_spectrum);
+        }
+        else if (step <= last_pass)
+        {
+            split_butterfly_pass<T, DEG_TWO - 1>(
+                m_split_spectrum, m_real_fourier_lut.m_half_soa_lut, step - num_pack_steps - 1);
+        }
+        else if (step == last_pass + 1)
+        {
+            scatter_split<T, DEG_TWO - 1>(m_split_spectrum, m_spectrum);
+            split_real_spectrum<T, DEG_TWO>(m_spectrum, m_real_fourier_lut);
+        }
+        else if (step == last_pass + 2)
+        {
+            valid_entries = calculate_peak_map<T, num_samples>(m_spectrum, peaks, m_threshold, m_max_entries);
+            return true;
+        }
+        return false;
+    }
+
+    [[nodiscard]] bool analysis_pending() const noexcept { return m_next_step < num_analysis_steps; }
+
+    RealFourierLUT<T, DEG_TWO> m_real_fourier_lut{};
+    // bins 0 .. N/2-1 of the real input FFT.
+    ComplexArr<T, (num_samples >> 1)> m_spectrum{};
+    // working array of the SIMD engine.
+    SplitComplexArr<T, (num_samples >> 1)> m_split_spectrum{};
+    // state of the incremental analysis, nothing pending by default. The frame stays in the ring buffer of the caller
+    // until it is packed.
+    size_t m_next_step = num_analysis_steps;
+    const T* m_ring_samples = nullptr;
+    size_t m_oldest_index = 0;
+    const std::array<T, num_samples>* m_window = nullptr;
+    size_t m_packed_samples = 0;
+    T m_energy = 0;
+    T m_threshold = 1;
+    size_t m_max_entries = 0;
+};
+
+/// @brief Holds the kernel of the current FFT size, one alternative per size between MIN_FFT_SIZE and MAX_FFT_SIZE, so
+/// it only takes the space of the largest one. Used by the FrameAnalyser and the MultiChannelProcessor.
+/// @tparam KERNEL: Kernel of one frame size, the parameter is the degree of the power of two.
+template <template <size_t> typename KERNEL, size_t MIN_FFT_SIZE, size_t MAX_FFT_SIZE>
+    requires(is_bounded_pow_two(MIN_FFT_SIZE) && is_bounded_pow_two(MAX_FFT_SIZE) && MIN_FFT_SIZE <= MAX_FFT_SIZE)
+class FftSizedKernel
+{
+  public:
+    static constexpr size_t min_degree = degree_of_pow_two_value(MIN_FFT_SIZE);
+    static constexpr size_t num_fft_sizes = degree_of_pow_two_value(MAX_FFT_SIZE) - min_degree + 1;
+
+    /// @brief Construct the kernel of another size in place (nothing gets allocated). Does nothing if the size stays.
+    /// @param fft_size: A power of two, clamped to the range of MIN_FFT_SIZE .. MAX_FFT_SIZE.
+    void select_fft_size(const size_t fft_size) noexcept
+    {
+        const size_t degree = degree_of_pow_two_value(std::clamp(fft_size, MIN_FFT_SIZE, MAX_FFT_SIZE));
+        // emplace needs the index at compile time, so it goes through a table.
+        static constexpr auto kernel_emplacers = []<size_t... OFFSETS>(std::index_sequence<OFFSETS...>)
+        {
+            return std::array<void (*)(Kernels&) noexcept, num_fft_sizes>{
+                [](Kernels& kernels) noexcept { kernels.template emplace<OFFSETS>(); }...};
+        }(std::make_index_sequence<num_fft_sizes>{});
+        if (m_kernels.index() != degree - min_degree)
+        {
+            kernel_emplacers[degree - min_degree](m_kernels);
+        }
+    }
+
+    [[nodiscard]] size_t fft_size() const noexcept { return MIN_FFT_SIZE << m_kernels.index(); }
+
+    /// @brief Index of the current size, 0 for MIN_FFT_SIZE (for dispatch tables).
+    [[nodiscard]] size_t index() const noexcept { return m_kernels.index(); }
+
+    /// @brief Call visitor with the kernel of the current size.
+    template <typename VISITOR>
+    decltype(auto) visit(VISITOR&& visitor)
+    {
+        return std::visit(std::forward<VISITOR>(visitor), m_kernels);
+    }
+
+    template <typename VISITOR>
+    decltype(auto) visit(VISITOR&& visitor) const
+    {
+        return std::visit(std::forward<VISITOR>(visitor), m_kernels);
+    }
+
+    /// @brief The kernel of a size that is known to be the current one (no check).
+    template <size_t DEG_TWO>
+    [[nodiscard]] KERNEL<DEG_TWO>& get() noexcept
+    {
+        return *std::get_if<DEG_TWO - min_degree>(&m_kernels);
+    }
+
+  private:
+    template <typename OFFSETS>
+    struct Alternatives;
+
+    template <size_t... OFFSETS>
+    struct Alternatives<std::index_sequence<OFFSETS...>>
+    {
+        using type = std::variant<KERNEL<min_degree + OFFSETS>...>;
+    };
+
+    using Kernels = typename Alternatives<std::make_index_sequence<num_fft_sizes>>::type;
+
+    // the largest alternative is the default.
+    Kernels m_kernels{std::in_place_index<num_fft_sizes - 1>};
+};
+
+/// @brief Holds the kernel of the current FFT size and dispatches to it.
+/// @tparam T: Type of the samples.
+/// @tparam MIN_FFT_SIZE: Smallest selectable FFT size.
+/// @tparam MAX_FFT_SIZE: Largest selectable FFT size (and the default).
+template <FloatingPt T, size_t MIN_FFT_SIZE, size_t MAX_FFT_SIZE>
+    requires(is_bounded_pow_two(MIN_FFT_SIZE) && is_bounded_pow_two(MAX_FFT_SIZE) && MIN_FFT_SIZE >= 2 &&
+             MIN_FFT_SIZE <= MAX_FFT_SIZE)
+class FrameAnalyser
+{
+  public:
+    /// @brief Construct the kernel of another size in place (see FftSizedKernel::select_fft_size).
+    /// @param fft_size: Has to be a power of two in the range of MIN_FFT_SIZE .. MAX_FFT_SIZE.
+    void select_fft_size(const size_t fft_size) noexcept { m_frame_kernel.select_fft_size(fft_size); }
+
+    [[nodiscard]] size_t fft_size() const noexcept { return m_frame_kernel.fft_size(); }
+
+    /// @brief Analyse the frame of the current size that starts at oldest_index (see FrameKernel::analyse).
+    template <size_t RING_SIZE, size_t CAPACITY, typename PROFILER = StageProfiler<false>>
+        requires(RING_SIZE >= MAX_FFT_SIZE)
+    size_t analyse(const std::array<T, RING_SIZE>& ring_samples, const size_t oldest_index,
+                   const AnalysisWindow analysis_window, PeakArr<T, CAPACITY>& peaks, const T threshold,
+                   const size_t max_entries, PROFILER&& profiler = PROFILER{}) noexcept;
+
+    /// @brief Start an incremental analysis with the kernel of the current size (see FrameKernel::begin_analysis).
+    template <size_t RING_SIZE>
+        requires(RING_SIZE >= MAX_FFT_SIZE)
+    void begin_analysis(const std::array<T, RING_SIZE>& ring_samples, const size_t oldest_index,
+                        const AnalysisWindow analysis_window, const T threshold, const size_t max_entries) noexcept
+    {
+        m_frame_kernel.visit(
+            [&](auto& frame_kernel)
+            { frame_kernel.begin_analysis(ring_samples, oldest_index, analysis_window, threshold, max_entries); });
+    }
+
+    /// @brief Pack the pending frame before the ring buffer overwrites it (see FrameKernel::pack_frame_until).
+    void pack_frame_until(const size_t num_frame_samples) noexcept
+    {
+        m_frame_kernel.visit([num_frame_samples](auto& frame_kernel)
+                             { frame_kernel.pack_frame_until(num_frame_samples); });
+    }
+
+    /// @brief Next step of the incremental analysis (see FrameKernel::analysis_step).
+    template <size_t CAPACITY, typename PROFILER = StageProfiler<false>>
+    bool analysis_step(PeakArr<T, CAPACITY>& peaks, size_t& valid_entries,
+                       PROFILER&& profiler = PROFILER{}) noexcept
+    {
+        return m_frame_kernel.visit([&](auto& frame_kernel)
+                                    { return frame_kernel.analysis_step(peaks, valid_entries, profiler); });
+    }
+
+    [[nodiscard]] bool analysis_pending() const noexcept
+    {
+        return m_frame_kernel.visit([](const auto& frame_kernel) { return frame_kernel.analysis_pending(); });
+    }
+
+    /// @brief Number of steps an incremental analysis of the current size takes.
+    [[nodiscard]] size_t num_analysis_steps() const noexcept
+    {
+        return m_frame_kernel.visit([](const auto& frame_kernel) { return frame_kernel.num_analysis_steps; });
+    }
+
+  private:
+    template <size_t DEG_TWO>
+    using FrameKernelOfDegree = FrameKernel<T, DEG_TWO>;
+    using FrameKernels = FftSizedKernel<FrameKernelOfDegree, MIN_FFT_SIZE, MAX_FFT_SIZE>;
+    static constexpr size_t min_degree = FrameKernels::min_degree;
+    static constexpr size_t num_fft_sizes = FrameKernels::num_fft_sizes;
+
+    /// @brief Size specialized part of analyse, one entry of the dispatch table per size.
+    template <size_t DEG_TWO, size_t RING_SIZE, size_t CAPACITY, typename PROFILER>
+    size_t analyse_of_degree(const std::array<T, RING_SIZE>& ring_samples, const size_t oldest_index,
+                             const AnalysisWindow analysis_window, PeakArr<T, CAPACITY>& peaks,
+                             const T threshold, const size_t max_entries, PROFILER& profiler) noexcept
+    {
+        return m_frame_kernel.template get<DEG_TWO>().analyse(
+            ring_samples, oldest_index, analysis_window, peaks, threshold, max_entries, profiler);
+    }
+
+    // kernel of the current size, the largest one by default.
+    FrameKernels m_frame_kernel{};
+};
+
+/**
+ * IMPLEMENTATION
+ */
+template <FloatingPt T, size_t MIN_FFT_SIZE, size_t MAX_FFT_SIZE>
+    requires(is_bounded_pow_two(MIN_FFT_SIZE) && is_bounded_pow_two(MAX_FFT_SIZE) && MIN_FFT_SIZE >= 2 &&
+             MIN_FFT_SIZE <= MAX_FFT_SIZE)
+template <size_t RING_SIZE, size_t CAPACITY, typename PROFILER>
+    requires(RING_SIZE >= MAX_FFT_SIZE)
+size_t FrameAnalyser<T, MIN_FFT_SIZE, MAX_FFT_SIZE>::analyse(const std::array<T, RING_SIZE>& ring_samples,
+                                                            const size_t oldest_index,
+                                                            const AnalysisWindow analysis_window,
+                                                            PeakArr<T, CAPACITY>& peaks, const T threshold,
+                                                            const size_t max_entries, PROFILER&& profiler) noexcept
+{
+    // one size specialized kernel per FFT size, the table is indexed by the degree (once per frame, never per sample).
+    using Profiler = std::remove_reference_t<PROFILER>;
+    using Analyser =
+        size_t (FrameAnalyser::*)(const std::array<T, RING_SIZE>&, const size_t, const AnalysisWindow,
+                                  PeakArr<T, CAPACITY>&, const T, const size_t, Profiler&) noexcept;
+    static constexpr auto frame_analysers = []<size_t... OFFSETS>(std::index_sequence<OFFSETS...>)
+    {
+        return std::array<Analyser, num_fft_sizes>{
+            &FrameAnalyser::analyse_of_degree<min_degree + OFFSETS, RING_SIZE, CAPACITY, Profiler>...};
+    }(std::make_index_sequence<num_fft_sizes>{});
+    return (this->*frame_analysers[m_frame_kernel.index()])(
+        ring_samples, oldest_index, analysis_window, peaks, threshold, max_entries, profiler);
+}
+} // namespace LBTS::Spectral
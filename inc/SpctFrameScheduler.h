@@ -0,0 +1,126 @@
+/**
+ * Author: Lucas Scheidt
+ * Date: 14.10.26
+ *
+ * Description: Process-wide distribution of the frame boundaries. All instances of a plugin in one host share the
+ * block clock, so without further ado they complete their frames (and do their FFTs) in the very same callback while
+ * the callbacks in between are idle. Staggered instances spread their frames evenly over the hop instead, which
+ * flattens the summed load of a callback.
+ */
+
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace LBTS::Spectral
+{
+/// @brief Hands out the frame phases of the staggered instances. Slot k gets the phase of the van der Corput sequence
+/// (the bit reversed index as binary fraction: 0, 1/2, 1/4, 3/4, 1/8, ...), so the first n slots are always spread
+/// about evenly over the hop, no matter how many instances there are in the end. Freed slots get reused first (the
+/// smallest one), so the phases stay spread when instances come and go.
+/// This is a process-wide singleton and NOT intended to be an object (like SharedWaveTables).
+/// @note acquire and release lock a mutex, so they must not be called from the audio thread.
+class FramePhaseScheduler
+{
+  public:
+    FramePhaseScheduler() = delete;
+
+    /// @brief Phase of a slot as fraction of the hop (0 .. 1).
+    [[nodiscard]] static constexpr double phase_of_slot(const size_t slot) noexcept
+    {
+        const auto reversed = static_cast<double>(reverse_bits(static_cast<uint32_t>(slot)));
+        return reversed / 4294967296.0;
+    }
+
+    /// @brief Occupy the smallest free slot.
+    [[nodiscard]] static size_t acquire_slot()
+    {
+        const std::scoped_lock lock{m_mutex};
+        size_t slot = 0;
+        while (slot < m_occupied.size() && m_occupied[slot])
+        {
+            ++slot;
+        }
+        if (slot == m_occupied.size())
+        {
+            m_occupied.push_back(true);
+        }
+        m_occupied[slot] = true;
+        return slot;
+    }
+
+    static void release_slot(const size_t slot)
+    {
+        const std::scoped_lock lock{m_mutex};
+        if (slot < m_occupied.size())
+        {
+            m_occupied[slot] = false;
+        }
+    }
+
+    /// @brief Number of occupied slots (= staggered instances).
+    [[nodiscard]] static size_t num_occupied_slots()
+    {
+        const std::scoped_lock lock{m_mutex};
+        return static_cast<size_t>(std::count(m_occupied.begin(), m_occupied.end(), true));
+    }
+
+  private:
+    static constexpr uint32_t reverse_bits(uint32_t value) noexcept
+    {
+        uint32_t reversed = 0;
+        for (int bit = 0; bit < 32; ++bit, value >>= 1)
+        {
+            reversed = (reversed << 1) | (value & 1);
+        }
+        return reversed;
+    }
+
+    static inline std::mutex m_mutex{};
+    static inline std::vector<bool> m_occupied{};
+};
+
+/// @brief Owns a slot of the FramePhaseScheduler for as long as it lives (move only).
+class FramePhaseSlot
+{
+  public:
+    FramePhaseSlot() : m_slot{FramePhaseScheduler::acquire_slot()} {}
+    ~FramePhaseSlot()
+    {
+        if (m_owns_slot)
+        {
+            FramePhaseScheduler::release_slot(m_slot);
+        }
+    }
+    FramePhaseSlot(FramePhaseSlot&& other) noexcept : m_slot{other.m_slot}, m_owns_slot{other.m_owns_slot}
+    {
+        other.m_owns_slot = false;
+    }
+    FramePhaseSlot& operator=(FramePhaseSlot&& other) noexcept
+    {
+        if (this != &other)
+        {
+            if (m_owns_slot)
+            {
+                FramePhaseScheduler::release_slot(m_slot);
+            }
+            m_slot = other.m_slot;
+            m_owns_slot = other.m_owns_slot;
+            other.m_owns_slot = false;
+        }
+        return *this;
+    }
+    FramePhaseSlot(const FramePhaseSlot&) = delete;
+    FramePhaseSlot& operator=(const FramePhaseSlot&) = delete;
+
+    [[nodiscard]] size_t slot() const noexcept { return m_slot; }
+
+    [[nodiscard]] double phase() const noexcept { return FramePhaseScheduler::phase_of_slot(m_slot); }
+
+  private:
+    size_t m_slot;
+    bool m_owns_slot = true;
+};
+} // namespace LBTS::Spectral
@@ -0,0 +1,368 @@
+/**
+ * Author: Lucas Scheidt
+ * Date: 14.10.26
+ *
+ * Description: Resynthesis with one inverse FFT per hop instead of one oscillator per partial. Every partial is
+ * written into the spectrum of a Hann windowed grain (its main lobe around the fractional bin), the grains overlap by
+ * half and sum up to the continuous partials. The cost per hop is partials * lobe width + N log N, independent of the
+ * number of samples a partial lasts, which makes large partial counts affordable.
+ */
+
+#pragma once
+#include "SpctDomainSpecific.h"
+#include "SpctExponentLUT.h"
+#include "SpctProcessingFunctions.h"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <numbers>
+#include <utility>
+#include <variant>
+
+namespace LBTS::Spectral
+{
+/**
+ * @section this header contains:
+ * - GrainKernel (spectrum, twiddles and main lobe table of one grain size)
+ * - IfftResynth (drop-in replacement of ResynthOscs, satisfies the Resynthesizer concept)
+ *
+ * @note
+ * Crossover: the oscillator bank costs about partials * hop per hop, the inverse FFT about 9 bins per partial plus the
+ * transformation of twice the hop. Measured with spectral_bench (SSE2, one retune and one hop per call): with a hop of
+ * 256 samples (N = 1024) the inverse FFT is faster from about 4 partials on and 4x (float) to 8x (double) faster with
+ * 512 partials, with a hop of 64 samples (N = 256) from about 8 (double) to 16 (float) partials on. Smaller hops move
+ * the crossover up since the bank gets cheaper per hop while the cost per partial of the inverse FFT stays.
+ * Only sines are resynthesized, the waveform of the oscillators doesn't apply.
+ */
+
+/// @brief Everything the synthesis of one grain size needs.
+/// @tparam T: Type of the samples.
+/// @tparam DEG_TWO: Degree of the power of two of the grain size (twice the hop).
+template <FloatingPt T, size_t DEG_TWO>
+    requires(is_bounded_degree(DEG_TWO) && DEG_TWO >= 2)
+struct GrainKernel
+{
+    static constexpr size_t grain_size = pow_two_value_of_degree(DEG_TWO);
+    static constexpr size_t num_bins = grain_size >> 1;
+    // bins on both sides of a partial that get written, the Hann window leaks about -50 dB beyond.
+    static constexpr size_t lobe_half_width = 4;
+    static constexpr size_t lobe_oversampling = 64;
+
+    GrainKernel() noexcept
+    {
+        // DFT of the zero phase (periodic) Hann window at a bin offset x: 0.5 D(x) + 0.25 D(x - 1) + 0.25 D(x + 1), D
+        // is the Dirichlet kernel of the symmetric range (the first window sample is zero), so the lobe is real.
+        const auto dirichlet = [](const double offset)
+        {
+            constexpr auto size = static_cast<double>(grain_size);
+            const double angle = std::numbers::pi * offset / size;
+            return std::abs(std::sin(angle)) < 1e-12 ? size - 1.0 : std::sin(angle * (size - 1.0)) / std::sin(angle);
+        };
+        for (size_t entry = 0; entry < m_lobe_table.size(); ++entry)
+        {
+            const double offset = static_cast<double>(entry) / lobe_oversampling;
+            m_lobe_table[entry] = static_cast<T>(0.5 * dirichlet(offset) + 0.25 * dirichlet(offset - 1.0) +
+                                                 0.25 * dirichlet(offset + 1.0));
+        }
+    }
+
+    /// @brief Add a partial to the spectrum of the grain.
+    /// @param bin: Fractional bin of the partial on the grid of the grain.
+    /// @param amplitude: Peak amplitude of the partial.
+    /// @param phase: Phase at the center of the grain.
+    void add_partial(const T bin, const T amplitude, const T phase) noexcept
+    {
+        const std::complex<T> phasor = std::polar(amplitude / 2, phase);
+        // the negative frequency shows up around DC and (periodically) around the nyquist bin.
+        add_lobe(bin, phasor);
+        add_lobe(-bin, std::conj(phasor));
+        add_lobe(static_cast<T>(grain_size) - bin, std::conj(phasor));
+    }
+
+    /// @brief Transform the spectrum into the grain (and clear it for the next one).
+    /// @return The grain_size samples of the windowed grain.
+    const T* synthesize() noexcept
+    {
+        spct_inverse_real_fourier_transform<T, DEG_TWO>(m_spectrum, m_split_spectrum, m_real_fourier_lut);
+        // the packed samples are pairs of consecutive samples (array-oriented access of std::complex).
+        std::copy_n(reinterpret_cast<const T*>(m_spectrum.data()), grain_size, m_grain.begin());
+        m_spectrum.fill({});
+        return m_grain.data();
+    }
+
+    RealFourierLUT<T, DEG_TWO> m_real_fourier_lut{};
+    ComplexArr<T, num_bins> m_spectrum{};
+    SplitComplexArr<T, num_bins> m_split_spectrum{};
+    std::array<T, grain_size> m_grain{};
+    std::array<T, lobe_half_width * lobe_oversampling + 2> m_lobe_table{};
+
+  private:
+    void add_lobe(const T center, const std::complex<T> phasor) noexcept
+    {
+        const auto first_bin = static_cast<long>(std::ceil(center - static_cast<T>(lobe_half_width)));
+        const auto last_bin = static_cast<long>(std::floor(center + static_cast<T>(lobe_half_width)));
+        for (long bin = std::max(first_bin, 0L); bin <= std::min(last_bin, static_cast<long>(num_bins) - 1); ++bin)
+        {
+            const T position = std::abs(static_cast<T>(bin) - center) * lobe_oversampling;
+            const auto entry = static_cast<size_t>(position);
+            const T lobe = m_lobe_table[entry] + (position - entry) * (m_lobe_table[entry + 1] - m_lobe_table[entry]);
+            // the grain is centered, which shifts it by half its size: (-1)^k
+            m_spectrum[bin] += (bin & 1 ? -lobe : lobe) * phasor;
+        }
+    }
+};
+
+/// @brief One alternative per grain size from 2^MIN_DEG on, so a variant only takes the space of the largest one.
+template <FloatingPt T, size_t MIN_DEG, typename OFFSETS>
+struct GrainKernelVariant;
+
+template <FloatingPt T, size_t MIN_DEG, size_t... OFFSETS>
+struct GrainKernelVariant<T, MIN_DEG, std::index_sequence<OFFSETS...>>
+{
+    using type = std::variant<GrainKernel<T, MIN_DEG + OFFSETS>...>;
+};
+
+/// @brief Inverse FFT resynthesis of the analysed peaks.
+/// @tparam T: Type of the samples.
+/// @tparam FFT_SIZE: Largest analysis size, the bins passed to tune_oscillators belong to.
+/// @tparam MAX_PARTIALS: Compile-time capacity, the number of partials that actually play is set at runtime.
+template <FloatingPt T, size_t FFT_SIZE, size_t MAX_PARTIALS = max_partials>
+    requires(is_bounded_pow_two(FFT_SIZE))
+class IfftResynth
+{
+  public:
+    static constexpr size_t min_hop_size = 8;
+    static constexpr size_t max_hop_size = std::max(min_hop_size, std::min<size_t>(FFT_SIZE, max_num_of_samples >> 1));
+
+    IfftResynth() = delete;
+
+    /// @param sampling_freq Determined by the DAW.
+    explicit IfftResynth(const double sampling_freq) : m_sampling_freq{sampling_freq} {}
+
+    IfftResynth(const IfftResynth&) = delete;
+    IfftResynth& operator=(const IfftResynth&) = delete;
+    IfftResynth(IfftResynth&&) noexcept = delete;
+    IfftResynth& operator=(IfftResynth&&) = delete;
+    ~IfftResynth() = default;
+
+    /// @brief Render a block, a new grain is synthesized every hop.
+    /// @param output Start of the block, gets overwritten.
+    /// @param num_samples Length of the block.
+    void process(T* output, const size_t num_samples) noexcept;
+
+    /// @brief Take over the peaks of a frame, they are played from the next grain on.
+    /// @param frequency_ratio Transposition of every partial, partials that would end up at or above nyquist are
+    /// dropped.
+    void tune_oscillators(const PeakArr<T, MAX_PARTIALS>& peaks, const size_t valid_entries,
+                          const double frequency_ratio = 1.0) noexcept;
+
+    /// @brief Silence everything.
+    void reset(const double sampling_freq) noexcept;
+
+    /// @brief Set the maximum number of partials that play at once (clamped to MAX_PARTIALS).
+    void set_partial_count(const size_t partial_count) noexcept { m_partial_count = std::min(partial_count, MAX_PARTIALS); }
+
+    [[nodiscard]] size_t partial_count() const noexcept { return m_partial_count; }
+
+    /// @brief Size of the transformation the bins passed to tune_oscillators belong to (up to FFT_SIZE).
+    void set_fft_size(const size_t fft_size) noexcept { m_fft_size = std::min(fft_size, FFT_SIZE); }
+
+    /// @brief Distance of the grains, which are twice as long. Should be the hop of the analysis so every frame gets a
+    /// grain. Clamped to a power of two of min_hop_size .. max_hop_size, a change starts over (nothing is allocated).
+    void set_hop_size(const size_t hop_size) noexcept;
+
+    [[nodiscard]] size_t hop_size() const noexcept { return m_hop_size; }
+
+  private:
+    static constexpr size_t min_degree = degree_of_pow_two_value(min_hop_size << 1);
+    static constexpr size_t num_grain_sizes = degree_of_pow_two_value(max_hop_size << 1) - min_degree + 1;
+    using GrainKernels = typename GrainKernelVariant<T, min_degree, std::make_index_sequence<num_grain_sizes>>::type;
+    // the whole frame by default, like the hop of the analysis.
+    static constexpr size_t default_hop_size = max_hop_size;
+
+    /// @brief Synthesize the next grain and overlap it with the second half of the previous one.
+    void synthesize_grain() noexcept;
+
+    /// @brief Phase of a partial at the center of the current grain: continues the closest partial of the previous
+    /// grain that is not continued yet and at most one and a half bins of the grain away, zero for a new partial.
+    T continued_phase(const T frequency, const T grain_size) noexcept;
+
+    double m_sampling_freq;
+    size_t m_fft_size = FFT_SIZE;
+    size_t m_partial_count = std::min<size_t>(max_oscillators, MAX_PARTIALS);
+    // partials of the latest frame, frequencies in cycles per sample.
+    std::array<T, MAX_PARTIALS> m_frequencies{};
+    std::array<T, MAX_PARTIALS> m_amplitudes{};
+    size_t m_num_partials = 0;
+    // frequency and phase of every partial a grain played, sorted by frequency. The partials of the previous grain (odd
+    // or even) get continued, each by one partial of the next grain at most.
+    struct GrainPartial
+    {
+        T m_frequency;
+        T m_phase;
+    };
+    std::array<std::array<GrainPartial, MAX_PARTIALS>, 2> m_grain_partials{};
+    std::array<size_t, 2> m_num_grain_partials{};
+    std::array<bool, MAX_PARTIALS> m_continued{};
+    uint64_t m_grain_count = 0;
+    // overlap-add: the samples of the current hop and the second half of the latest grain.
+    std::array<T, max_hop_size> m_playback{};
+    std::array<T, max_hop_size> m_tail{};
+    size_t m_hop_size = default_hop_size;
+    size_t m_read_index = m_hop_size;
+    GrainKernels m_grain_kernel{std::in_place_index<degree_of_pow_two_value(default_hop_size << 1) - min_degree>};
+};
+
+/*
+ * IMPLEMENTATION
+ */
+template <FloatingPt T, size_t FFT_SIZE, size_t MAX_PARTIALS>
+    requires(is_bounded_pow_two(FFT_SIZE))
+void IfftResynth<T, FFT_SIZE, MAX_PARTIALS>::process(T* output, const size_t num_samples) noexcept
+{
+    size_t output_index = 0;
+    while (output_index < num_samples)
+    {
+        if (m_read_index == m_hop_size)
+        {
+            synthesize_grain();
+            m_read_index = 0;
+        }
+        const size_t block_size = std::min(num_samples - output_index, m_hop_size - m_read_index);
+        std::copy_n(m_playback.begin() + m_read_index, block_size, output + output_index);
+        m_read_index += block_size;
+        output_index += block_size;
+    }
+}
+
+template <FloatingPt T, size_t FFT_SIZE, size_t MAX_PARTIALS>
+    requires(is_bounded_pow_two(FFT_SIZE))
+void IfftResynth<T, FFT_SIZE, MAX_PARTIALS>::tune_oscillators(const PeakArr<T, MAX_PARTIALS>& peaks,
+                                                              const size_t valid_entries,
+                                                              const double frequency_ratio) noexcept
+{
+    // same amplitudes as ResynthOscs: 2 / N * magnitude.
+    const T amp_correction = static_cast<T>(2) / static_cast<T>(m_fft_size);
+    const double bin_to_frequency = frequency_ratio / static_cast<double>(m_fft_size);
+    m_num_partials = 0;
+    for (size_t peak = 0; peak < std::min(valid_entries, m_partial_count); ++peak)
+    {
+        const double frequency = peaks.bin(peak) * bin_to_frequency;
+        if (frequency < 0.5)
+        {
+            m_frequencies[m_num_partials] = static_cast<T>(frequency);
+            m_amplitudes[m_num_partials] = amp_correction * peaks.magnitude(peak);
+            ++m_num_partials;
+        }
+    }
+}
+
+template <FloatingPt T, size_t FFT_SIZE, size_t MAX_PARTIALS>
+    requires(is_bounded_pow_two(FFT_SIZE))
+void IfftResynth<T, FFT_SIZE, MAX_PARTIALS>::reset(const double sampling_freq) noexcept
+{
+    m_sampling_freq = sampling_freq;
+    m_num_partials = 0;
+    m_playback.fill(0);
+    m_tail.fill(0);
+    // nothing to continue.
+    m_num_grain_partials.fill(0);
+    m_read_index = m_hop_size;
+}
+
+template <FloatingPt T, size_t FFT_SIZE, size_t MAX_PARTIALS>
+    requires(is_bounded_pow_two(FFT_SIZE))
+void IfftResynth<T, FFT_SIZE, MAX_PARTIALS>::set_hop_size(const size_t hop_size) noexcept
+{
+    const size_t degree = degree_of_pow_two_value(std::bit_ceil(std::clamp(hop_size, min_hop_size, max_hop_size)) << 1);
+    // emplace needs the index at compile time, so it goes through a table (see FrameAnalyser::select_fft_size).
+    static constexpr auto kernel_emplacers = []<size_t... OFFSETS>(std::index_sequence<OFFSETS...>)
+    {
+        return std::array<void (*)(GrainKernels&) noexcept, num_grain_sizes>{
+            [](GrainKernels& grain_kernel) noexcept { grain_kernel.template emplace<OFFSETS>(); }...};
+    }(std::make_index_sequence<num_grain_sizes>{});
+    if (m_grain_kernel.index() == degree - min_degree)
+    {
+        return;
+    }
+    kernel_emplacers[degree - min_degree](m_grain_kernel);
+    m_hop_size = pow_two_value_of_degree(degree) >> 1;
+    // the phases belong to other grain centers now and the tail to another grain size.
+    m_tail.fill(0);
+    m_num_grain_partials.fill(0);
+    m_read_index = m_hop_size;
+}
+
+template <FloatingPt T, size_t FFT_SIZE, size_t MAX_PARTIALS>
+    requires(is_bounded_pow_two(FFT_SIZE))
+void IfftResynth<T, FFT_SIZE, MAX_PARTIALS>::synthesize_grain() noexcept
+{
+    auto& grain_partials = m_grain_partials[m_grain_count & 1];
+    std::fill_n(m_continued.begin(), m_num_grain_partials[(m_grain_count & 1) ^ 1], false);
+    std::visit(
+        [&](auto& grain_kernel)
+        {
+            constexpr auto grain_size = static_cast<T>(std::remove_reference_t<decltype(grain_kernel)>::grain_size);
+            for (size_t partial = 0; partial < m_num_partials; ++partial)
+            {
+                const T frequency = m_frequencies[partial];
+                const T phase = continued_phase(frequency, grain_size);
+                grain_partials[partial] = {frequency, phase};
+                grain_kernel.add_partial(frequency * grain_size, m_amplitudes[partial], phase);
+            }
+            const T* grain = grain_kernel.synthesize();
+            for (size_t sample = 0; sample < m_hop_size; ++sample)
+            {
+                m_playback[sample] = m_tail[sample] + grain[sample];
+                m_tail[sample] = grain[sample + m_hop_size];
+            }
+        },
+        m_grain_kernel);
+    // sorted for the search of the next grain.
+    std::sort(grain_partials.begin(),
+              grain_partials.begin() + static_cast<std::ptrdiff_t>(m_num_partials),
+              [](const GrainPartial& lhs, const GrainPartial& rhs) { return lhs.m_frequency < rhs.m_frequency; });
+    m_num_grain_partials[m_grain_count & 1] = m_num_partials;
+    ++m_grain_count;
+}
+
+template <FloatingPt T, size_t FFT_SIZE, size_t MAX_PARTIALS>
+    requires(is_bounded_pow_two(FFT_SIZE))
+T IfftResynth<T, FFT_SIZE, MAX_PARTIALS>::continued_phase(const T frequency, const T grain_size) noexcept
+{
+    // two partials close enough to share a bin of the grain keep a phase each: every partial of the previous grain is
+    // continued once, the louder partials (which come first) get the closer ones.
+    const auto& previous = m_grain_partials[(m_grain_count & 1) ^ 1];
+    const auto num_previous = static_cast<std::ptrdiff_t>(m_num_grain_partials[(m_grain_count & 1) ^ 1]);
+    const T max_distance = static_cast<T>(1.5) / grain_size;
+    const auto is_below = [](const GrainPartial& lhs, const T value) { return lhs.m_frequency < value; };
+    const std::ptrdiff_t upper =
+        std::lower_bound(previous.begin(), previous.begin() + num_previous, frequency, is_below) - previous.begin();
+    // the closest one that is not continued yet, on either side.
+    std::ptrdiff_t below = upper - 1;
+    while (below >= 0 && m_continued[below])
+    {
+        --below;
+    }
+    std::ptrdiff_t above = upper;
+    while (above < num_previous && m_continued[above])
+    {
+        ++above;
+    }
+    const T below_distance = below >= 0 ? frequency - previous[below].m_frequency : max_distance;
+    const T above_distance = above < num_previous ? previous[above].m_frequency - frequency : max_distance;
+    const std::ptrdiff_t closest = above_distance < below_distance ? above : below;
+    if (std::min(below_distance, above_distance) >= max_distance)
+    {
+        return 0;
+    }
+    m_continued[closest] = true;
+    // the centers are a hop apart, the frequency is interpolated in between.
+    const GrainPartial& continued = previous[closest];
+    const T advance = std::numbers::pi_v<T> * (continued.m_frequency + frequency) * static_cast<T>(m_hop_size);
+    return std::remainder(continued.m_phase + advance, two_pi<T>);
+}
+} // namespace LBTS::Spectral
@@ -0,0 +1,502 @@
+/**
+ * Author: Lucas Scheidt
+ * Date: 14.10.26
+ *
+ * Description: Processor for multi-channel tracks (the channel pointer array a DAW hands over). Instead of one
+ * BufferManager per channel the channels share the twiddles and are transformed together, one channel per SIMD lane.
+ */
+
+#pragma once
+#include "SpctAnalysisWindows.h"
+#include "SpctCircularBuffer.h"
+#include "SpctDenormals.h"
+#include "SpctDomainSpecific.h"
+#include "SpctExponentLUT.h"
+#include "SpctFrameAnalyser.h"
+#include "SpctOscillators.h"
+#include "SpctProcessingFunctions.h"
+#include "SpctSimd.h"
+#include <algorithm>
+#include <array>
+#include <utility>
+#include <variant>
+
+namespace LBTS::Spectral
+{
+/// @brief Analysis of up to VEC::width channels of one frame size at once.
+/// @tparam T: Type of the samples.
+/// @tparam DEG_TWO: Degree of the power of two of the frame size.
+/// @tparam VEC: SIMD register, one channel per lane.
+template <FloatingPt T, size_t DEG_TWO, typename VEC = SimdVec<T>>
+    requires(is_bounded_degree(DEG_TWO) && DEG_TWO >= 1)
+struct BatchedFrameKernel
+{
+    static constexpr size_t num_samples = pow_two_value_of_degree(DEG_TWO);
+    static constexpr size_t lanes = VEC::width;
+
+    /// @brief Window, transform and pick the peaks of the latest frame of every channel of the batch. Silent channels
+    /// (see is_silent_frame) get no peaks without the peak picking, a batch of silent channels skips the transform too.
+    /// @param ring_samples: One ring buffer per channel (num_channels <= lanes), all with the valid range num_samples.
+    /// @param oldest_index: Index of the oldest sample, the same for every ring buffer.
+    /// @param peak_arrs: The peaks of every channel.
+    /// @param valid_entries: One count per channel (out).
+    template <size_t RING_SIZE, size_t CAPACITY>
+    void analyse(const std::array<T, RING_SIZE>* const* ring_samples, const size_t num_channels,
+                 const size_t oldest_index, const AnalysisWindow analysis_window,
+                 PeakArr<T, CAPACITY>* const* peak_arrs, size_t* valid_entries, const T threshold,
+                 const size_t max_entries) noexcept
+    {
+        // packed like pack_real_frame, but straight into the bit-reversed position of the lane.
+        constexpr size_t index_mask = num_samples - 1;
+        constexpr auto& bit_reversal_table = BitReversalTable_v<DEG_TWO - 1>;
+        const auto& window = analysis_window_table<T, num_samples>(analysis_window);
+        std::array<T, lanes> energies{};
+        for (size_t packed_ndx = 0; packed_ndx < (num_samples >> 1); ++packed_ndx)
+        {
+            const size_t frame_ndx = packed_ndx << 1;
+            const size_t ring_ndx = (oldest_index + frame_ndx) & index_mask;
+            T* real = m_real.data() + bit_reversal_table[packed_ndx] * lanes;
+            T* imag = m_imag.data() + bit_reversal_table[packed_ndx] * lanes;
+            for (size_t channel = 0; channel < num_channels; ++channel)
+            {
+                real[channel] = (*ring_samples[channel])[ring_ndx] * window[frame_ndx];
+                imag[channel] = (*ring_samples[channel])[(ring_ndx + 1) & index_mask] * window[frame_ndx + 1];
+                energies[channel] += real[channel] * real[channel] + imag[channel] * imag[channel];
+            }
+            std::fill(real + num_channels, real + lanes, static_cast<T>(0));
+            std::fill(imag + num_channels, imag + lanes, static_cast<T>(0));
+        }
+        // the bound of is_silent_frame.
+        const T clipped_threshold = threshold >= 1 ? threshold : 1;
+        std::array<bool, lanes> silent{};
+        bool all_silent = true;
+        for (size_t channel = 0; channel < num_channels; ++channel)
+        {
+            silent[channel] = static_cast<T>(num_samples) * energies[channel] < clipped_threshold * clipped_threshold;
+            all_silent = all_silent && silent[channel];
+        }
+        if (all_silent)
+        {
+            std::fill(valid_entries, valid_entries + num_channels, size_t{0});
+            return;
+        }
+        spct_fourier_transform_batched<T, DEG_TWO - 1, VEC>(m_real.data(), m_imag.data(), m_real_fourier_lut.m_half_lut);
+        for (size_t channel = 0; channel < num_channels; ++channel)
+        {
+            if (silent[channel])
+            {
+                valid_entries[channel] = 0;
+                continue;
+            }
+            for (size_t bin = 0; bin < m_spectrum.size(); ++bin)
+            {
+                m_spectrum[bin] = {m_real[bin * lanes + channel], m_imag[bin * lanes + channel]};
+            }
+            split_real_spectrum<T, DEG_TWO>(m_spectrum, m_real_fourier_lut);
+            valid_entries[channel] =
+                calculate_peak_map<T, num_samples>(m_spectrum, *peak_arrs[channel], threshold, max_entries);
+        }
+    }
+
+    // shared by all channels.
+    RealFourierLUT<T, DEG_TWO> m_real_fourier_lut{};
+    // lane interleaved working arrays of the N/2 point transformation.
+    alignas(64) std::array<T, (num_samples >> 1) * lanes> m_real{};
+    alignas(64) std::array<T, (num_samples >> 1) * lanes> m_imag{};
+    // bins 0 .. N/2-1 of the channel that is currently split.
+    ComplexArr<T, (num_samples >> 1)> m_spectrum{};
+};
+
+/// @brief The multi-channel counterpart of the BufferManager.
+/// @tparam T: Type of the samples.
+/// @tparam BUFFER_SIZE: Maximum FFT size, everything is preallocated for it. The actual size is chosen at runtime.
+/// @tparam MAX_CHANNELS: Number of channels that can be processed (e.g. 2 for stereo, 8 for 7.1).
+template <FloatingPt T, size_t BUFFER_SIZE = BoundedPowTwo_v<size_t, 1024>, size_t MAX_CHANNELS = 8>
+    requires(is_bounded_pow_two(BUFFER_SIZE) && MAX_CHANNELS > 0)
+class MultiChannelProcessor
+{
+  public:
+    static constexpr size_t max_channels = MAX_CHANNELS;
+    /// @brief Smallest FFT size that can be selected at runtime.
+    static constexpr size_t min_fft_size = std::min<size_t>(BoundedPowTwo_v<size_t, 16>, BUFFER_SIZE);
+    /// @brief There can't be more peaks than bins, so the capacity is limited by the FFT size as well.
+    static constexpr size_t partial_capacity = partial_capacity_of(BUFFER_SIZE);
+
+    explicit MultiChannelProcessor(const double sampling_freq = 44100.0)
+        : m_sampling_freq{sampling_freq},
+          m_channels{make_channels(sampling_freq, std::make_index_sequence<MAX_CHANNELS>{})}
+    {
+    }
+
+    /// @note Deleted! The oscillators can't be copied.
+    MultiChannelProcessor(const MultiChannelProcessor&) = delete;
+    /// @note Deleted! The oscillators can't be copied.
+    MultiChannelProcessor& operator=(const MultiChannelProcessor&) = delete;
+
+    ~MultiChannelProcessor() = default;
+
+    /// @brief Analyse and resynthesize every channel (overwrites the input).
+    /// @param daw_channels: One pointer per channel (the layout Juce uses), each with t_size samples.
+    /// @param num_channels: Channels beyond MAX_CHANNELS are left untouched.
+    void process_daw_chunk(T* const* daw_channels, const size_t num_channels, const size_t t_size,
+                           const T threshold = 1.0) noexcept;
+
+    void select_channel_link(const ChannelLink channel_link) noexcept;
+
+    [[nodiscard]] ChannelLink channel_link() const noexcept { return m_channel_link; }
+
+    /// @param fft_size: Clipped to a power of two in the range of min_fft_size .. BUFFER_SIZE.
+    void select_fft_size(const size_t fft_size) noexcept;
+
+    [[nodiscard]] size_t fft_size() const noexcept { return m_channels[0].m_ring_buffer.size(); }
+
+    void select_hop_size(const HopSize hop_size) noexcept
+    {
+        for (auto& channel : m_channels)
+        {
+            channel.m_ring_buffer.set_hop_size(hop_size);
+            channel.m_oscillators.set_hop_size(channel.m_ring_buffer.hop_size());
+        }
+    }
+
+    void select_analysis_window(const AnalysisWindow analysis_window) noexcept { m_analysis_window = analysis_window; }
+
+    void select_osc_waveform(const OscWaveform& osc_waveform) noexcept
+    {
+        for (auto& channel : m_channels)
+        {
+            channel.m_oscillators.select_waveform(osc_waveform);
+        }
+    }
+
+    void select_interpolation(const WTInterpolation interpolation) noexcept
+    {
+        for (auto& channel : m_channels)
+        {
+            channel.m_oscillators.select_interpolation(interpolation);
+        }
+    }
+
+    /// @brief Maximum number of partials per channel (clamped to partial_capacity).
+    void select_partial_count(const size_t partial_count) noexcept
+    {
+        for (auto& channel : m_channels)
+        {
+            channel.m_oscillators.set_partial_count(partial_count);
+        }
+    }
+
+    void reset(const double sampling_freq) noexcept;
+
+    /// @brief Peaks of the latest frame of an analysed channel (mid and side for MID_SIDE, only the first one for
+    /// LINKED).
+    [[nodiscard]] const PeakArr<T, partial_capacity>& peaks(const size_t channel) const noexcept
+    {
+        return m_channels[channel].m_peaks;
+    }
+
+    [[nodiscard]] size_t valid_entries(const size_t channel) const noexcept
+    {
+        return m_channels[channel].m_valid_entries;
+    }
+
+  private:
+    template <size_t DEG_TWO>
+    using BatchedFrameKernelOfDegree = BatchedFrameKernel<T, DEG_TWO>;
+    using FrameKernels = FftSizedKernel<BatchedFrameKernelOfDegree, min_fft_size, BUFFER_SIZE>;
+    static constexpr size_t lanes = SimdVec<T>::width;
+
+    struct Channel
+    {
+        explicit Channel(const double sampling_freq) : m_oscillators{sampling_freq} {}
+
+        // contains the analysed signal (the channel itself, the mean or mid / side).
+        CircularSampleBuffer<T, BUFFER_SIZE> m_ring_buffer{};
+        PeakArr<T, partial_capacity> m_peaks{};
+        size_t m_valid_entries = 0;
+        ResynthOscs<T, BoundedPowTwo_v<size_t, 512>, BUFFER_SIZE, partial_capacity> m_oscillators;
+    };
+
+    template <size_t... CHANNELS>
+    static std::array<Channel, MAX_CHANNELS> make_channels(const double sampling_freq,
+                                                           std::index_sequence<CHANNELS...>)
+    {
+        return {((void)CHANNELS, Channel{sampling_freq})...};
+    }
+
+    /// @brief MID_SIDE only works for a stereo pair.
+    [[nodiscard]] ChannelLink effective_link(const size_t num_channels) const noexcept
+    {
+        return m_channel_link == ChannelLink::MID_SIDE && num_channels != 2 ? ChannelLink::INDEPENDENT
+                                                                            : m_channel_link;
+    }
+
+    /// @brief Fill the ring buffers with the analysed signals of a segment.
+    /// @return true if a frame got completed.
+    bool fill_segment(T* const* daw_channels, const size_t num_channels, const size_t offset, const size_t size,
+                      const ChannelLink channel_link) noexcept;
+
+    /// @brief Resynthesize a segment into the channels.
+    void render_segment(T* const* daw_channels, const size_t num_channels, const size_t offset, const size_t size,
+                        const ChannelLink channel_link) noexcept;
+
+    /// @brief Make the first num_analysed ring buffers the active ones. Ring buffers that become active again start
+    /// over (silence) at the index of the others, their channels with untuned oscillators.
+    void activate_rings(const size_t num_analysed) noexcept;
+
+    /// @brief Transform the latest frame of the analysed channels in batches of lanes and retune their oscillators.
+    void analyse_frame(const size_t num_analysed, const T threshold) noexcept;
+
+    double m_sampling_freq;
+    ChannelLink m_channel_link = ChannelLink::INDEPENDENT;
+    AnalysisWindow m_analysis_window = AnalysisWindow::RECTANGULAR;
+    // kernel of the current size, the largest one by default.
+    FrameKernels m_frame_kernel{};
+    std::array<Channel, MAX_CHANNELS> m_channels;
+    // the ring buffers from m_active_rings on are idle, they don't get filled and are out of step with the others.
+    size_t m_active_rings = MAX_CHANNELS;
+    // encoded signal of a segment (LINKED and MID_SIDE).
+    alignas(64) std::array<T, BUFFER_SIZE> m_staging{};
+};
+
+/**
+ * IMPLEMENTATION
+ */
+template <FloatingPt T, size_t BUFFER_SIZE, size_t MAX_CHANNELS>
+    requires(is_bounded_pow_two(BUFFER_SIZE) && MAX_CHANNELS > 0)
+void MultiChannelProcessor<T, BUFFER_SIZE, MAX_CHANNELS>::process_daw_chunk(T* const* daw_channels,
+                                                                            const size_t num_channels,
+                                                                            const size_t t_size,
+                                                                            const T threshold) noexcept
+{
+    const size_t valid_channels = std::min(num_channels, MAX_CHANNELS);
+    if (valid_channels == 0)
+    {
+        return;
+    }
+    const ScopedFlushDenormals flush_denormals{};
+    const ChannelLink channel_link = effective_link(valid_channels);
+    const size_t num_analysed = channel_link == ChannelLink::LINKED ? 1 : valid_channels;
+    activate_rings(num_analysed);
+    // same segmentation as BufferManager::process_daw_chunk, all active ring buffers advance together.
+    m_channels[0].m_ring_buffer.for_each_segment(
+        t_size,
+        [&](const size_t offset, const size_t segment_size)
+        {
+            const bool do_transformation =
+                fill_segment(daw_channels, valid_channels, offset, segment_size, channel_link);
+            render_segment(daw_channels, valid_channels, offset, segment_size, channel_link);
+            if (do_transformation)
+            {
+                analyse_frame(num_analysed, threshold);
+            }
+        });
+}
+
+template <FloatingPt T, size_t BUFFER_SIZE, size_t MAX_CHANNELS>
+    requires(is_bounded_pow_two(BUFFER_SIZE) && MAX_CHANNELS > 0)
+bool MultiChannelProcessor<T, BUFFER_SIZE, MAX_CHANNELS>::fill_segment(T* const* daw_channels,
+                                                                       const size_t num_channels, const size_t offset,
+                                                                       const size_t size,
+                                                                       const ChannelLink channel_link) noexcept
+{
+    // every active ring buffer gets a bulk copy of the same length, so they all complete their frames at the same time.
+    // The encoded signals (mean, mid / side) are calculated into the staging buffer first (the segment is at most a
+    // hop). The first ring buffer always exists and tells whether a frame got completed.
+    bool frame_completed = false;
+    T* staging = m_staging.data();
+    switch (channel_link)
+    {
+    case ChannelLink::INDEPENDENT:
+        frame_completed = m_channels[0].m_ring_buffer.fill_span(daw_channels[0] + offset, size);
+        for (size_t channel = 1; channel < num_channels; ++channel)
+        {
+            m_channels[channel].m_ring_buffer.fill_span(daw_channels[channel] + offset, size);
+        }
+        break;
+    case ChannelLink::LINKED:
+        std::copy_n(daw_channels[0] + offset, size, staging);
+        for (size_t channel = 1; channel < num_channels; ++channel)
+        {
+            const T* daw_channel = daw_channels[channel] + offset;
+            for (size_t sample = 0; sample < size; ++sample)
+            {
+                staging[sample] += daw_channel[sample];
+            }
+        }
+        for (size_t sample = 0; sample < size; ++sample)
+        {
+            staging[sample] /= static_cast<T>(num_channels);
+        }
+        frame_completed = m_channels[0].m_ring_buffer.fill_span(staging, size);
+        break;
+    case ChannelLink::MID_SIDE:
+        {
+            const T* left = daw_channels[0] + offset;
+            const T* right = daw_channels[1] + offset;
+            for (size_t sample = 0; sample < size; ++sample)
+            {
+                staging[sample] = (left[sample] + right[sample]) / 2;
+            }
+            frame_completed = m_channels[0].m_ring_buffer.fill_span(staging, size);
+            for (size_t sample = 0; sample < size; ++sample)
+            {
+                staging[sample] = (left[sample] - right[sample]) / 2;
+            }
+            m_channels[1].m_ring_buffer.fill_span(staging, size);
+        }
+        break;
+    }
+    return frame_completed;
+}
+
+template <FloatingPt T, size_t BUFFER_SIZE, size_t MAX_CHANNELS>
+    requires(is_bounded_pow_two(BUFFER_SIZE) && MAX_CHANNELS > 0)
+void MultiChannelProcessor<T, BUFFER_SIZE, MAX_CHANNELS>::render_segment(T* const* daw_channels,
+                                                                         const size_t num_channels,
+                                                                         const size_t offset, const size_t size,
+                                                                         const ChannelLink channel_link) noexcept
+{
+    switch (channel_link)
+    {
+    case ChannelLink::INDEPENDENT:
+        for (size_t channel = 0; channel < num_channels; ++channel)
+        {
+            m_channels[channel].m_oscillators.process(daw_channels[channel] + offset, size);
+        }
+        break;
+    case ChannelLink::LINKED:
+        // one resynthesis, copied into every channel.
+        m_channels[0].m_oscillators.process(daw_channels[0] + offset, size);
+        for (size_t channel = 1; channel < num_channels; ++channel)
+        {
+            std::copy_n(daw_channels[0] + offset, size, daw_channels[channel] + offset);
+        }
+        break;
+    case ChannelLink::MID_SIDE:
+        {
+            T* left = daw_channels[0] + offset;
+            T* right = daw_channels[1] + offset;
+            m_channels[0].m_oscillators.process(left, size);
+            m_channels[1].m_oscillators.process(right, size);
+            // left = mid + side, right = mid - side
+            for (size_t sample = 0; sample < size; ++sample)
+            {
+                const T mid = left[sample];
+                left[sample] = mid + right[sample];
+                right[sample] = mid - right[sample];
+            }
+        }
+        break;
+    }
+}
+
+template <FloatingPt T, size_t BUFFER_SIZE, size_t MAX_CHANNELS>
+    requires(is_bounded_pow_two(BUFFER_SIZE) && MAX_CHANNELS > 0)
+void MultiChannelProcessor<T, BUFFER_SIZE, MAX_CHANNELS>::activate_rings(const size_t num_analysed) noexcept
+{
+    // only happens when the number of channels or the link changes, not per callback.
+    const size_t current_index = m_channels[0].m_ring_buffer.m_index;
+    for (size_t channel = m_active_rings; channel < num_analysed; ++channel)
+    {
+        m_channels[channel].m_ring_buffer.reset_buffers();
+        m_channels[channel].m_ring_buffer.m_index = current_index;
+        m_channels[channel].m_valid_entries = 0;
+        m_channels[channel].m_oscillators.reset(m_sampling_freq);
+    }
+    m_active_rings = num_analysed;
+}
+
+template <FloatingPt T, size_t BUFFER_SIZE, size_t MAX_CHANNELS>
+    requires(is_bounded_pow_two(BUFFER_SIZE) && MAX_CHANNELS > 0)
+void MultiChannelProcessor<T, BUFFER_SIZE, MAX_CHANNELS>::analyse_frame(const size_t num_analysed,
+                                                                        const T threshold) noexcept
+{
+    const size_t oldest_index = m_channels[0].m_ring_buffer.current_index();
+    const size_t max_entries = m_channels[0].m_oscillators.partial_count();
+    m_frame_kernel.visit(
+        [&](auto& frame_kernel)
+        {
+            for (size_t first_channel = 0; first_channel < num_analysed; first_channel += lanes)
+            {
+                const size_t batch_size = std::min(lanes, num_analysed - first_channel);
+                std::array<const std::array<T, BUFFER_SIZE>*, lanes> ring_samples{};
+                std::array<PeakArr<T, partial_capacity>*, lanes> peak_arrs{};
+                std::array<size_t, lanes> valid_entries{};
+                for (size_t lane = 0; lane < batch_size; ++lane)
+                {
+                    ring_samples[lane] = &m_channels[first_channel + lane].m_ring_buffer.m_in_array;
+                    peak_arrs[lane] = &m_channels[first_channel + lane].m_peaks;
+                }
+                frame_kernel.analyse(ring_samples.data(),
+                                     batch_size,
+                                     oldest_index,
+                                     m_analysis_window,
+                                     peak_arrs.data(),
+                                     valid_entries.data(),
+                                     threshold,
+                                     max_entries);
+                for (size_t lane = 0; lane < batch_size; ++lane)
+                {
+                    m_channels[first_channel + lane].m_valid_entries = valid_entries[lane];
+                }
+            }
+        });
+    for (size_t channel = 0; channel < num_analysed; ++channel)
+    {
+        m_channels[channel].m_oscillators.tune_oscillators(m_channels[channel].m_peaks,
+                                                           m_channels[channel].m_valid_entries);
+    }
+}
+
+template <FloatingPt T, size_t BUFFER_SIZE, size_t MAX_CHANNELS>
+    requires(is_bounded_pow_two(BUFFER_SIZE) && MAX_CHANNELS > 0)
+void MultiChannelProcessor<T, BUFFER_SIZE, MAX_CHANNELS>::select_channel_link(const ChannelLink channel_link) noexcept
+{
+    if (channel_link == m_channel_link)
+    {
+        return;
+    }
+    // the ring buffers contain the analysed signals of the previous link, so they start over.
+    m_channel_link = channel_link;
+    for (auto& channel : m_channels)
+    {
+        channel.m_ring_buffer.reset_buffers();
+        channel.m_valid_entries = 0;
+        channel.m_oscillators.reset(m_sampling_freq);
+    }
+    m_active_rings = MAX_CHANNELS;
+}
+
+template <FloatingPt T, size_t BUFFER_SIZE, size_t MAX_CHANNELS>
+    requires(is_bounded_pow_two(BUFFER_SIZE) && MAX_CHANNELS > 0)
+void MultiChannelProcessor<T, BUFFER_SIZE, MAX_CHANNELS>::select_fft_size(const size_t fft_size) noexcept
+{
+    for (auto& channel : m_channels)
+    {
+        channel.m_ring_buffer.resize_valid_range(std::max(fft_size, min_fft_size));
+    }
+    // the resize cleared every ring buffer, so they are all in step again.
+    m_active_rings = MAX_CHANNELS;
+    m_frame_kernel.select_fft_size(this->fft_size());
+    for (auto& channel : m_channels)
+    {
+        channel.m_oscillators.set_fft_size(this->fft_size());
+        channel.m_oscillators.set_hop_size(channel.m_ring_buffer.hop_size());
+    }
+}
+
+template <FloatingPt T, size_t BUFFER_SIZE, size_t MAX_CHANNELS>
+    requires(is_bounded_pow_two(BUFFER_SIZE) && MAX_CHANNELS > 0)
+void MultiChannelProcessor<T, BUFFER_SIZE, MAX_CHANNELS>::reset(const double sampling_freq) noexcept
+{
+    m_sampling_freq = sampling_freq;
+    for (auto& channel : m_channels)
+    {
+        channel.m_ring_buffer.reset_buffers();
+        channel.m_valid_entries = 0;
+        channel.m_oscillators.reset(sampling_freq);
+    }
+    m_active_rings = MAX_CHANNELS;
+}
+} // namespace LBTS::Spectral
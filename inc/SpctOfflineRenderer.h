@@ -0,0 +1,285 @@
+/**
+ * Author: Lucas Scheidt
+ * Date: 14.10.26
+ *
+ * Description: Non real-time rendering of whole buffers (bounces, server side rendering). Without a deadline the
+ * frames don't have to be analysed in the order they arrive: they get analysed in batches by a pool of threads, only
+ * the resynthesis runs sequentially from the results.
+ */
+
+#pragma once
+#include "SpctAnalysisFile.h"
+#include "SpctBufferManager.h"
+#include "SpctDenormals.h"
+#include "SpctDomainSpecific.h"
+#include "SpctFrameAnalyser.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace LBTS::Spectral
+{
+/// @brief Renders whole buffers through a BufferManager with the frame analysis spread over several threads.
+/// @tparam T: Type of the samples.
+/// @tparam BUFFER_SIZE: Has to match the BufferManager.
+/// @note The output is the same as the one of process_daw_chunk in the synchronous mode (the asynchronous and the
+/// incremental analysis only exist to meet the deadlines of a callback, offline there are none). The BufferManager is
+/// left in the state process_daw_chunk would have left it in, so streaming can go on afterwards.
+template <FloatingPt T, size_t BUFFER_SIZE = BoundedPowTwo_v<size_t, 1024>>
+    requires(is_bounded_pow_two(BUFFER_SIZE))
+class OfflineRenderer
+{
+  public:
+    /// @brief Frames analysed in parallel before they get resynthesized, bounds the memory of the results.
+    static constexpr size_t frames_per_batch = 256;
+
+    /// @brief Starts the threads (allocates, not real-time safe).
+    /// @param num_threads: Threads that analyse, including the one that calls render. 0 takes one per core.
+    explicit OfflineRenderer(const size_t num_threads = 0);
+
+    /// @note Deleted! The threads refer to this instance.
+    OfflineRenderer(const OfflineRenderer&) = delete;
+    /// @note Deleted! The threads refer to this instance.
+    OfflineRenderer& operator=(const OfflineRenderer&) = delete;
+
+    /// @brief Stops and joins the threads.
+    ~OfflineRenderer();
+
+    /// @brief Resynthesize a whole buffer in place (e.g. a file that was read or mapped into memory).
+    /// @param buffer_manager: Its settings (FFT size, hop, window, partial count, engine) are used and its state is
+    /// continued.
+    /// @param recorder: Stores the peaks of every frame for later re-renders (see AnalysisPlayback). A recording can
+    /// go on over several calls as long as the FFT and hop size stay the same.
+    void render(BufferManager<T, BUFFER_SIZE>& buffer_manager, T* samples, const size_t num_samples,
+                const T threshold = 1.0, AnalysisFileWriter* recorder = nullptr);
+
+    [[nodiscard]] size_t num_threads() const noexcept { return m_lanes.size(); }
+
+  private:
+    using Manager = BufferManager<T, BUFFER_SIZE>;
+
+    /// @brief Everything a thread needs to analyse frames on its own.
+    struct Lane
+    {
+        FrameAnalyser<T, Manager::min_fft_size, BUFFER_SIZE> m_frame_analyser{};
+        std::array<T, BUFFER_SIZE> m_frame{};
+    };
+
+    template <typename RESYNTH>
+    void render(Manager& buffer_manager, T* samples, const size_t num_samples, const T threshold,
+                AnalysisFileWriter* recorder, RESYNTH& resynthesizer);
+
+    /// @brief Analyse the frames of the current batch on all threads, returns when every frame is done.
+    void analyse_batch();
+
+    /// @brief Claim and analyse frames of the current batch until there are none left.
+    void analyse_frames(Lane& lane) noexcept;
+
+    void run(const size_t lane_index) noexcept;
+
+    std::vector<std::unique_ptr<Lane>> m_lanes;
+    // the current batch: original samples from N before the first frame end on, one frame ends every hop.
+    std::vector<T> m_batch_input{};
+    size_t m_num_frames = 0;
+    size_t m_first_frame_end = 0;
+    size_t m_fft_size = BUFFER_SIZE;
+    size_t m_hop_size = BUFFER_SIZE;
+    AnalysisWindow m_analysis_window = AnalysisWindow::RECTANGULAR;
+    T m_threshold = 1;
+    size_t m_max_entries = 0;
+    // the peaks of every frame of the batch, the threads analyse straight into them.
+    std::vector<PeakArr<T, Manager::partial_capacity>> m_results{};
+    std::vector<size_t> m_valid_entries{};
+    std::atomic<bool> m_running{true};
+    alignas(64) std::atomic<uint32_t> m_batch_generation{0};
+    alignas(64) std::atomic<size_t> m_next_frame{0};
+    alignas(64) std::atomic<size_t> m_idle_workers{0};
+    // started last, everything they touch is constructed by then.
+    std::vector<std::thread> m_workers{};
+};
+
+/**
+ * IMPLEMENTATION
+ */
+template <FloatingPt T, size_t BUFFER_SIZE>
+    requires(is_bounded_pow_two(BUFFER_SIZE))
+OfflineRenderer<T, BUFFER_SIZE>::OfflineRenderer(const size_t num_threads)
+{
+    const size_t num_lanes = num_threads > 0 ? num_threads : std::max(std::thread::hardware_concurrency(), 1U);
+    for (size_t lane = 0; lane < num_lanes; ++lane)
+    {
+        m_lanes.push_back(std::make_unique<Lane>());
+    }
+    m_results.resize(frames_per_batch);
+    m_valid_entries.resize(frames_per_batch);
+    // lane 0 belongs to the thread that calls render.
+    for (size_t lane = 1; lane < num_lanes; ++lane)
+    {
+        m_workers.emplace_back([this, lane] { run(lane); });
+    }
+}
+
+template <FloatingPt T, size_t BUFFER_SIZE>
+    requires(is_bounded_pow_two(BUFFER_SIZE))
+OfflineRenderer<T, BUFFER_SIZE>::~OfflineRenderer()
+{
+    m_running.store(false, std::memory_order_relaxed);
+    m_batch_generation.fetch_add(1, std::memory_order_release);
+    m_batch_generation.notify_all();
+    for (auto& worker : m_workers)
+    {
+        worker.join();
+    }
+}
+
+template <FloatingPt T, size_t BUFFER_SIZE>
+    requires(is_bounded_pow_two(BUFFER_SIZE))
+void OfflineRenderer<T, BUFFER_SIZE>::render(Manager& buffer_manager, T* samples, const size_t num_samples,
+                                             const T threshold, AnalysisFileWriter* recorder)
+{
+    if (recorder != nullptr && !recorder->begun())
+    {
+        const auto& ring_buffer = buffer_manager.m_ring_buffer;
+        recorder->begin({.m_fft_size = static_cast<uint32_t>(ring_buffer.size()),
+                         .m_hop_size = static_cast<uint32_t>(ring_buffer.hop_size()),
+                         .m_max_entries = static_cast<uint32_t>(buffer_manager.m_oscillators.partial_count()),
+                         .m_first_frame_end = static_cast<uint32_t>(ring_buffer.samples_to_next_frame()),
+                         .m_sampling_freq = buffer_manager.m_sampling_freq});
+    }
+    assert(recorder == nullptr || (recorder->format().m_fft_size == buffer_manager.m_ring_buffer.size() &&
+                                   recorder->format().m_hop_size == buffer_manager.m_ring_buffer.hop_size()));
+    if (buffer_manager.m_resynthesis_engine == ResynthesisEngine::INVERSE_FFT)
+    {
+        render(buffer_manager, samples, num_samples, threshold, recorder, *buffer_manager.m_ifft_resynth);
+        return;
+    }
+    render(buffer_manager, samples, num_samples, threshold, recorder, buffer_manager.m_oscillators);
+}
+
+template <FloatingPt T, size_t BUFFER_SIZE>
+    requires(is_bounded_pow_two(BUFFER_SIZE))
+template <typename RESYNTH>
+void OfflineRenderer<T, BUFFER_SIZE>::render(Manager& buffer_manager, T* samples, const size_t num_samples,
+                                             const T threshold, AnalysisFileWriter* recorder, RESYNTH& resynthesizer)
+{
+    // the same floating point mode as process_daw_chunk, otherwise the output would differ in the quiet parts.
+    const ScopedFlushDenormals flush_denormals{};
+    auto& ring_buffer = buffer_manager.m_ring_buffer;
+    m_fft_size = ring_buffer.size();
+    m_hop_size = ring_buffer.hop_size();
+    m_analysis_window = buffer_manager.m_analysis_window;
+    m_threshold = threshold;
+    m_max_entries = buffer_manager.m_oscillators.partial_count();
+    // the first frames reach back into the ring buffer: its samples, oldest first, precede the input.
+    std::vector<T> history(m_fft_size);
+    const size_t oldest_index = ring_buffer.current_index();
+    std::copy(ring_buffer.m_in_array.begin() + oldest_index,
+              ring_buffer.m_in_array.begin() + m_fft_size,
+              history.begin());
+    std::copy_n(ring_buffer.m_in_array.begin(), oldest_index, history.end() - oldest_index);
+    m_batch_input.reserve(m_fft_size + frames_per_batch * m_hop_size);
+
+    size_t position = 0;
+    while (position < num_samples)
+    {
+        // 1. the frames of the batch end every hop from the next frame boundary on.
+        m_first_frame_end = ring_buffer.samples_to_next_frame();
+        const size_t remaining = num_samples - position;
+        m_num_frames = m_first_frame_end > remaining
+                           ? 0
+                           : std::min(frames_per_batch, (remaining - m_first_frame_end) / m_hop_size + 1);
+        const size_t batch_size = m_num_frames > 0 ? m_first_frame_end + (m_num_frames - 1) * m_hop_size : remaining;
+        // 2. the originals, since the resynthesis overwrites them in place.
+        m_batch_input.assign(history.begin(), history.end());
+        m_batch_input.insert(m_batch_input.end(), samples + position, samples + position + batch_size);
+        std::copy(m_batch_input.end() - static_cast<std::ptrdiff_t>(m_fft_size), m_batch_input.end(), history.begin());
+        if (m_num_frames > 0)
+        {
+            analyse_batch();
+        }
+        // 3. the resynthesis in segments as in process_daw_chunk, the peaks come from the results.
+        size_t frame = 0;
+        for (size_t batch_index = 0; batch_index < batch_size;)
+        {
+            const size_t segment_size = std::min(batch_size - batch_index, ring_buffer.samples_to_next_frame());
+            T* segment = samples + position + batch_index;
+            const bool frame_complete = ring_buffer.fill_span(segment, segment_size);
+            resynthesizer.process(segment, segment_size);
+            batch_index += segment_size;
+            if (frame_complete)
+            {
+                buffer_manager.m_valid_entries = m_valid_entries[frame];
+                buffer_manager.m_peaks.assign(m_results[frame], m_valid_entries[frame]);
+                buffer_manager.tune(resynthesizer);
+                if (recorder != nullptr)
+                {
+                    recorder->append_frame(buffer_manager.m_peaks, m_valid_entries[frame]);
+                }
+                ++frame;
+            }
+        }
+        position += batch_size;
+    }
+}
+
+template <FloatingPt T, size_t BUFFER_SIZE>
+    requires(is_bounded_pow_two(BUFFER_SIZE))
+void OfflineRenderer<T, BUFFER_SIZE>::analyse_batch()
+{
+    const size_t num_workers = m_workers.size();
+    m_next_frame.store(0, std::memory_order_relaxed);
+    m_idle_workers.store(0, std::memory_order_relaxed);
+    // publishes the batch, the workers only claim frames after they saw the new generation.
+    m_batch_generation.fetch_add(1, std::memory_order_release);
+    m_batch_generation.notify_all();
+    analyse_frames(*m_lanes[0]);
+    // every worker runs out of frames before it goes idle, so all frames are done then.
+    size_t idle_workers = m_idle_workers.load(std::memory_order_acquire);
+    while (idle_workers != num_workers)
+    {
+        m_idle_workers.wait(idle_workers, std::memory_order_acquire);
+        idle_workers = m_idle_workers.load(std::memory_order_acquire);
+    }
+}
+
+template <FloatingPt T, size_t BUFFER_SIZE>
+    requires(is_bounded_pow_two(BUFFER_SIZE))
+void OfflineRenderer<T, BUFFER_SIZE>::analyse_frames(Lane& lane) noexcept
+{
+    lane.m_frame_analyser.select_fft_size(m_fft_size);
+    for (size_t frame = m_next_frame.fetch_add(1, std::memory_order_relaxed); frame < m_num_frames;
+         frame = m_next_frame.fetch_add(1, std::memory_order_relaxed))
+    {
+        // the frame that is complete at its end, oldest sample first (like the ring buffer at that point).
+        const size_t frame_start = m_first_frame_end + frame * m_hop_size;
+        std::copy_n(m_batch_input.begin() + static_cast<std::ptrdiff_t>(frame_start), m_fft_size, lane.m_frame.begin());
+        m_valid_entries[frame] = lane.m_frame_analyser.analyse(
+            lane.m_frame, 0, m_analysis_window, m_results[frame], m_threshold, m_max_entries);
+    }
+}
+
+template <FloatingPt T, size_t BUFFER_SIZE>
+    requires(is_bounded_pow_two(BUFFER_SIZE))
+void OfflineRenderer<T, BUFFER_SIZE>::run(const size_t lane_index) noexcept
+{
+    const ScopedFlushDenormals flush_denormals{};
+    uint32_t seen_generation = 0;
+    while (true)
+    {
+        m_batch_generation.wait(seen_generation, std::memory_order_acquire);
+        seen_generation = m_batch_generation.load(std::memory_order_acquire);
+        if (!m_running.load(std::memory_order_relaxed))
+        {
+            return;
+        }
+        analyse_frames(*m_lanes[lane_index]);
+        m_idle_workers.fetch_add(1, std::memory_order_release);
+        m_idle_workers.notify_one();
+    }
+}
+} // namespace LBTS::Spectral
@@ -0,0 +1,354 @@
+/**
+ * Author: Lucas Scheidt
+ * Date: 14.10.26
+ *
+ * Description: A bank of wavetable oscillators that all read from the same table. The state of the partials is stored
+ * in aligned parallel arrays (phase, increment, gain), so every SIMD instruction renders a whole register of partials
+ * instead of a single WTOscillator.
+ */
+
+#pragma once
+#include "SpctDomainSpecific.h"
+#include "SpctSimd.h"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+
+namespace LBTS::Spectral
+{
+/**
+ * @brief Oscillator bank with a runtime number of partials up to a compile-time capacity.
+ * @tparam T: Type of the wavetable entries and of the oscillator state.
+ * @tparam WT_SIZE: Size of the wavetable that will be read (power of two, so a cycle is the range of the phase).
+ * @tparam CAPACITY: Maximum number of partials, the arrays are padded to a multiple of the vector width.
+ * @tparam VEC: Vector implementation the partials get rendered with (ScalarVec for the reference path).
+ *
+ * @note
+ * The phase is a 32 bit fixed point number like in WTOscillator, one uint32_t lane per lane of T: the upper bits are
+ * the table index, the lower ones the fraction, and the wrap around is the overflow of the addition. The neighbours
+ * of the index are read without a mask, so the tables need the guard points of WaveTable / MipMappedWaveTable.
+ * Partials beyond the active count are silenced by a gain of zero, so a partially used register of partials can be
+ * rendered like any other.
+ */
+template <FloatingPt T, size_t WT_SIZE, size_t CAPACITY, typename VEC = SimdVec<T>>
+    requires(is_bounded_pow_two(WT_SIZE) && WT_SIZE >= 2 && CAPACITY > 0)
+class OscillatorBank
+{
+  public:
+    static constexpr size_t lane_width = VEC::width;
+    static constexpr size_t capacity = CAPACITY;
+    static constexpr size_t padded_capacity = (CAPACITY + lane_width - 1) / lane_width * lane_width;
+
+    /// @brief Tune a single partial right away.
+    /// @param partial: Index of the partial, has to be smaller than the capacity.
+    /// @param increment: Steps through the wavetable per sample (N_WT * f0 / fs).
+    /// @param gain: Linear amplitude of the partial.
+    /// @param table_offset: Start of the table of this partial relative to the passed wavetable (used to read a
+    /// different mip-map level per partial).
+    void set_partial(const size_t partial, const T increment, const T gain, const size_t table_offset = 0) noexcept
+    {
+        m_increments[partial] = m_target_increments[partial] = phase_increment_of(increment);
+        m_gains[partial] = m_target_gains[partial] = gain;
+        m_increment_steps[partial] = 0;
+        m_gain_steps[partial] = 0;
+        m_table_offsets[partial] = static_cast<uint32_t>(table_offset);
+    }
+
+    /// @brief Values a partial moves to during the next ramp (see start_ramp), the table offset changes right away.
+    void set_partial_target(const size_t partial, const T increment, const T gain,
+                            const size_t table_offset = 0) noexcept
+    {
+        m_target_increments[partial] = phase_increment_of(increment);
+        m_target_gains[partial] = gain;
+        m_table_offsets[partial] = static_cast<uint32_t>(table_offset);
+    }
+
+    /// @brief Let a partial fade out during the next ramp at the frequency it is heading to.
+    void fade_out_partial(const size_t partial) noexcept { m_target_gains[partial] = 0; }
+
+    /// @brief Increment the partial plays at the moment (in the middle of a ramp it is between start and target).
+    [[nodiscard]] T increment(const size_t partial) const noexcept
+    {
+        return static_cast<T>(m_increments[partial]) * fraction_scale;
+    }
+
+    /// @brief Linear by default, the cubic interpolation reaches the same quality with a smaller table (see
+    /// WTInterpolation). Takes effect with the next block.
+    void select_interpolation(const WTInterpolation interpolation) noexcept { m_interpolation = interpolation; }
+
+    [[nodiscard]] WTInterpolation interpolation() const noexcept { return m_interpolation; }
+
+    /// @brief Set how many partials are rendered, everything above the capacity is ignored. Ends a running ramp.
+    void set_active_partials(const size_t num_partials) noexcept
+    {
+        m_active_partials = std::min(num_partials, CAPACITY);
+        std::fill(m_gains.begin() + m_active_partials, m_gains.end(), static_cast<T>(0));
+        std::fill(m_target_gains.begin() + m_active_partials, m_target_gains.end(), static_cast<T>(0));
+        m_ramp_remaining = 0;
+    }
+
+    /// @brief Move the increments and gains of num_partials partials linearly to their targets over the next
+    /// num_samples samples (zero: right away). The partials above are silenced.
+    void start_ramp(const size_t num_samples, const size_t num_partials) noexcept;
+
+    [[nodiscard]] size_t active_partials() const noexcept { return m_active_partials; }
+
+    /// @brief Render the summed output of all active partials for one sample (per sample version of process, with a
+    /// single register of lane sums instead of the ones of a whole block).
+    T receive_output(const T* wavetable) noexcept
+    {
+        return m_interpolation == WTInterpolation::CUBIC_HERMITE
+                   ? receive_output_interpolated<WTInterpolation::CUBIC_HERMITE>(wavetable)
+                   : receive_output_interpolated<WTInterpolation::LINEAR>(wavetable);
+    }
+
+    /// @brief Render a whole block of the summed output of all active partials.
+    /// @param wavetable: First entry of the table with WT_SIZE entries (plus the largest table offset), with one guard
+    /// point before and two after every table (like WaveTable::data and MipMappedWaveTable::data).
+    /// @param output: Start of the block, gets overwritten.
+    /// @param num_samples: Length of the block.
+    void process(const T* wavetable, T* output, const size_t num_samples) noexcept
+    {
+        if (m_interpolation == WTInterpolation::CUBIC_HERMITE)
+        {
+            process_interpolated<WTInterpolation::CUBIC_HERMITE>(wavetable, output, num_samples);
+        }
+        else
+        {
+            process_interpolated<WTInterpolation::LINEAR>(wavetable, output, num_samples);
+        }
+    }
+
+    /// @brief Silence all partials and reset their phases.
+    void reset() noexcept
+    {
+        m_active_partials = 0;
+        m_phases.fill(0);
+        m_increments.fill(0);
+        m_gains.fill(0);
+        m_target_increments.fill(0);
+        m_target_gains.fill(0);
+        m_increment_steps.fill(0);
+        m_gain_steps.fill(0);
+        m_table_offsets.fill(0);
+        m_ramp_remaining = 0;
+    }
+
+  private:
+    // output samples that are accumulated per lane before the lanes get summed up.
+    static constexpr size_t block_size = 64;
+    // same fixed point format as WTOscillator.
+    static constexpr int fraction_bits = static_cast<int>(32 - degree_of_pow_two_value(WT_SIZE));
+    static constexpr uint32_t fraction_mask = static_cast<uint32_t>((uint64_t{1} << fraction_bits) - 1);
+    static constexpr T fraction_scale = static_cast<T>(1) / static_cast<T>(uint64_t{1} << fraction_bits);
+    static constexpr double phase_per_cycle = 4294967296.0;
+
+    /// @brief Fixed point phase increment of an increment in table entries per sample (rounded, below a cycle).
+    static uint32_t phase_increment_of(const T increment) noexcept
+    {
+        const double phase_increment = static_cast<double>(increment) * static_cast<double>(uint64_t{1} << fraction_bits);
+        return static_cast<uint32_t>(std::clamp(phase_increment + 0.5, 0.0, phase_per_cycle - 1.0));
+    }
+
+    /// @brief Value of the table at the phases of a register of partials.
+    template <WTInterpolation INTERPOLATION>
+    static typename VEC::reg interpolate(const T* wavetable, const typename VEC::ireg phase,
+                                         const typename VEC::ireg table_offset) noexcept;
+
+    template <WTInterpolation INTERPOLATION>
+    void process_interpolated(const T* wavetable, T* output, const size_t num_samples) noexcept;
+
+    template <WTInterpolation INTERPOLATION>
+    T receive_output_interpolated(const T* wavetable) noexcept;
+
+    alignas(64) std::array<uint32_t, padded_capacity> m_phases{};
+    alignas(64) std::array<uint32_t, padded_capacity> m_increments{};
+    alignas(64) std::array<T, padded_capacity> m_gains{};
+    alignas(64) std::array<uint32_t, padded_capacity> m_table_offsets{};
+    // the ramp adds one step per sample until the targets are reached. The increment steps are signed, stored as their
+    // two's complement the addition wraps to the right value.
+    alignas(64) std::array<uint32_t, padded_capacity> m_target_increments{};
+    alignas(64) std::array<T, padded_capacity> m_target_gains{};
+    alignas(64) std::array<uint32_t, padded_capacity> m_increment_steps{};
+    alignas(64) std::array<T, padded_capacity> m_gain_steps{};
+    size_t m_ramp_remaining = 0;
+    size_t m_active_partials = 0;
+    WTInterpolation m_interpolation = WTInterpolation::LINEAR;
+};
+
+/*
+ * IMPLEMENTATION
+ */
+template <FloatingPt T, size_t WT_SIZE, size_t CAPACITY, typename VEC>
+    requires(is_bounded_pow_two(WT_SIZE) && WT_SIZE >= 2 && CAPACITY > 0)
+void OscillatorBank<T, WT_SIZE, CAPACITY, VEC>::start_ramp(const size_t num_samples,
+                                                            const size_t num_partials) noexcept
+{
+    m_active_partials = std::min(num_partials, CAPACITY);
+    std::fill(m_target_gains.begin() + m_active_partials, m_target_gains.end(), static_cast<T>(0));
+    std::fill(m_gains.begin() + m_active_partials, m_gains.end(), static_cast<T>(0));
+    if (num_samples == 0)
+    {
+        m_increments = m_target_increments;
+        m_gains = m_target_gains;
+        m_ramp_remaining = 0;
+        return;
+    }
+    const T inv_num_samples = static_cast<T>(1) / static_cast<T>(num_samples);
+    const auto signed_num_samples = static_cast<int64_t>(num_samples);
+    for (size_t partial = 0; partial < padded_capacity; ++partial)
+    {
+        const int64_t increment_difference =
+            static_cast<int64_t>(m_target_increments[partial]) - static_cast<int64_t>(m_increments[partial]);
+        m_increment_steps[partial] = static_cast<uint32_t>(increment_difference / signed_num_samples);
+        m_gain_steps[partial] = (m_target_gains[partial] - m_gains[partial]) * inv_num_samples;
+    }
+    m_ramp_remaining = num_samples;
+}
+
+template <FloatingPt T, size_t WT_SIZE, size_t CAPACITY, typename VEC>
+    requires(is_bounded_pow_two(WT_SIZE) && WT_SIZE >= 2 && CAPACITY > 0)
+template <WTInterpolation INTERPOLATION>
+typename VEC::reg OscillatorBank<T, WT_SIZE, CAPACITY, VEC>::interpolate(const T* wavetable,
+                                                                          const typename VEC::ireg phase,
+                                                                          const typename VEC::ireg table_offset) noexcept
+{
+    // the neighbours are gathered with the same indices from the shifted table (guard points, no mask).
+    const auto index = VEC::add_u32(table_offset, VEC::template shift_right_u32<fraction_bits>(phase));
+    const auto fraction =
+        VEC::mul(VEC::to_float(VEC::and_u32(phase, VEC::broadcast_u32(fraction_mask))), VEC::broadcast(fraction_scale));
+    const auto value_0 = VEC::gather(wavetable, index);
+    const auto value_1 = VEC::gather(wavetable + 1, index);
+    if constexpr (INTERPOLATION == WTInterpolation::CUBIC_HERMITE)
+    {
+        // same polynomial as hermite_interpolation.
+        const auto value_m1 = VEC::gather(wavetable - 1, index);
+        const auto value_2 = VEC::gather(wavetable + 2, index);
+        const auto half = VEC::broadcast(static_cast<T>(0.5));
+        const auto slope = VEC::mul(half, VEC::sub(value_1, value_m1));
+        const auto cubic = VEC::add(VEC::mul(half, VEC::sub(value_2, value_m1)),
+                                    VEC::mul(VEC::broadcast(static_cast<T>(1.5)), VEC::sub(value_0, value_1)));
+        const auto quadratic =
+            VEC::sub(VEC::add(value_m1, VEC::add(value_1, value_1)),
+                     VEC::add(VEC::mul(VEC::broadcast(static_cast<T>(2.5)), value_0), VEC::mul(half, value_2)));
+        return VEC::add(
+            VEC::mul(VEC::add(VEC::mul(VEC::add(VEC::mul(cubic, fraction), quadratic), fraction), slope), fraction),
+            value_0);
+    }
+    else
+    {
+        return VEC::add(value_0, VEC::mul(fraction, VEC::sub(value_1, value_0)));
+    }
+}
+
+template <FloatingPt T, size_t WT_SIZE, size_t CAPACITY, typename VEC>
+    requires(is_bounded_pow_two(WT_SIZE) && WT_SIZE >= 2 && CAPACITY > 0)
+template <WTInterpolation INTERPOLATION>
+T OscillatorBank<T, WT_SIZE, CAPACITY, VEC>::receive_output_interpolated(const T* wavetable) noexcept
+{
+    const size_t active_lanes_end = (m_active_partials + lane_width - 1) / lane_width * lane_width;
+    const bool ramping = m_ramp_remaining > 0;
+    auto lane_sum = VEC::broadcast(static_cast<T>(0));
+    for (size_t partial = 0; partial < active_lanes_end; partial += lane_width)
+    {
+        const auto phase = VEC::load_u32(m_phases.data() + partial);
+        const auto increment = VEC::load_u32(m_increments.data() + partial);
+        const auto gain = VEC::load(m_gains.data() + partial);
+        const auto value = interpolate<INTERPOLATION>(wavetable, phase, VEC::load_u32(m_table_offsets.data() + partial));
+        lane_sum = VEC::add(lane_sum, VEC::mul(gain, value));
+        VEC::store_u32(m_phases.data() + partial, VEC::add_u32(phase, increment));
+        if (ramping)
+        {
+            VEC::store_u32(m_increments.data() + partial,
+                           VEC::add_u32(increment, VEC::load_u32(m_increment_steps.data() + partial)));
+            VEC::store(m_gains.data() + partial, VEC::add(gain, VEC::load(m_gain_steps.data() + partial)));
+        }
+    }
+    if (ramping && --m_ramp_remaining == 0)
+    {
+        // end exactly on the targets like process.
+        m_increments = m_target_increments;
+        m_gains = m_target_gains;
+    }
+    alignas(64) std::array<T, lane_width> lanes{};
+    VEC::store(lanes.data(), lane_sum);
+    T output = 0;
+    for (const T lane : lanes)
+    {
+        output += lane;
+    }
+    return output;
+}
+
+template <FloatingPt T, size_t WT_SIZE, size_t CAPACITY, typename VEC>
+    requires(is_bounded_pow_two(WT_SIZE) && WT_SIZE >= 2 && CAPACITY > 0)
+template <WTInterpolation INTERPOLATION>
+void OscillatorBank<T, WT_SIZE, CAPACITY, VEC>::process_interpolated(const T* wavetable, T* output,
+                                                                      const size_t num_samples) noexcept
+{
+    // every register of partials is rendered across the whole block while its state stays in registers. The lanes are
+    // accumulated separately and only summed up once per sample at the end, independent of the number of partials.
+    const size_t active_lanes_end = (m_active_partials + lane_width - 1) / lane_width * lane_width;
+    for (size_t block_start = 0; block_start < num_samples; block_start += block_size)
+    {
+        const size_t block_length = std::min(block_size, num_samples - block_start);
+        // the first samples of the block may still belong to a ramp, the rest plays steady.
+        const size_t ramp_length = std::min(block_length, m_ramp_remaining);
+        alignas(64) std::array<T, block_size * lane_width> lane_sums{};
+        for (size_t partial = 0; partial < active_lanes_end; partial += lane_width)
+        {
+            auto phase = VEC::load_u32(m_phases.data() + partial);
+            auto increment = VEC::load_u32(m_increments.data() + partial);
+            auto gain = VEC::load(m_gains.data() + partial);
+            const auto table_offset = VEC::load_u32(m_table_offsets.data() + partial);
+            const auto render_sample = [&](const size_t sample)
+            {
+                const auto value = interpolate<INTERPOLATION>(wavetable, phase, table_offset);
+                T* sums = lane_sums.data() + sample * lane_width;
+                VEC::store(sums, VEC::add(VEC::load(sums), VEC::mul(gain, value)));
+                phase = VEC::add_u32(phase, increment);
+            };
+            if (ramp_length > 0)
+            {
+                const auto increment_step = VEC::load_u32(m_increment_steps.data() + partial);
+                const auto gain_step = VEC::load(m_gain_steps.data() + partial);
+                for (size_t sample = 0; sample < ramp_length; ++sample)
+                {
+                    render_sample(sample);
+                    increment = VEC::add_u32(increment, increment_step);
+                    gain = VEC::add(gain, gain_step);
+                }
+                if (ramp_length == m_ramp_remaining)
+                {
+                    // the rest of the block already plays the exact targets.
+                    increment = VEC::load_u32(m_target_increments.data() + partial);
+                    gain = VEC::load(m_target_gains.data() + partial);
+                }
+                VEC::store_u32(m_increments.data() + partial, increment);
+                VEC::store(m_gains.data() + partial, gain);
+            }
+            for (size_t sample = ramp_length; sample < block_length; ++sample)
+            {
+                render_sample(sample);
+            }
+            VEC::store_u32(m_phases.data() + partial, phase);
+        }
+        if (ramp_length > 0 && (m_ramp_remaining -= ramp_length) == 0)
+        {
+            // end exactly on the targets, the sum of the steps drifts a little.
+            m_increments = m_target_increments;
+            m_gains = m_target_gains;
+        }
+        for (size_t sample = 0; sample < block_length; ++sample)
+        {
+            const T* sums = lane_sums.data() + sample * lane_width;
+            T summed_output = 0;
+            for (size_t lane = 0; lane < lane_width; ++lane)
+            {
+                summed_output += sums[lane];
+            }
+            output[block_start + sample] = summed_output;
+        }
+    }
+}
+} // namespace LBTS::Spectral
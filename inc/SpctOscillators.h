@@ -9,16 +9,33 @@
 
 #pragma once
 #include "SpctDomainSpecific.h"
+#include "SpctOscillatorBank.h"
 #include "SpctWavetables.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
 
 namespace LBTS::Spectral
 {
+/// @brief Cubic Hermite (Catmull-Rom) interpolation between value_0 and value_1 with the neighbours on both sides.
+/// @param fraction: Position between value_0 (0) and value_1 (1).
+template <FloatingPt T>
+constexpr T hermite_interpolation(const T value_m1, const T value_0, const T value_1, const T value_2,
+                                  const T fraction) noexcept
+{
+    const T slope = static_cast<T>(0.5) * (value_1 - value_m1);
+    const T cubic = static_cast<T>(0.5) * (value_2 - value_m1) + static_cast<T>(1.5) * (value_0 - value_1);
+    const T quadratic = value_m1 - static_cast<T>(2.5) * value_0 + 2 * value_1 - static_cast<T>(0.5) * value_2;
+    return ((cubic * fraction + quadratic) * fraction + slope) * fraction + value_0;
+}
 
 /// @brief A single wavetable oscillator.
 /// @tparam T The type of the wavetable entries.
 /// @tparam WT_SIZE The size of the wavetable that will be read.
 template <FloatingPt T, size_t WT_SIZE>
-    requires(is_bounded_pow_two(WT_SIZE))
+    requires(is_bounded_pow_two(WT_SIZE) && WT_SIZE >= 2)
 class WTOscillator
 {
   public:
@@ -34,6 +51,16 @@ class WTOscillator
           m_wt_ptr{wt_ptr}
     {}
 
+    /// @brief Band-limited creation, the level of the mip map gets picked by tune.
+    /// @param sampling_freq Specified by DAW environment.
+    /// @param mip_map_ptr Pointer to the mip-mapped wavetable, HAS TO BE VALID.
+    WTOscillator(const double sampling_freq, const MipMappedWaveTable<T, WT_SIZE>* mip_map_ptr)
+        : m_sampling_freq{sampling_freq},
+          m_inv_sampling_freq{1.0 / sampling_freq},
+          m_mip_map_ptr{mip_map_ptr},
+          m_table{mip_map_ptr->level(0)}
+    {}
+
     /// @note Deleted, no copies to be faster!
     WTOscillator(const WTOscillator&) noexcept = delete;
     /// @note Deleted, no copies to be faster!
@@ -47,7 +74,7 @@ class WTOscillator
     ~WTOscillator() = default;
 
     /// @brief Get the current output value of the oscillator and increase the phase to the next wavetable entry.
-    /// @return The interpolated value of between two wavetable entries.
+    /// @return The interpolated value of between two wavetable entries (see select_interpolation).
     /// @note Since this get's called in the main audio loop the wavetable pointer HAS TO BE VALID when calling this
     /// function! Checking this inside the function is too expensive.
     T receive_output() noexcept;
@@ -56,37 +83,65 @@ class WTOscillator
     /// @param sampling_freq The wanted sampling frequency.
     void reset(const double sampling_freq) noexcept;
 
-    /// @brief This will set the increment rate inside the wavetable.
+    /// @brief This will set the increment rate inside the wavetable. With a mip map the matching band-limited level
+    /// gets selected as well (once per retune, not per sample).
     /// @param to_freq The oscillator will output it's waveform with this frequency (in Hz).
     void tune(T to_freq) noexcept;
 
+    /// @brief Linear by default, the cubic interpolation reaches the same quality with a smaller table.
+    void select_interpolation(const WTInterpolation interpolation) noexcept { m_interpolation = interpolation; }
+
+    [[nodiscard]] WTInterpolation interpolation() const noexcept { return m_interpolation; }
+
     /// @brief Change the look up table.
     /// @param wt_ptr A pointer to the wanted lookup table.
-    void change_waveform(const WaveTable<T, WT_SIZE>* wt_ptr) { m_wt_ptr = wt_ptr; }
+    void change_waveform(const WaveTable<T, WT_SIZE>* wt_ptr)
+    {
+        m_wt_ptr = wt_ptr;
+        m_mip_map_ptr = nullptr;
+        m_table = wt_ptr != nullptr ? wt_ptr->data() : nullptr;
+    }
+
+    /// @brief Change the look up table to a mip-mapped one, the level matching the current tuning is kept.
+    /// @param mip_map_ptr A pointer to the wanted mip map, HAS TO BE VALID.
+    void change_waveform(const MipMappedWaveTable<T, WT_SIZE>* mip_map_ptr)
+    {
+        m_wt_ptr = nullptr;
+        m_mip_map_ptr = mip_map_ptr;
+        m_table = mip_map_ptr->level(MipMappedWaveTable<T, WT_SIZE>::level_for_increment(table_increment()));
+    }
 
   private:
-    // float is precise enough for interpolation between indices
-    float m_table_index = 0.0f;
-    float m_index_increment = 0.0f;
+    // the phase is a 32 bit fixed point number, the upper bits are the table index, the lower ones the fraction. A
+    // cycle of the table is exactly the range of uint32_t, so the wrap around is the overflow of the addition.
+    static constexpr uint32_t fraction_bits = 32 - degree_of_pow_two_value(WT_SIZE);
+    static constexpr uint32_t fraction_mask = static_cast<uint32_t>((uint64_t{1} << fraction_bits) - 1);
+    static constexpr T fraction_scale = static_cast<T>(1) / static_cast<T>(uint64_t{1} << fraction_bits);
+    static constexpr double phase_per_cycle = 4294967296.0;
+
+    /// @brief Table entries per sample.
+    [[nodiscard]] T table_increment() const noexcept { return static_cast<T>(m_phase_increment) * fraction_scale; }
+
+    uint32_t m_phase = 0;
+    uint32_t m_phase_increment = 0;
+    WTInterpolation m_interpolation = WTInterpolation::LINEAR;
     double m_sampling_freq = 44100.0;
     double m_nyquist_freq = m_sampling_freq / 2.0;
     double m_inv_sampling_freq = 1.0 / m_sampling_freq;
     const WaveTable<T, WT_SIZE>* m_wt_ptr = nullptr;
+    const MipMappedWaveTable<T, WT_SIZE>* m_mip_map_ptr = nullptr;
+    // the table (or level) that is actually read
+    const T* m_table = m_wt_ptr != nullptr ? m_wt_ptr->data() : nullptr;
     bool m_valid_instantiation = false;
 };
 
-/// @brief Type definition for an array of wavetable oscillators.
-/// @tparam T The type of the wavetable entries.
-/// @tparam WT_SIZE The size of the wavetable that will be read.
-template <FloatingPt T, size_t WT_SIZE>
-    requires(is_bounded_pow_two(WT_SIZE))
-using OscArray = std::array<WTOscillator<T, WT_SIZE>, max_oscillators>;
-
 /// @brief Object containing all oscillators that will resynthesize the FFT transformed input.
+/// The oscillators are rendered by an OscillatorBank, so several partials are rendered with every SIMD instruction.
 /// @tparam T The type of the wavetable entries.
 /// @tparam WT_SIZE The size of the wavetable that will be read.
 /// @tparam FFT_SIZE Samples used for the fourier transformation.
-template <FloatingPt T, size_t WT_SIZE, size_t FFT_SIZE>
+/// @tparam MAX_PARTIALS Compile-time capacity, the number of partials that actually play is set at runtime.
+template <FloatingPt T, size_t WT_SIZE, size_t FFT_SIZE, size_t MAX_PARTIALS = max_partials>
     requires(is_bounded_pow_two(WT_SIZE))
 class ResynthOscs
 {
@@ -110,20 +165,40 @@ class ResynthOscs
     /// @brief Defaulted since no dynamic resources were acquired.
     ~ResynthOscs() = default;
 
-    /// @brief Get the summed output of all playing oscillators.
-    /// @param bin_mag_arr Array containing pairs of the frequency bin and it's asociated amplitude (needed for
-    /// amplitude calculation).
-    /// @param valid_entries How many oscillators should play (determined by the maximum available oscillators and the
-    /// amplitudes above a given threshold).
+    /// @brief Get the summed output of all playing oscillators for one sample (per sample version of process).
     /// @return The summed output.
-    T receive_output(const BinMagArr<T, (FFT_SIZE >> 1)>& bin_mag_arr, const size_t valid_entries) noexcept;
+    T receive_output() noexcept;
 
-    /// @brief Tune every oscillator to it's appropriate frequency.
-    /// @param bin_mag_arr Array containing pairs of the frequency bin and it's asociated amplitude (needed for
-    /// frequency calculation).
-    /// @param valid_entries How many oscillators should play (determined by the maximum available oscillators and the
-    /// amplitudes above a given threshold).
-    void tune_oscillators(const BinMagArr<T, (FFT_SIZE >> 1)>& bin_mag_arr, const size_t valid_entries) noexcept;
+    /// @brief Render a whole block of the summed output of all playing oscillators.
+    /// @param output Start of the block, gets overwritten.
+    /// @param num_samples Length of the block.
+    void process(T* output, const size_t num_samples) noexcept;
+
+    /// @brief Tune every oscillator to it's appropriate frequency and calculate it's gain (once per retune instead of
+    /// once per sample).
+    /// @param peaks The frequency bins and their asociated amplitudes (needed for frequency and amplitude
+    /// calculation).
+    /// @param valid_entries How many oscillators should play (determined by the partial count and the amplitudes above
+    /// a given threshold).
+    /// @param frequency_ratio Transposition of every partial (e.g. 2 for an octave up), partials that would end up at
+    /// or above nyquist are silenced.
+    /// @note With a retune ramp (see set_retune_ramp) every peak continues the partial of the previous frame closest
+    /// in frequency, so the oscillator keeps its phase. Partials without a successor fade out, new ones fade in.
+    /// Without peaks (e.g. a silent frame) the partials always fade out over the hop (see set_hop_size), with or
+    /// without a retune ramp, instead of being cut at the frame boundary.
+    void tune_oscillators(const PeakArr<T, MAX_PARTIALS>& peaks, const size_t valid_entries,
+                          const double frequency_ratio = 1.0) noexcept;
+
+    /// @brief Glide the frequencies and amplitudes over the given number of samples after every retune instead of
+    /// jumping (the hop size hides the steps of the frames without long frames). Zero jumps (default).
+    void set_retune_ramp(const size_t num_samples) noexcept { m_retune_ramp = num_samples; }
+
+    [[nodiscard]] size_t retune_ramp() const noexcept { return m_retune_ramp; }
+
+    /// @brief Distance between two retunes, the partials fade out over it when a frame has no peaks at all.
+    void set_hop_size(const size_t hop_size) noexcept { m_hop_size = hop_size; }
+
+    [[nodiscard]] size_t hop_size() const noexcept { return m_hop_size; }
 
     /// @brief Reset all oscillators to a given sampling frequency.
     /// @param sampling_freq Determined by the DAW.
@@ -134,58 +209,106 @@ class ResynthOscs
     /// wavetable).
     void select_waveform(const OscWaveform& osc_waveform) noexcept;
 
+    /// @brief How the oscillators read between two table entries (linear by default).
+    void select_interpolation(const WTInterpolation interpolation) noexcept { m_bank.select_interpolation(interpolation); }
+
+    [[nodiscard]] WTInterpolation interpolation() const noexcept { return m_bank.interpolation(); }
+
+    /// @brief Set the maximum number of partials that play at once (clamped to MAX_PARTIALS).
+    void set_partial_count(const size_t partial_count) noexcept { m_partial_count = std::min(partial_count, MAX_PARTIALS); }
+
+    [[nodiscard]] size_t partial_count() const noexcept { return m_partial_count; }
+
+    /// @brief Size of the transformation the bins passed to tune_oscillators belong to (up to FFT_SIZE). Determines the
+    /// frequency resolution and the amplitude correction, the oscillators keep playing until they get retuned.
+    void set_fft_size(const size_t fft_size) noexcept;
+
+    // peaks further apart (in bins) than this are different partials.
+    static constexpr T max_track_deviation = static_cast<T>(1.5);
+
   public:
-    // generate wavetables
-    const SineWT<T, WT_SIZE> m_sin_wt{};
-    const SquareWT<T, WT_SIZE> m_square_wt{};
-    const TriWT<T, WT_SIZE> m_tri_wt{};
-    const SawWT<T, WT_SIZE> m_saw_wt{};
+    using SharedTables = SharedWaveTables<T, WT_SIZE>;
+    // band-limited wavetables, generated at compile time and shared between all instances
+    const typename SharedTables::Handle m_sin_wt = SharedTables::acquire(OscWaveform::SINE);
+    const typename SharedTables::Handle m_square_wt = SharedTables::acquire(OscWaveform::SQUARE);
+    const typename SharedTables::Handle m_tri_wt = SharedTables::acquire(OscWaveform::TRIANGLE);
+    const typename SharedTables::Handle m_saw_wt = SharedTables::acquire(OscWaveform::SAW);
 
   private:
+    /// @brief tune_oscillators with a retune ramp.
+    void retune_tracked(const PeakArr<T, MAX_PARTIALS>& peaks, const size_t num_peaks,
+                        const double frequency_ratio) noexcept;
+
+    /// @brief Increment of a frequency, zero at or above nyquist.
+    [[nodiscard]] T increment_of_bin(const T bin, const double frequency_ratio) const noexcept
+    {
+        const double to_freq = bin * m_freq_resolution * frequency_ratio;
+        return to_freq < m_nyquist_freq ? static_cast<T>(WT_SIZE * to_freq * m_inv_sampling_freq) : 0;
+    }
+
+    static constexpr T no_track = -1;
+
     double m_sampling_freq;
     double m_freq_resolution;
-    const T m_amp_correction = static_cast<T>(2) / FFT_SIZE;
-    OscArray<T, WT_SIZE> m_osc_array;
+    double m_nyquist_freq;
+    double m_inv_sampling_freq;
+    size_t m_fft_size = FFT_SIZE;
+    T m_amp_correction = static_cast<T>(2) / FFT_SIZE;
+    const MipMappedWaveTable<T, WT_SIZE>* m_wt_ptr = m_sin_wt;
+    size_t m_partial_count = std::min<size_t>(max_oscillators, MAX_PARTIALS);
+    OscillatorBank<T, WT_SIZE, MAX_PARTIALS> m_bank{};
+    size_t m_retune_ramp = 0;
+    // the full frame by default (no overlap).
+    size_t m_hop_size = FFT_SIZE;
+    // bin every oscillator plays (no_track if it is idle or fading out), oscillators from m_num_tracks on are idle.
+    std::array<T, MAX_PARTIALS> m_track_bins = filled_array(no_track);
+    size_t m_num_tracks = 0;
+    // working arrays of the tracking
+    std::array<size_t, MAX_PARTIALS> m_peak_order{};
+    std::array<size_t, MAX_PARTIALS> m_track_order{};
+    std::array<size_t, MAX_PARTIALS> m_peak_oscillators{};
+    std::array<bool, MAX_PARTIALS> m_busy_oscillators{};
+
+    static constexpr std::array<T, MAX_PARTIALS> filled_array(const T value) noexcept
+    {
+        std::array<T, MAX_PARTIALS> array{};
+        array.fill(value);
+        return array;
+    }
 };
 
 /*
  * IMPLEMENTATION
  */
 template <FloatingPt T, size_t WT_SIZE>
-    requires(is_bounded_pow_two(WT_SIZE))
+    requires(is_bounded_pow_two(WT_SIZE) && WT_SIZE >= 2)
 T WTOscillator<T, WT_SIZE>::receive_output() noexcept
 {
-    // 1. determine the index as a whole number
-    // 2. get the index above that number and wrap around if 1. is the last index of the WT
-    const auto current_index = static_cast<size_t>(m_table_index);
-    const size_t next_index = (current_index == WT_SIZE - 1) ? 0 : current_index + 1;
-    // 3. get the values at these indices
-    const T value_a = (*m_wt_ptr)[current_index];
-    const T value_b = (*m_wt_ptr)[next_index];
-    // 4. get the fraction offset and interpolate the output value
-    const float fraction = m_table_index - current_index;
-    const T output = value_a + fraction * (value_b - value_a);
-    // 5. wrap if needed
-    if ((m_table_index += m_index_increment) >= WT_SIZE)
-    {
-        m_table_index -= WT_SIZE;
-    }
+    // 1. split the phase into the index and the fraction, the neighbours of the index are always valid (guard points)
+    const T* entry = m_table + (m_phase >> fraction_bits);
+    const T fraction = static_cast<T>(m_phase & fraction_mask) * fraction_scale;
+    // 2. interpolate the output value
+    const T output = m_interpolation == WTInterpolation::CUBIC_HERMITE
+                         ? hermite_interpolation(entry[-1], entry[0], entry[1], entry[2], fraction)
+                         : entry[0] + fraction * (entry[1] - entry[0]);
+    // 3. advance, wraps on its own
+    m_phase += m_phase_increment;
     return output;
 }
 
 template <FloatingPt T, size_t WT_SIZE>
-    requires(is_bounded_pow_two(WT_SIZE))
+    requires(is_bounded_pow_two(WT_SIZE) && WT_SIZE >= 2)
 void WTOscillator<T, WT_SIZE>::reset(const double sampling_freq) noexcept
 {
-    m_table_index = 0.0f;
-    m_index_increment = 0.0f;
+    m_phase = 0;
+    m_phase_increment = 0;
     m_sampling_freq = sampling_freq;
     m_nyquist_freq = sampling_freq / 2.0;
     m_inv_sampling_freq = 1.0 / sampling_freq;
 }
 
 template <FloatingPt T, size_t WT_SIZE>
-    requires(is_bounded_pow_two(WT_SIZE))
+    requires(is_bounded_pow_two(WT_SIZE) && WT_SIZE >= 2)
 void WTOscillator<T, WT_SIZE>::tune(T to_freq) noexcept
 {
     // be sure not to tune above nyquist!
@@ -193,87 +316,257 @@ void WTOscillator<T, WT_SIZE>::tune(T to_freq) noexcept
     {
         to_freq = m_nyquist_freq;
     }
-    // increment = N_WT * f0 / fs
-    // steps from one sample to the next
-    m_index_increment = WT_SIZE * to_freq * m_inv_sampling_freq;
+    // increment = f0 / fs cycles per sample, in units of 2^-32 (nyquist is 2^31, so it always fits).
+    const double cycles = std::max(static_cast<double>(to_freq), 0.0) * m_inv_sampling_freq;
+    m_phase_increment = static_cast<uint32_t>(std::min(cycles * phase_per_cycle + 0.5, phase_per_cycle - 1.0));
+    if (m_mip_map_ptr != nullptr)
+    {
+        m_table = m_mip_map_ptr->level(MipMappedWaveTable<T, WT_SIZE>::level_for_increment(table_increment()));
+    }
 }
 
-template <FloatingPt T, size_t WT_SIZE, size_t FFT_SIZE>
+template <FloatingPt T, size_t WT_SIZE, size_t FFT_SIZE, size_t MAX_PARTIALS>
     requires(is_bounded_pow_two(WT_SIZE))
-ResynthOscs<T, WT_SIZE, FFT_SIZE>::ResynthOscs(const double sampling_freq)
+ResynthOscs<T, WT_SIZE, FFT_SIZE, MAX_PARTIALS>::ResynthOscs(const double sampling_freq)
     : m_sampling_freq{sampling_freq},
-      m_freq_resolution{sampling_freq / static_cast<double>(FFT_SIZE)}
+      m_freq_resolution{sampling_freq / static_cast<double>(FFT_SIZE)},
+      m_nyquist_freq{sampling_freq / 2.0},
+      m_inv_sampling_freq{1.0 / sampling_freq}
 {
-    for (auto& osc : m_osc_array)
-    {
-        osc = WTOscillator<T, WT_SIZE>{sampling_freq, &m_sin_wt};
-    }
 }
 
-template <FloatingPt T, size_t WT_SIZE, size_t FFT_SIZE>
+template <FloatingPt T, size_t WT_SIZE, size_t FFT_SIZE, size_t MAX_PARTIALS>
+    requires(is_bounded_pow_two(WT_SIZE))
+T ResynthOscs<T, WT_SIZE, FFT_SIZE, MAX_PARTIALS>::receive_output() noexcept
+{
+    return m_bank.receive_output(m_wt_ptr->data());
+}
+
+template <FloatingPt T, size_t WT_SIZE, size_t FFT_SIZE, size_t MAX_PARTIALS>
     requires(is_bounded_pow_two(WT_SIZE))
-T ResynthOscs<T, WT_SIZE, FFT_SIZE>::receive_output(const BinMagArr<T, (FFT_SIZE >> 1)>& bin_mag_arr,
-                                                  const size_t valid_entries) noexcept
+void ResynthOscs<T, WT_SIZE, FFT_SIZE, MAX_PARTIALS>::process(T* output, const size_t num_samples) noexcept
 {
-    // valid entries is guaranteed to be smaller then max_oscillators!
-    T summed_output = 0;
-    for (size_t active_osc = 0; active_osc < valid_entries; ++active_osc)
+    m_bank.process(m_wt_ptr->data(), output, num_samples);
+}
+
+template <FloatingPt T, size_t WT_SIZE, size_t FFT_SIZE, size_t MAX_PARTIALS>
+    requires(is_bounded_pow_two(WT_SIZE))
+void ResynthOscs<T, WT_SIZE, FFT_SIZE, MAX_PARTIALS>::tune_oscillators(
+    const PeakArr<T, MAX_PARTIALS>& peaks, const size_t valid_entries, const double frequency_ratio) noexcept
+{
+    // more peaks than partials (e.g. from an analysis with a larger partial count) are ignored.
+    const size_t num_partials = std::min(valid_entries, m_partial_count);
+    if (m_retune_ramp > 0)
     {
-        summed_output += m_amp_correction * bin_mag_arr[active_osc].second * m_osc_array[active_osc].receive_output();
+        retune_tracked(peaks, num_partials, frequency_ratio);
+        return;
     }
-    return summed_output;
+    if (num_partials == 0 && m_num_tracks > 0)
+    {
+        // nothing left to play: the partials of the previous frame fade out instead of stopping with a click. They are
+        // silent by the next frame, which stops them for good.
+        for (size_t partial = 0; partial < m_num_tracks; ++partial)
+        {
+            m_bank.fade_out_partial(partial);
+        }
+        m_bank.start_ramp(m_hop_size, m_num_tracks);
+        std::fill(m_track_bins.begin(), m_track_bins.begin() + m_num_tracks, no_track);
+        m_num_tracks = 0;
+        return;
+    }
+    // the oscillators are assigned in the order of the peaks, the tracks are kept up to date for the ramps.
+    std::fill(
+        m_track_bins.begin() + num_partials, m_track_bins.begin() + std::max(num_partials, m_num_tracks), no_track);
+    m_num_tracks = num_partials;
+    for (size_t active_osc = 0; active_osc < num_partials; ++active_osc)
+    {
+        m_track_bins[active_osc] = peaks.bin(active_osc);
+        // be sure not to play above nyquist! (only possible with a transposition, the bins are below nyquist)
+        const double to_freq = peaks.bin(active_osc) * m_freq_resolution * frequency_ratio;
+        if (to_freq >= m_nyquist_freq)
+        {
+            m_bank.set_partial(active_osc, 0, 0);
+            continue;
+        }
+        // increment = N_WT * f0 / fs, the mip-map level is chosen once per retune.
+        const auto increment = static_cast<T>(WT_SIZE * to_freq * m_inv_sampling_freq);
+        const size_t level = MipMappedWaveTable<T, WT_SIZE>::level_for_increment(increment);
+        m_bank.set_partial(active_osc,
+                           increment,
+                           m_amp_correction * peaks.magnitude(active_osc),
+                           MipMappedWaveTable<T, WT_SIZE>::level_offset(level));
+    }
+    m_bank.set_active_partials(num_partials);
 }
 
-template <FloatingPt T, size_t WT_SIZE, size_t FFT_SIZE>
+template <FloatingPt T, size_t WT_SIZE, size_t FFT_SIZE, size_t MAX_PARTIALS>
     requires(is_bounded_pow_two(WT_SIZE))
-void ResynthOscs<T, WT_SIZE, FFT_SIZE>::tune_oscillators(const BinMagArr<T, (FFT_SIZE >> 1)>& bin_mag_arr,
-                                                         const size_t valid_entries) noexcept
+void ResynthOscs<T, WT_SIZE, FFT_SIZE, MAX_PARTIALS>::retune_tracked(const PeakArr<T, MAX_PARTIALS>& peaks,
+                                                                     const size_t num_peaks,
+                                                                     const double frequency_ratio) noexcept
 {
-    // valid entries is guaranteed to be smaller then max_oscillators!
-    for (size_t active_osc = 0; active_osc < valid_entries; ++active_osc)
+    using MipMap = MipMappedWaveTable<T, WT_SIZE>;
+    constexpr size_t no_oscillator = MAX_PARTIALS;
+    // 1. peaks and tracks in ascending order of their bins, so they can be matched in one pass.
+    const auto peak_bin = [&peaks](const size_t peak) { return peaks.bin(peak); };
+    const auto track_bin = [this](const size_t oscillator) { return m_track_bins[oscillator]; };
+    std::iota(m_peak_order.begin(), m_peak_order.begin() + num_peaks, size_t{0});
+    std::sort(m_peak_order.begin(),
+              m_peak_order.begin() + num_peaks,
+              [&](const size_t peak_a, const size_t peak_b) { return peak_bin(peak_a) < peak_bin(peak_b); });
+    size_t num_tracks = 0;
+    for (size_t oscillator = 0; oscillator < m_num_tracks; ++oscillator)
     {
-        const T to_freq = bin_mag_arr[active_osc].first * m_freq_resolution;
-        m_osc_array[active_osc].tune(to_freq);
+        if (m_track_bins[oscillator] != no_track)
+        {
+            m_track_order[num_tracks++] = oscillator;
+        }
     }
+    std::sort(m_track_order.begin(),
+              m_track_order.begin() + num_tracks,
+              [&](const size_t osc_a, const size_t osc_b) { return track_bin(osc_a) < track_bin(osc_b); });
+
+    // 2. every peak continues the closest track within max_track_deviation, every track at most one peak.
+    std::fill(m_busy_oscillators.begin(), m_busy_oscillators.end(), false);
+    size_t track = 0;
+    for (size_t ordered_peak = 0; ordered_peak < num_peaks; ++ordered_peak)
+    {
+        const size_t peak = m_peak_order[ordered_peak];
+        const T bin = peak_bin(peak);
+        m_peak_oscillators[peak] = no_oscillator;
+        while (track < num_tracks && track_bin(m_track_order[track]) < bin - max_track_deviation)
+        {
+            ++track;
+        }
+        if (track == num_tracks || track_bin(m_track_order[track]) > bin + max_track_deviation)
+        {
+            continue;
+        }
+        if (track + 1 < num_tracks &&
+            std::abs(track_bin(m_track_order[track + 1]) - bin) < std::abs(track_bin(m_track_order[track]) - bin))
+        {
+            ++track;
+        }
+        m_peak_oscillators[peak] = m_track_order[track];
+        m_busy_oscillators[m_track_order[track++]] = true;
+    }
+
+    // 3. the tracks without a successor fade out, their oscillators are free from the next frame on.
+    size_t num_faded = 0;
+    for (size_t ordered_track = 0; ordered_track < num_tracks; ++ordered_track)
+    {
+        const size_t oscillator = m_track_order[ordered_track];
+        if (!m_busy_oscillators[oscillator])
+        {
+            m_bank.fade_out_partial(oscillator);
+            m_track_bins[oscillator] = no_track;
+            m_busy_oscillators[oscillator] = true;
+            // reused below only if there is no idle oscillator left.
+            m_track_order[num_faded++] = oscillator;
+        }
+    }
+
+    // 4. continued partials glide, new ones start silent on an idle oscillator and fade in.
+    size_t idle_oscillator = 0;
+    for (size_t peak = 0; peak < num_peaks; ++peak)
+    {
+        const T increment = increment_of_bin(peak_bin(peak), frequency_ratio);
+        const T gain = m_amp_correction * peaks.magnitude(peak);
+        size_t oscillator = m_peak_oscillators[peak];
+        if (oscillator != no_oscillator)
+        {
+            // the level has to be band-limited for both ends of the glide.
+            const size_t level = MipMap::level_for_increment(std::max(increment, m_bank.increment(oscillator)));
+            m_bank.set_partial_target(oscillator, increment, increment > 0 ? gain : 0, MipMap::level_offset(level));
+            m_track_bins[oscillator] = increment > 0 ? peak_bin(peak) : no_track;
+            continue;
+        }
+        if (increment == 0)
+        {
+            continue;
+        }
+        while (idle_oscillator < m_partial_count && m_busy_oscillators[idle_oscillator])
+        {
+            ++idle_oscillator;
+        }
+        if (idle_oscillator < m_partial_count)
+        {
+            oscillator = idle_oscillator++;
+            m_bank.set_partial(oscillator, increment, 0);
+        }
+        else if (num_faded > 0)
+        {
+            oscillator = m_track_order[--num_faded];
+        }
+        else
+        {
+            continue;
+        }
+        const size_t level = MipMap::level_for_increment(std::max(increment, m_bank.increment(oscillator)));
+        m_bank.set_partial_target(oscillator, increment, gain, MipMap::level_offset(level));
+        m_track_bins[oscillator] = peak_bin(peak);
+        m_busy_oscillators[oscillator] = true;
+    }
+    // the fading oscillators are still rendered during this ramp, the idle ones above the last busy one are not.
+    size_t num_oscillators = std::max(m_num_tracks, idle_oscillator);
+    while (num_oscillators > 0 && !m_busy_oscillators[num_oscillators - 1])
+    {
+        --num_oscillators;
+    }
+    m_num_tracks = num_oscillators;
+    m_bank.start_ramp(m_retune_ramp, num_oscillators);
 }
 
-template <FloatingPt T, size_t WT_SIZE, size_t FFT_SIZE>
+template <FloatingPt T, size_t WT_SIZE, size_t FFT_SIZE, size_t MAX_PARTIALS>
     requires(is_bounded_pow_two(WT_SIZE))
-void ResynthOscs<T, WT_SIZE, FFT_SIZE>::reset(const double sampling_freq) noexcept
+void ResynthOscs<T, WT_SIZE, FFT_SIZE, MAX_PARTIALS>::reset(const double sampling_freq) noexcept
 {
     m_sampling_freq = sampling_freq;
-    m_freq_resolution = sampling_freq / FFT_SIZE;
-    for (auto& osc : m_osc_array)
+    m_freq_resolution = sampling_freq / static_cast<double>(m_fft_size);
+    m_nyquist_freq = sampling_freq / 2.0;
+    m_inv_sampling_freq = 1.0 / sampling_freq;
+    m_bank.reset();
+    m_track_bins.fill(no_track);
+    m_num_tracks = 0;
+}
+
+template <FloatingPt T, size_t WT_SIZE, size_t FFT_SIZE, size_t MAX_PARTIALS>
+    requires(is_bounded_pow_two(WT_SIZE))
+void ResynthOscs<T, WT_SIZE, FFT_SIZE, MAX_PARTIALS>::set_fft_size(const size_t fft_size) noexcept
+{
+    // the tracks continue at the same frequency, which is another bin of the new size.
+    const T bin_scale = static_cast<T>(std::min(fft_size, FFT_SIZE)) / static_cast<T>(m_fft_size);
+    for (size_t track = 0; track < m_num_tracks; ++track)
     {
-        osc.reset(sampling_freq);
+        if (m_track_bins[track] != no_track)
+        {
+            m_track_bins[track] *= bin_scale;
+        }
     }
+    m_fft_size = std::min(fft_size, FFT_SIZE);
+    m_freq_resolution = m_sampling_freq / static_cast<double>(m_fft_size);
+    m_amp_correction = static_cast<T>(2) / static_cast<T>(m_fft_size);
 }
 
-template <FloatingPt T, size_t WT_SIZE, size_t FFT_SIZE>
+template <FloatingPt T, size_t WT_SIZE, size_t FFT_SIZE, size_t MAX_PARTIALS>
     requires(is_bounded_pow_two(WT_SIZE))
-void ResynthOscs<T, WT_SIZE, FFT_SIZE>::select_waveform(const OscWaveform& osc_waveform) noexcept
+void ResynthOscs<T, WT_SIZE, FFT_SIZE, MAX_PARTIALS>::select_waveform(const OscWaveform& osc_waveform) noexcept
 {
-
-    const WaveTable<T, WT_SIZE>* wt_ptr = nullptr;
     switch (osc_waveform)
     {
     case OscWaveform::SINE:
-        wt_ptr = &m_sin_wt;
+        m_wt_ptr = m_sin_wt;
         break;
     case OscWaveform::TRIANGLE:
-        wt_ptr = &m_tri_wt;
+        m_wt_ptr = m_tri_wt;
         break;
     case OscWaveform::SAW:
-        wt_ptr = &m_saw_wt;
+        m_wt_ptr = m_saw_wt;
         break;
     case OscWaveform::SQUARE:
-        wt_ptr = &m_square_wt;
+        m_wt_ptr = m_square_wt;
         break;
     }
-    for (auto& osc : m_osc_array)
-    {
-        osc.change_waveform(wt_ptr);
-    }
 }
 
 } // namespace LBTS::Spectral
\ No newline at end of file
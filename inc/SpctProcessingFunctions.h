@@ -9,43 +9,56 @@
 #pragma once
 #include "SpctDomainSpecific.h"
 #include "SpctExponentLUT.h"
+#include "SpctSimd.h"
+#include <algorithm>
 #include <array>
+#include <cmath>
 #include <complex>
+#include <cstdint>
+#include <limits>
+#include <utility>
 
 namespace LBTS::Spectral
 {
 
+/// @brief Plain complex multiplication without the NaN / infinity recovery that std::complex<T>::operator* has to
+/// perform (which ends up as a library call in the innermost loop). The FFT only deals with finite values.
+template <FloatingPt T>
+[[nodiscard]] constexpr std::complex<T> multiply_complex(const std::complex<T>& lhs, const std::complex<T>& rhs) noexcept
+{
+    return {lhs.real() * rhs.real() - lhs.imag() * rhs.imag(), lhs.real() * rhs.imag() + lhs.imag() * rhs.real()};
+}
+
+/// @brief Reorder the samples in a bit-reversed manner with the compile-time table.
+template <FloatingPt T, size_t DEG_TWO>
+    requires(is_bounded_degree(DEG_TWO))
+void apply_bit_reversal(ComplexArr<T, pow_two_value_of_degree(DEG_TWO)>& samples_arr) noexcept
+{
+    constexpr auto& bit_reversal_table = BitReversalTable_v<DEG_TWO>;
+    for (size_t array_index = 0; array_index < bit_reversal_table.size(); ++array_index)
+    {
+        if (const size_t reversed = bit_reversal_table[array_index]; array_index < reversed)
+        {
+            std::swap(samples_arr[array_index], samples_arr[reversed]);
+        }
+    }
+}
+
 /// @note DEG_TWO could be made uint8_t, but than pow_two_value_of_degree would have to be explicitely templated to
 /// size_t (pow_two_value_of_degree<size_t>(uint8_t DEG_TWO) and since I'm lazy and on a computer we don't need to
 /// be that greedy it's simply a size_t :)
 template <FloatingPt T, size_t DEG_TWO = BoundedDegTwo<size_t, 10>::degree>
     requires(is_bounded_degree(DEG_TWO))
 void spct_fourier_transform(ComplexArr<T, pow_two_value_of_degree(DEG_TWO)>& samples_arr,
-                            ExponentLUT<T>& exponent_lut) noexcept
+                            const ExponentLUT<T>& exponent_lut) noexcept
 {
     constexpr auto num_samples = pow_two_value_of_degree(DEG_TWO);
     // first swap indices in bit-reversal manner
     // Algorithm:
     // for ( j = 0; j < n; ++j )
-    //   q = j;
-    //   r = 0
-    //   for ( k = 0; k < log2(n); ++k )
-    //      bk = q mod 2; -> doable as & 1
-    //      q = q div 2; -> doable via shift operator >>
-    //      r = 2r + bk; -> doable via shift operator << and logical or
+    //   r = bit reversed j (precalculated at compile time, see BitReversalTable)
     //   if j < r then swap(xj, xr);
-    for (size_t array_index = 0; array_index < num_samples; ++array_index)
-    {
-        size_t comparison = 0;
-        for (size_t degree_index = 0; degree_index < DEG_TWO; ++degree_index)
-        {
-            comparison = (comparison << 1) | ((array_index >> degree_index) & 1);
-        }
-        if (array_index < comparison)
-        {
-            std::swap(samples_arr[array_index], samples_arr[comparison]);
-        }
-    }
+    apply_bit_reversal<T, DEG_TWO>(samples_arr);
 
     // calculate the actual fourier transform
     // Algorithm:
@@ -61,7 +74,7 @@ void spct_fourier_transform(ComplexArr<T, pow_two_value_of_degree(DEG_TWO)>& sam
     size_t current_exp_array_index = 0;
     while (current_pot <= num_samples)
     {
-        exponent_lut.choose_array(current_exp_array_index);
+        const auto twiddles = exponent_lut.stage(current_exp_array_index);
         const size_t outer_limit = num_samples / current_pot;
         for (size_t outer_ndx = 0; outer_ndx < outer_limit; ++outer_ndx)
         {
@@ -69,7 +82,7 @@ void spct_fourier_transform(ComplexArr<T, pow_two_value_of_degree(DEG_TWO)>& sam
             {
                 const auto butterfly_ndx_1 = outer_ndx * current_pot + inner_ndx;
                 const auto butterfly_ndx_2 = butterfly_ndx_1 + (current_pot >> 1);
-                std::complex<T> tau = exponent_lut[inner_ndx] * samples_arr[butterfly_ndx_2];
+                std::complex<T> tau = twiddles[inner_ndx] * samples_arr[butterfly_ndx_2];
                 samples_arr[butterfly_ndx_2] = samples_arr[butterfly_ndx_1] - tau;
                 samples_arr[butterfly_ndx_1] += tau;
             }
@@ -79,29 +92,733 @@ void spct_fourier_transform(ComplexArr<T, pow_two_value_of_degree(DEG_TWO)>& sam
     }
 }
 
-template <FloatingPt T, size_t N_SAMPLES = BoundedPowTwo_v<size_t, 1024>>
-    requires(is_bounded_pow_two(N_SAMPLES))
-[[nodiscard]] size_t calculate_max_map(const ComplexArr<T, N_SAMPLES>& samples_arr,
-                                       BinMagArr<T, (N_SAMPLES >> 1)>& bin_mag_arr, const T threshold)
+/// @brief Radix-4 engine producing the same bins as spct_fourier_transform (within floating point accuracy).
+/// Two radix-2 stages are merged into one pass which needs three instead of four complex multiplications per four
+/// samples and halves the passes over the array. Which stages are needed is decided at compile time by DEG_TWO: odd
+/// degrees start with one twiddle free radix-2 stage, the rest is done in radix-4 stages.
+/// @tparam T: Type of the complex numbers.
+/// @tparam DEG_TWO: Degree of the power of two of the transformation size.
+/// @param samples_arr: Array that will be transformed in place.
+/// @param radix_four_lut: Precalculated twiddles of the matching size.
+template <FloatingPt T, size_t DEG_TWO = BoundedDegTwo<size_t, 10>::degree>
+    requires(is_bounded_degree(DEG_TWO))
+void spct_fourier_transform_radix_four(ComplexArr<T, pow_two_value_of_degree(DEG_TWO)>& samples_arr,
+                                       const RadixFourLUT<T, DEG_TWO>& radix_four_lut) noexcept
+{
+    constexpr auto num_samples = pow_two_value_of_degree(DEG_TWO);
+    apply_bit_reversal<T, DEG_TWO>(samples_arr);
+
+    if constexpr (DEG_TWO & 1)
+    {
+        // W_2^0 = 1, no multiplication needed.
+        for (size_t butterfly_ndx = 0; butterfly_ndx < num_samples; butterfly_ndx += 2)
+        {
+            const std::complex<T> upper = samples_arr[butterfly_ndx];
+            const std::complex<T> lower = samples_arr[butterfly_ndx + 1];
+            samples_arr[butterfly_ndx] = upper + lower;
+            samples_arr[butterfly_ndx + 1] = upper - lower;
+        }
+    }
+
+    // Algorithm (q = quarter of the current block, W = W_4q):
+    // for each block b of size 4q
+    //   for ( i = 0; i < q; ++i )
+    //     a = x[b+i], c = W^2i * x[b+i+q], b = W^i * x[b+i+2q], d = W^3i * x[b+i+3q]
+    //     (the positions of b and c are swapped due to the bit-reversal in base 2)
+    //     x[b+i]    = (a + c) + (b + d)
+    //     x[b+i+q]  = (a - c) - i(b - d)
+    //     x[b+i+2q] = (a + c) - (b + d)
+    //     x[b+i+3q] = (a - c) + i(b - d)
+    size_t twiddle_offset = 0;
+    for (size_t quarter = RadixFourLUT<T, DEG_TWO>::first_quarter; quarter * 4 <= num_samples; quarter <<= 2)
+    {
+        const size_t block_size = quarter << 2;
+        for (size_t block_start = 0; block_start < num_samples; block_start += block_size)
+        {
+            for (size_t inner_ndx = 0; inner_ndx < quarter; ++inner_ndx)
+            {
+                const size_t ndx_0 = block_start + inner_ndx;
+                const size_t ndx_1 = ndx_0 + quarter;
+                const size_t ndx_2 = ndx_1 + quarter;
+                const size_t ndx_3 = ndx_2 + quarter;
+                const size_t twiddle_ndx = twiddle_offset + 3 * inner_ndx;
+                const std::complex<T> val_a = samples_arr[ndx_0];
+                const std::complex<T> val_c = multiply_complex(radix_four_lut[twiddle_ndx + 1], samples_arr[ndx_1]);
+                const std::complex<T> val_b = multiply_complex(radix_four_lut[twiddle_ndx], samples_arr[ndx_2]);
+                const std::complex<T> val_d = multiply_complex(radix_four_lut[twiddle_ndx + 2], samples_arr[ndx_3]);
+                const std::complex<T> sum_ac = val_a + val_c;
+                const std::complex<T> diff_ac = val_a - val_c;
+                const std::complex<T> sum_bd = val_b + val_d;
+                // -i * (b - d)
+                const std::complex<T> rot_diff_bd{val_b.imag() - val_d.imag(), val_d.real() - val_b.real()};
+                samples_arr[ndx_0] = sum_ac + sum_bd;
+                samples_arr[ndx_1] = diff_ac + rot_diff_bd;
+                samples_arr[ndx_2] = sum_ac - sum_bd;
+                samples_arr[ndx_3] = diff_ac - rot_diff_bd;
+            }
+        }
+        twiddle_offset += 3 * quarter;
+    }
+}
+
+/// @brief Radix-4 butterflies of one block on the split layout (see spct_fourier_transform_radix_four for the
+/// algorithm). VEC is either the SIMD register of the platform or the scalar fallback, the inner indices are
+/// processed in steps of the register width.
+template <typename VEC, FloatingPt T>
+void split_radix_four_butterflies(T* real, T* imag, const T* twiddles, const size_t quarter) noexcept
+{
+    for (size_t inner_ndx = 0; inner_ndx < quarter; inner_ndx += VEC::width)
+    {
+        const size_t ndx_1 = inner_ndx + quarter;
+        const size_t ndx_2 = ndx_1 + quarter;
+        const size_t ndx_3 = ndx_2 + quarter;
+        const auto w1_re = VEC::load(twiddles + inner_ndx);
+        const auto w1_im = VEC::load(twiddles + quarter + inner_ndx);
+        const auto w2_re = VEC::load(twiddles + 2 * quarter + inner_ndx);
+        const auto w2_im = VEC::load(twiddles + 3 * quarter + inner_ndx);
+        const auto w3_re = VEC::load(twiddles + 4 * quarter + inner_ndx);
+        const auto w3_im = VEC::load(twiddles + 5 * quarter + inner_ndx);
+
+        const auto a_re = VEC::load(real + inner_ndx);
+        const auto a_im = VEC::load(imag + inner_ndx);
+        const auto x1_re = VEC::load(real + ndx_1);
+        const auto x1_im = VEC::load(imag + ndx_1);
+        const auto x2_re = VEC::load(real + ndx_2);
+        const auto x2_im = VEC::load(imag + ndx_2);
+        const auto x3_re = VEC::load(real + ndx_3);
+        const auto x3_im = VEC::load(imag + ndx_3);
+        // c = W^2i * x1, b = W^i * x2, d = W^3i * x3
+        const auto c_re = VEC::sub(VEC::mul(x1_re, w2_re), VEC::mul(x1_im, w2_im));
+        const auto c_im = VEC::add(VEC::mul(x1_re, w2_im), VEC::mul(x1_im, w2_re));
+        const auto b_re = VEC::sub(VEC::mul(x2_re, w1_re), VEC::mul(x2_im, w1_im));
+        const auto b_im = VEC::add(VEC::mul(x2_re, w1_im), VEC::mul(x2_im, w1_re));
+        const auto d_re = VEC::sub(VEC::mul(x3_re, w3_re), VEC::mul(x3_im, w3_im));
+        const auto d_im = VEC::add(VEC::mul(x3_re, w3_im), VEC::mul(x3_im, w3_re));
+
+        const auto sum_ac_re = VEC::add(a_re, c_re);
+        const auto sum_ac_im = VEC::add(a_im, c_im);
+        const auto diff_ac_re = VEC::sub(a_re, c_re);
+        const auto diff_ac_im = VEC::sub(a_im, c_im);
+        const auto sum_bd_re = VEC::add(b_re, d_re);
+        const auto sum_bd_im = VEC::add(b_im, d_im);
+        const auto diff_bd_re = VEC::sub(b_re, d_re);
+        const auto diff_bd_im = VEC::sub(b_im, d_im);
+        // x1 = (a - c) - i(b - d), x3 = (a - c) + i(b - d)
+        VEC::store(real + inner_ndx, VEC::add(sum_ac_re, sum_bd_re));
+        VEC::store(imag + inner_ndx, VEC::add(sum_ac_im, sum_bd_im));
+        VEC::store(real + ndx_1, VEC::add(diff_ac_re, diff_bd_im));
+        VEC::store(imag + ndx_1, VEC::sub(diff_ac_im, diff_bd_re));
+        VEC::store(real + ndx_2, VEC::sub(sum_ac_re, sum_bd_re));
+        VEC::store(imag + ndx_2, VEC::sub(sum_ac_im, sum_bd_im));
+        VEC::store(real + ndx_3, VEC::sub(diff_ac_re, diff_bd_im));
+        VEC::store(imag + ndx_3, VEC::add(diff_ac_im, diff_bd_re));
+    }
+}
+
+/**
+ * Passes of the SIMD engine. They are separate functions so a transformation can also be done pass by pass (see
+ * FrameKernel::analysis_step), spct_fourier_transform_simd simply runs all of them at once.
+ */
+
+/// @brief Number of butterfly passes of the SIMD engine (one radix-2 pass for odd degrees + the radix-4 passes).
+template <size_t DEG_TWO>
+inline constexpr size_t num_butterfly_passes_v = (DEG_TWO & 1) + (DEG_TWO >> 1);
+
+/// @brief First pass: gather the samples in bit-reversed order into the split working array.
+template <FloatingPt T, size_t DEG_TWO>
+    requires(is_bounded_degree(DEG_TWO))
+void gather_bit_reversed(const ComplexArr<T, pow_two_value_of_degree(DEG_TWO)>& samples_arr,
+                         SplitComplexArr<T, pow_two_value_of_degree(DEG_TWO)>& split_arr) noexcept
+{
+    constexpr auto& bit_reversal_table = BitReversalTable_v<DEG_TWO>;
+    for (size_t array_index = 0; array_index < pow_two_value_of_degree(DEG_TWO); ++array_index)
+    {
+        const std::complex<T>& value = samples_arr[bit_reversal_table[array_index]];
+        split_arr.m_real[array_index] = value.real();
+        split_arr.m_imag[array_index] = value.imag();
+    }
+}
+
+/// @brief One butterfly pass on the split working array.
+/// @param pass: 0 .. num_butterfly_passes_v - 1, the passes have to be done in ascending order.
+template <FloatingPt T, size_t DEG_TWO>
+    requires(is_bounded_degree(DEG_TWO))
+void split_butterfly_pass(SplitComplexArr<T, pow_two_value_of_degree(DEG_TWO)>& split_arr,
+                          const SoaRadixFourLUT<T, DEG_TWO>& soa_lut, const size_t pass) noexcept
+{
+    using Vec = SimdVec<T>;
+    constexpr auto num_samples = pow_two_value_of_degree(DEG_TWO);
+    T* real = split_arr.m_real.data();
+    T* imag = split_arr.m_imag.data();
+    if constexpr (DEG_TWO & 1)
+    {
+        if (pass == 0)
+        {
+            for (size_t butterfly_ndx = 0; butterfly_ndx < num_samples; butterfly_ndx += 2)
+            {
+                const T upper_re = real[butterfly_ndx];
+                const T upper_im = imag[butterfly_ndx];
+                real[butterfly_ndx] = upper_re + real[butterfly_ndx + 1];
+                imag[butterfly_ndx] = upper_im + imag[butterfly_ndx + 1];
+                real[butterfly_ndx + 1] = upper_re - real[butterfly_ndx + 1];
+                imag[butterfly_ndx + 1] = upper_im - imag[butterfly_ndx + 1];
+            }
+            return;
+        }
+    }
+
+    // the quarters grow by four per radix-4 pass, the twiddles of the previous passes are 6 * (sum of their quarters).
+    const size_t radix_four_pass = pass - (DEG_TWO & 1);
+    constexpr size_t first_quarter = RadixFourLUT<T, DEG_TWO>::first_quarter;
+    const size_t quarter = first_quarter << (2 * radix_four_pass);
+    const size_t twiddle_offset = 2 * first_quarter * ((size_t{1} << (2 * radix_four_pass)) - 1);
+    const T* twiddles = soa_lut.data(twiddle_offset);
+    const size_t block_size = quarter << 2;
+    for (size_t block_start = 0; block_start < num_samples; block_start += block_size)
+    {
+        if (quarter >= Vec::width)
+        {
+            split_radix_four_butterflies<Vec>(real + block_start, imag + block_start, twiddles, quarter);
+        }
+        else
+        {
+            split_radix_four_butterflies<ScalarVec<T>>(real + block_start, imag + block_start, twiddles, quarter);
+        }
+    }
+}
+
+/// @brief Last pass: write the split result back to the interleaved array.
+template <FloatingPt T, size_t DEG_TWO>
+    requires(is_bounded_degree(DEG_TWO))
+void scatter_split(const SplitComplexArr<T, pow_two_value_of_degree(DEG_TWO)>& split_arr,
+                   ComplexArr<T, pow_two_value_of_degree(DEG_TWO)>& samples_arr) noexcept
+{
+    for (size_t array_index = 0; array_index < pow_two_value_of_degree(DEG_TWO); ++array_index)
+    {
+        samples_arr[array_index] = {split_arr.m_real[array_index], split_arr.m_imag[array_index]};
+    }
+}
+
+/// @brief SIMD version of spct_fourier_transform_radix_four working on a split (structure of arrays) layout.
+/// The samples get gathered in bit-reversed order into the split working array, transformed there and written back.
+/// Stages whose quarter length is smaller than one register are done with the scalar version of the same kernel.
+/// Without SIMD support on the platform (or with SPCT_DISABLE_SIMD) the whole transformation runs scalar, the
+/// radix-4 engine stays the reference for the result.
+/// @tparam T: Type of the complex numbers.
+/// @tparam DEG_TWO: Degree of the power of two of the transformation size.
+/// @param samples_arr: Array that will be transformed in place.
+/// @param split_arr: Working array, contains the result in the split layout afterwards.
+/// @param soa_lut: Precalculated twiddles of the matching size in the split layout.
+template <FloatingPt T, size_t DEG_TWO = BoundedDegTwo<size_t, 10>::degree>
+    requires(is_bounded_degree(DEG_TWO))
+void spct_fourier_transform_simd(ComplexArr<T, pow_two_value_of_degree(DEG_TWO)>& samples_arr,
+                                 SplitComplexArr<T, pow_two_value_of_degree(DEG_TWO)>& split_arr,
+                                 const SoaRadixFourLUT<T, DEG_TWO>& soa_lut) noexcept
+{
+    gather_bit_reversed<T, DEG_TWO>(samples_arr, split_arr);
+    for (size_t pass = 0; pass < num_butterfly_passes_v<DEG_TWO>; ++pass)
+    {
+        split_butterfly_pass<T, DEG_TWO>(split_arr, soa_lut, pass);
+    }
+    scatter_split<T, DEG_TWO>(split_arr, samples_arr);
+}
+
+/// @brief Radix-4 engine that transforms one independent signal per SIMD lane (e.g. the channels of a stereo or
+/// surround track) at once. Element i of lane c lives at [i * VEC::width + c] of the split arrays, all lanes share
+/// the same (broadcasted) twiddles. Same passes as spct_fourier_transform_radix_four.
+/// @tparam T: Type of the complex numbers.
+/// @tparam DEG_TWO: Degree of the power of two of the transformation size.
+/// @tparam VEC: SIMD register, one signal per lane.
+/// @param real: Real parts, already in bit-reversed order (N * VEC::width values), transformed in place.
+/// @param imag: Imaginary parts, same layout.
+/// @param radix_four_lut: Precalculated twiddles of the matching size.
+template <FloatingPt T, size_t DEG_TWO, typename VEC = SimdVec<T>>
+    requires(is_bounded_degree(DEG_TWO))
+void spct_fourier_transform_batched(T* real, T* imag, const RadixFourLUT<T, DEG_TWO>& radix_four_lut) noexcept
+{
+    constexpr auto num_samples = pow_two_value_of_degree(DEG_TWO);
+    constexpr size_t lanes = VEC::width;
+    if constexpr (DEG_TWO & 1)
+    {
+        for (size_t butterfly_ndx = 0; butterfly_ndx < num_samples * lanes; butterfly_ndx += 2 * lanes)
+        {
+            const auto upper_re = VEC::load(real + butterfly_ndx);
+            const auto upper_im = VEC::load(imag + butterfly_ndx);
+            const auto lower_re = VEC::load(real + butterfly_ndx + lanes);
+            const auto lower_im = VEC::load(imag + butterfly_ndx + lanes);
+            VEC::store(real + butterfly_ndx, VEC::add(upper_re, lower_re));
+            VEC::store(imag + butterfly_ndx, VEC::add(upper_im, lower_im));
+            VEC::store(real + butterfly_ndx + lanes, VEC::sub(upper_re, lower_re));
+            VEC::store(imag + butterfly_ndx + lanes, VEC::sub(upper_im, lower_im));
+        }
+    }
+
+    size_t twiddle_offset = 0;
+    for (size_t quarter = RadixFourLUT<T, DEG_TWO>::first_quarter; quarter * 4 <= num_samples; quarter <<= 2)
+    {
+        const size_t block_size = quarter << 2;
+        for (size_t block_start = 0; block_start < num_samples; block_start += block_size)
+        {
+            for (size_t inner_ndx = 0; inner_ndx < quarter; ++inner_ndx)
+            {
+                const size_t ndx_0 = (block_start + inner_ndx) * lanes;
+                const size_t ndx_1 = ndx_0 + quarter * lanes;
+                const size_t ndx_2 = ndx_1 + quarter * lanes;
+                const size_t ndx_3 = ndx_2 + quarter * lanes;
+                const size_t twiddle_ndx = twiddle_offset + 3 * inner_ndx;
+                const auto w1_re = VEC::broadcast(radix_four_lut[twiddle_ndx].real());
+                const auto w1_im = VEC::broadcast(radix_four_lut[twiddle_ndx].imag());
+                const auto w2_re = VEC::broadcast(radix_four_lut[twiddle_ndx + 1].real());
+                const auto w2_im = VEC::broadcast(radix_four_lut[twiddle_ndx + 1].imag());
+                const auto w3_re = VEC::broadcast(radix_four_lut[twiddle_ndx + 2].real());
+                const auto w3_im = VEC::broadcast(radix_four_lut[twiddle_ndx + 2].imag());
+
+                const auto a_re = VEC::load(real + ndx_0);
+                const auto a_im = VEC::load(imag + ndx_0);
+                const auto x1_re = VEC::load(real + ndx_1);
+                const auto x1_im = VEC::load(imag + ndx_1);
+                const auto x2_re = VEC::load(real + ndx_2);
+                const auto x2_im = VEC::load(imag + ndx_2);
+                const auto x3_re = VEC::load(real + ndx_3);
+                const auto x3_im = VEC::load(imag + ndx_3);
+                // c = W^2i * x1, b = W^i * x2, d = W^3i * x3
+                const auto c_re = VEC::sub(VEC::mul(w2_re, x1_re), VEC::mul(w2_im, x1_im));
+                const auto c_im = VEC::add(VEC::mul(w2_re, x1_im), VEC::mul(w2_im, x1_re));
+                const auto b_re = VEC::sub(VEC::mul(w1_re, x2_re), VEC::mul(w1_im, x2_im));
+                const auto b_im = VEC::add(VEC::mul(w1_re, x2_im), VEC::mul(w1_im, x2_re));
+                const auto d_re = VEC::sub(VEC::mul(w3_re, x3_re), VEC::mul(w3_im, x3_im));
+                const auto d_im = VEC::add(VEC::mul(w3_re, x3_im), VEC::mul(w3_im, x3_re));
+
+                const auto sum_ac_re = VEC::add(a_re, c_re);
+                const auto sum_ac_im = VEC::add(a_im, c_im);
+                const auto diff_ac_re = VEC::sub(a_re, c_re);
+                const auto diff_ac_im = VEC::sub(a_im, c_im);
+                const auto sum_bd_re = VEC::add(b_re, d_re);
+                const auto sum_bd_im = VEC::add(b_im, d_im);
+                const auto diff_bd_re = VEC::sub(b_re, d_re);
+                const auto diff_bd_im = VEC::sub(b_im, d_im);
+                VEC::store(real + ndx_0, VEC::add(sum_ac_re, sum_bd_re));
+                VEC::store(imag + ndx_0, VEC::add(sum_ac_im, sum_bd_im));
+                VEC::store(real + ndx_1, VEC::add(diff_ac_re, diff_bd_im));
+                VEC::store(imag + ndx_1, VEC::sub(diff_ac_im, diff_bd_re));
+                VEC::store(real + ndx_2, VEC::sub(sum_ac_re, sum_bd_re));
+                VEC::store(imag + ndx_2, VEC::sub(sum_ac_im, sum_bd_im));
+                VEC::store(real + ndx_3, VEC::sub(diff_ac_re, diff_bd_im));
+                VEC::store(imag + ndx_3, VEC::add(diff_ac_im, diff_bd_re));
+            }
+        }
+        twiddle_offset += 3 * quarter;
+    }
+}
+
+/// @brief Pack N real samples into N/2 complex numbers (even samples as real, odd samples as imaginary part), which
+/// is the input format of spct_real_fourier_transform.
+template <FloatingPt T, size_t DEG_TWO>
+    requires(is_bounded_degree(DEG_TWO) && DEG_TWO >= 1)
+void pack_real_samples(const std::array<T, pow_two_value_of_degree(DEG_TWO)>& real_samples,
+                       ComplexArr<T, (pow_two_value_of_degree(DEG_TWO) >> 1)>& packed_samples) noexcept
+{
+    for (size_t packed_ndx = 0; packed_ndx < packed_samples.size(); ++packed_ndx)
+    {
+        packed_samples[packed_ndx] = {real_samples[packed_ndx << 1], real_samples[(packed_ndx << 1) + 1]};
+    }
+}
+
+/// @brief Second half of the real input FFT, splits the transformed packed samples into the bins of the real signal
+/// (see spct_real_fourier_transform).
+template <FloatingPt T, size_t DEG_TWO>
+    requires(is_bounded_degree(DEG_TWO) && DEG_TWO >= 1)
+void split_real_spectrum(ComplexArr<T, (pow_two_value_of_degree(DEG_TWO) >> 1)>& packed_samples,
+                         const RealFourierLUT<T, DEG_TWO>& real_fourier_lut) noexcept
+{
+    constexpr auto half_samples = pow_two_value_of_degree(DEG_TWO) >> 1;
+    // DC: 0.5 * ((Z0 + Z0*) - i(Z0 - Z0*)) = Re(Z0) + Im(Z0)
+    packed_samples[0] = {packed_samples[0].real() + packed_samples[0].imag(), 0};
+    constexpr T half = static_cast<T>(0.5);
+    for (size_t lower_ndx = 1; lower_ndx < (half_samples >> 1); ++lower_ndx)
+    {
+        const size_t upper_ndx = half_samples - lower_ndx;
+        const std::complex<T> lower = packed_samples[lower_ndx];
+        const std::complex<T> upper = packed_samples[upper_ndx];
+        const std::complex<T> even{half * (lower.real() + upper.real()), half * (lower.imag() - upper.imag())};
+        const std::complex<T> odd{half * (lower.imag() + upper.imag()), half * (upper.real() - lower.real())};
+        const std::complex<T> rotated_odd = multiply_complex(real_fourier_lut.split_twiddle(lower_ndx), odd);
+        packed_samples[lower_ndx] = even + rotated_odd;
+        packed_samples[upper_ndx] = std::conj(even - rotated_odd);
+    }
+    if constexpr (half_samples >= 2)
+    {
+        // the center bin is its own partner which simplifies to the conjugate.
+        packed_samples[half_samples >> 1] = std::conj(packed_samples[half_samples >> 1]);
+    }
+}
+
+/// @brief Like pack_real_frame but only the packed samples first_packed .. end_packed-1 (frame samples 2*first_packed
+/// .. 2*end_packed-1), so the packing of a frame can be spread over several calls. Reads the ring buffer as a pointer,
+/// the caller keeps the frame from being overwritten until it is packed.
+/// @param ring_samples: First sample of the ring buffer, the valid range of the ring buffer has to be N.
+/// @return The energy (sum of the squares) of the packed part, summed up it is the energy of is_silent_energy.
+template <FloatingPt T, size_t DEG_TWO>
+    requires(is_bounded_degree(DEG_TWO) && DEG_TWO >= 1)
+T pack_real_frame_part(const T* ring_samples, const size_t oldest_index,
+                       const std::array<T, pow_two_value_of_degree(DEG_TWO)>& window,
+                       ComplexArr<T, (pow_two_value_of_degree(DEG_TWO) >> 1)>& packed_samples,
+                       const size_t first_packed, const size_t end_packed) noexcept
+{
+    constexpr size_t index_mask = pow_two_value_of_degree(DEG_TWO) - 1;
+    T energy = 0;
+    for (size_t packed_ndx = first_packed; packed_ndx < end_packed; ++packed_ndx)
+    {
+        const size_t frame_ndx = packed_ndx << 1;
+        const size_t ring_ndx = (oldest_index + frame_ndx) & index_mask;
+        packed_samples[packed_ndx] = {ring_samples[ring_ndx] * window[frame_ndx],
+                                      ring_samples[(ring_ndx + 1) & index_mask] * window[frame_ndx + 1]};
+        energy += std::norm(packed_samples[packed_ndx]);
+    }
+    return energy;
+}
+
+/// @brief Like pack_real_samples but the frame is read from a ring buffer, beginning with the oldest sample, and the
+/// window is applied during the copy.
+/// @param ring_samples: The ring buffer, only the first N samples are used (the valid range of the ring buffer).
+/// @param oldest_index: Index of the oldest sample in the ring buffer (= first sample of the frame).
+/// @param window: Window table of the frame length.
+/// @param packed_samples: The packed and windowed frame.
+/// @return The energy of the windowed frame (see is_silent_energy).
+template <FloatingPt T, size_t DEG_TWO, size_t RING_SIZE>
+    requires(is_bounded_degree(DEG_TWO) && DEG_TWO >= 1 && RING_SIZE >= pow_two_value_of_degree(DEG_TWO))
+T pack_real_frame(const std::array<T, RING_SIZE>& ring_samples, const size_t oldest_index,
+                     const std::array<T, pow_two_value_of_degree(DEG_TWO)>& window,
+                     ComplexArr<T, (pow_two_value_of_degree(DEG_TWO) >> 1)>& packed_samples) noexcept
+{
+    return pack_real_frame_part<T, DEG_TWO>(
+        ring_samples.data(), oldest_index, window, packed_samples, 0, packed_samples.size());
+}
+
+/// @brief Whether no bin of a frame of N_SAMPLES samples with that energy (sum x[n]^2, after the window) can reach the
+/// threshold of calculate_peak_map: |X[k]|^2 <= (sum |x[n]|)^2 <= N * sum x[n]^2 (Cauchy-Schwarz).
+template <FloatingPt T, size_t N_SAMPLES>
+[[nodiscard]] bool is_silent_energy(const T energy, const T threshold) noexcept
+{
+    const T clipped_threshold = threshold >= 1 ? threshold : 1;
+    return static_cast<T>(N_SAMPLES) * energy < clipped_threshold * clipped_threshold;
+}
+
+/// @brief Whether no bin of a packed (and windowed) frame can reach the threshold of calculate_peak_map, decided
+/// without the transformation (see is_silent_energy).
+/// The bound is taken after the window on purpose, the windows are normalised to a coherent gain of 1 and exceed 1.
+/// @param packed_samples: The frame packed by pack_real_frame (or pack_real_samples), N/2 complex numbers.
+/// @return true if the transformation and the peak picking can be skipped, the frame has no peaks anyway.
+template <FloatingPt T, size_t N_PACKED>
+[[nodiscard]] bool is_silent_frame(const std::array<std::complex<T>, N_PACKED>& packed_samples,
+                                   const T threshold) noexcept
+{
+    T energy = 0;
+    for (const auto& packed_sample : packed_samples)
+    {
+        energy += std::norm(packed_sample);
+    }
+    return is_silent_energy<T, (N_PACKED << 1)>(energy, threshold);
+}
+
+/// @brief FFT of N real samples that were packed into N/2 complex numbers (see pack_real_samples).
+/// The packed array is transformed in place by the N/2 point radix-4 engine and split afterwards:
+/// X[k] = E[k] + W_N^k * O[k] with E[k] = (Z[k] + Z*[N/2-k]) / 2 and O[k] = (Z[k] - Z*[N/2-k]) / 2i
+/// X[N/2-k] = (E[k] - W_N^k * O[k])*
+/// Afterwards the array contains the bins 0 .. N/2-1 of the N point transformation, which is everything the
+/// upper half of a real spectrum contains (mirrored). Only the nyquist bin (N/2) is dropped.
+/// @tparam T: Type of the complex numbers.
+/// @tparam DEG_TWO: Degree of the power of two of the number of REAL samples.
+/// @param packed_samples: The packed samples, will contain the spectrum afterwards.
+/// @param real_fourier_lut: Precalculated twiddles of the matching size.
+template <FloatingPt T, size_t DEG_TWO = BoundedDegTwo<size_t, 10>::degree>
+    requires(is_bounded_degree(DEG_TWO) && DEG_TWO >= 1)
+void spct_real_fourier_transform(ComplexArr<T, (pow_two_value_of_degree(DEG_TWO) >> 1)>& packed_samples,
+                                 const RealFourierLUT<T, DEG_TWO>& real_fourier_lut) noexcept
+{
+    spct_fourier_transform_radix_four<T, DEG_TWO - 1>(packed_samples, real_fourier_lut.m_half_lut);
+    split_real_spectrum<T, DEG_TWO>(packed_samples, real_fourier_lut);
+}
+
+/// @brief Same as spct_real_fourier_transform but the inner N/2 point transformation runs on the SIMD engine.
+/// @param split_arr: Working array of the SIMD engine.
+template <FloatingPt T, size_t DEG_TWO = BoundedDegTwo<size_t, 10>::degree>
+    requires(is_bounded_degree(DEG_TWO) && DEG_TWO >= 1)
+void spct_real_fourier_transform(ComplexArr<T, (pow_two_value_of_degree(DEG_TWO) >> 1)>& packed_samples,
+                                 SplitComplexArr<T, (pow_two_value_of_degree(DEG_TWO) >> 1)>& split_arr,
+                                 const RealFourierLUT<T, DEG_TWO>& real_fourier_lut) noexcept
+{
+    spct_fourier_transform_simd<T, DEG_TWO - 1>(packed_samples, split_arr, real_fourier_lut.m_half_soa_lut);
+    split_real_spectrum<T, DEG_TWO>(packed_samples, real_fourier_lut);
+}
+
+/// @brief Conveniance overload which packs the real samples first and writes the spectrum into the given array.
+template <FloatingPt T, size_t DEG_TWO = BoundedDegTwo<size_t, 10>::degree>
+    requires(is_bounded_degree(DEG_TWO) && DEG_TWO >= 1)
+void spct_real_fourier_transform(const std::array<T, pow_two_value_of_degree(DEG_TWO)>& real_samples,
+                                 ComplexArr<T, (pow_two_value_of_degree(DEG_TWO) >> 1)>& spectrum,
+                                 const RealFourierLUT<T, DEG_TWO>& real_fourier_lut) noexcept
+{
+    pack_real_samples<T, DEG_TWO>(real_samples, spectrum);
+    spct_real_fourier_transform<T, DEG_TWO>(spectrum, real_fourier_lut);
+}
+
+/// @brief Inverse of split_real_spectrum: merges the bins 0 .. N/2-1 of a real signal into the spectrum of the packed
+/// samples (the nyquist bin is taken as zero).
+/// Z[k] = E[k] + i * O[k] with E[k] = (X[k] + X*[N/2-k]) / 2 and O[k] = (X[k] - X*[N/2-k]) * W_N^-k / 2
+template <FloatingPt T, size_t DEG_TWO>
+    requires(is_bounded_degree(DEG_TWO) && DEG_TWO >= 1)
+void merge_real_spectrum(ComplexArr<T, (pow_two_value_of_degree(DEG_TWO) >> 1)>& spectrum,
+                         const RealFourierLUT<T, DEG_TWO>& real_fourier_lut) noexcept
+{
+    constexpr auto half_samples = pow_two_value_of_degree(DEG_TWO) >> 1;
+    constexpr T half = static_cast<T>(0.5);
+    // DC: E[0] = O[0] = X[0] / 2 since the nyquist bin is zero.
+    spectrum[0] = {half * spectrum[0].real(), half * spectrum[0].real()};
+    for (size_t lower_ndx = 1; lower_ndx < (half_samples >> 1); ++lower_ndx)
+    {
+        const size_t upper_ndx = half_samples - lower_ndx;
+        const std::complex<T> lower = spectrum[lower_ndx];
+        const std::complex<T> upper_conj = std::conj(spectrum[upper_ndx]);
+        const std::complex<T> even = half * (lower + upper_conj);
+        const std::complex<T> odd =
+            multiply_complex(std::conj(real_fourier_lut.split_twiddle(lower_ndx)), half * (lower - upper_conj));
+        // E and O are spectra of real sequences, the upper half is their conjugate.
+        spectrum[lower_ndx] = {even.real() - odd.imag(), even.imag() + odd.real()};
+        spectrum[upper_ndx] = {even.real() + odd.imag(), odd.real() - even.imag()};
+    }
+    if constexpr (half_samples >= 2)
+    {
+        spectrum[half_samples >> 1] = std::conj(spectrum[half_samples >> 1]);
+    }
+}
+
+/// @brief Inverse of spct_real_fourier_transform: turns the bins 0 .. N/2-1 of a real signal (the nyquist bin is taken
+/// as zero) back into the N/2 packed samples (even samples as real, odd samples as imaginary part).
+/// The inner N/2 point inverse runs on the forward SIMD engine: ifft(Z) = fft(Z*)* / (N/2).
+/// @param spectrum: The bins, will contain the packed samples afterwards.
+/// @param split_arr: Working array of the SIMD engine.
+/// @param real_fourier_lut: Precalculated twiddles of the matching size.
+template <FloatingPt T, size_t DEG_TWO = BoundedDegTwo<size_t, 10>::degree>
+    requires(is_bounded_degree(DEG_TWO) && DEG_TWO >= 1)
+void spct_inverse_real_fourier_transform(ComplexArr<T, (pow_two_value_of_degree(DEG_TWO) >> 1)>& spectrum,
+                                         SplitComplexArr<T, (pow_two_value_of_degree(DEG_TWO) >> 1)>& split_arr,
+                                         const RealFourierLUT<T, DEG_TWO>& real_fourier_lut) noexcept
+{
+    merge_real_spectrum<T, DEG_TWO>(spectrum, real_fourier_lut);
+    for (auto& value : spectrum)
+    {
+        value = std::conj(value);
+    }
+    spct_fourier_transform_simd<T, DEG_TWO - 1>(spectrum, split_arr, real_fourier_lut.m_half_soa_lut);
+    const T scale = static_cast<T>(2) / static_cast<T>(pow_two_value_of_degree(DEG_TWO));
+    for (auto& value : spectrum)
+    {
+        value = {scale * value.real(), -scale * value.imag()};
+    }
+}
+
+/// @brief Collects the K loudest candidates of a spectrum straight in a PeakArr, no array of all candidates is needed.
+/// The first K candidates are appended, from then on the entries form a min-heap of the magnitudes and a candidate
+/// only gets in if it is louder than the quietest one (a single comparison for most bins).
+template <FloatingPt T, size_t CAPACITY>
+class LoudestPeaks
+{
+  public:
+    LoudestPeaks(PeakArr<T, CAPACITY>& peaks, const size_t max_entries) noexcept
+        : m_peaks{peaks},
+          m_max_entries{std::min(max_entries, CAPACITY)}
+    {
+    }
+
+    void offer(const uint32_t fixed_bin, const T magnitude) noexcept
+    {
+        if (m_num_entries < m_max_entries)
+        {
+            m_peaks.m_bins[m_num_entries] = fixed_bin;
+            m_peaks.m_magnitudes[m_num_entries] = magnitude;
+            if (++m_num_entries == m_max_entries)
+            {
+                make_heap();
+            }
+        }
+        else if (m_max_entries > 0 && magnitude > m_peaks.m_magnitudes[0])
+        {
+            m_peaks.m_bins[0] = fixed_bin;
+            m_peaks.m_magnitudes[0] = magnitude;
+            sift_down(0, m_max_entries);
+        }
+    }
+
+    /// @brief Sort the collected entries in descending order.
+    /// @return The number of valid entries, never more than max_entries.
+    size_t finish() noexcept
+    {
+        // a single entry is sorted already (and the heap code would index past it).
+        if constexpr (CAPACITY < 2)
+        {
+            return m_num_entries;
+        }
+        if (m_num_entries < m_max_entries)
+        {
+            make_heap();
+        }
+        // heap sort, the quietest entry moves to the back first.
+        for (size_t heap_size = m_num_entries; heap_size > 1; --heap_size)
+        {
+            std::swap(m_peaks.m_bins[0], m_peaks.m_bins[heap_size - 1]);
+            std::swap(m_peaks.m_magnitudes[0], m_peaks.m_magnitudes[heap_size - 1]);
+            sift_down(0, heap_size - 1);
+        }
+        return m_num_entries;
+    }
+
+  private:
+    void make_heap() noexcept
+    {
+        for (size_t entry = m_num_entries >> 1; entry-- > 0;)
+        {
+            sift_down(entry, m_num_entries);
+        }
+    }
+
+    void sift_down(size_t entry, const size_t heap_size) noexcept
+    {
+        if constexpr (CAPACITY < 2)
+        {
+            return;
+        }
+        const uint32_t fixed_bin = m_peaks.m_bins[entry];
+        const T magnitude = m_peaks.m_magnitudes[entry];
+        for (size_t child = 2 * entry + 1; child < heap_size; child = 2 * entry + 1)
+        {
+            if (child + 1 < heap_size && m_peaks.m_magnitudes[child + 1] < m_peaks.m_magnitudes[child])
+            {
+                ++child;
+            }
+            if (!(m_peaks.m_magnitudes[child] < magnitude))
+            {
+                break;
+            }
+            m_peaks.m_bins[entry] = m_peaks.m_bins[child];
+            m_peaks.m_magnitudes[entry] = m_peaks.m_magnitudes[child];
+            entry = child;
+        }
+        m_peaks.m_bins[entry] = fixed_bin;
+        m_peaks.m_magnitudes[entry] = magnitude;
+    }
+
+    PeakArr<T, CAPACITY>& m_peaks;
+    const size_t m_max_entries;
+    size_t m_num_entries = 0;
+};
+
+/// @brief Determine the K bins with the highest magnitudes (descending) of a transformed signal.
+/// @tparam T: Type of the complex numbers.
+/// @tparam N_SAMPLES: Size of the transformation.
+/// @tparam N_BINS: Size of the passed spectrum, either the full complex transformation or the N/2 bins of the real
+/// transformation (deduced).
+/// @tparam CAPACITY: Capacity of the passed peaks (deduced).
+/// @param max_entries: K, the number of bins that are needed at most (e.g. the partial count of the oscillators),
+/// clamped to the capacity.
+/// @return The number of valid entries, never more than max_entries.
+/// @note The bins are compared by their squared magnitude, the square root is only taken for the K survivors.
+template <FloatingPt T, size_t N_SAMPLES = BoundedPowTwo_v<size_t, 1024>, size_t N_BINS, size_t CAPACITY>
+    requires(is_bounded_pow_two(N_SAMPLES) && N_BINS >= (N_SAMPLES >> 1))
+[[nodiscard]] size_t calculate_max_map(const std::array<std::complex<T>, N_BINS>& samples_arr,
+                                       PeakArr<T, CAPACITY>& peaks, const T threshold,
+                                       const size_t max_entries = CAPACITY)
 {
     // in order not to treat some arbitrary rounding errors like 1e-13 as valid magnitudes, everything beyond 1 is
     // interpreted as 0.
     const T clipped_threshold = threshold >= 1 ? threshold : 1;
-    size_t valid_entries = 0;
+    const T squared_threshold = clipped_threshold * clipped_threshold;
+    LoudestPeaks<T, CAPACITY> loudest_peaks{peaks, max_entries};
     for (size_t bin_number = 0; bin_number < N_SAMPLES >> 1; ++bin_number)
     {
-        if (const auto abs_val = std::abs<T>(samples_arr[bin_number]); abs_val >= clipped_threshold)
+        if (const T squared_mag = std::norm(samples_arr[bin_number]); squared_mag >= squared_threshold)
+        {
+            loudest_peaks.offer(static_cast<uint32_t>(bin_number) << PeakArr<T, CAPACITY>::bin_fraction_bits,
+                                squared_mag);
+        }
+    }
+    const size_t valid_entries = loudest_peaks.finish();
+    for (size_t entry = 0; entry < valid_entries; ++entry)
+    {
+        peaks.m_magnitudes[entry] = std::sqrt(peaks.m_magnitudes[entry]);
+    }
+    return valid_entries;
+}
+
+/// @brief Determine the K loudest spectral peaks (descending) with their interpolated frequencies and magnitudes.
+/// Only local maxima of the magnitude spectrum are peaks, so the skirts of a loud partial don't occupy oscillators.
+/// Every peak is refined by fitting a parabola through the log magnitudes of the peak bin and its two neighbours
+/// (quadratic interpolation), which locates a sinusoid between the bins.
+/// @tparam T: Type of the complex numbers.
+/// @tparam N_SAMPLES: Size of the transformation.
+/// @tparam N_BINS: Size of the passed spectrum (deduced).
+/// @tparam CAPACITY: Capacity of the passed peaks (deduced).
+/// @param max_entries: K, the number of peaks that are needed at most, clamped to the capacity.
+/// @return The number of valid entries, never more than max_entries.
+/// @note The first and the last bin are never treated as peaks since they lack a neighbour. The interpolation is most
+/// accurate with a smooth window like HANN, with RECTANGULAR the frequency is still closer than the bin centre.
+template <FloatingPt T, size_t N_SAMPLES = BoundedPowTwo_v<size_t, 1024>, size_t N_BINS, size_t CAPACITY>
+    requires(is_bounded_pow_two(N_SAMPLES) && N_BINS >= (N_SAMPLES >> 1))
+[[nodiscard]] size_t calculate_peak_map(const std::array<std::complex<T>, N_BINS>& samples_arr,
+                                        PeakArr<T, CAPACITY>& peaks, const T threshold,
+                                        const size_t max_entries = CAPACITY)
+{
+    constexpr size_t num_bins = N_SAMPLES >> 1;
+    // see calculate_max_map
+    const T clipped_threshold = threshold >= 1 ? threshold : 1;
+    const T squared_threshold = clipped_threshold * clipped_threshold;
+    LoudestPeaks<T, CAPACITY> loudest_peaks{peaks, max_entries};
+    if constexpr (num_bins >= 3)
+    {
+        T previous = std::norm(samples_arr[0]);
+        T current = std::norm(samples_arr[1]);
+        for (size_t bin_number = 1; bin_number < num_bins - 1; ++bin_number)
+        {
+            const T next = std::norm(samples_arr[bin_number + 1]);
+            if (current >= squared_threshold && current > previous && current >= next)
+            {
+                loudest_peaks.offer(static_cast<uint32_t>(bin_number) << PeakArr<T, CAPACITY>::bin_fraction_bits,
+                                    current);
+            }
+            previous = current;
+            current = next;
+        }
+    }
+    const size_t valid_entries = loudest_peaks.finish();
+    for (size_t entry = 0; entry < valid_entries; ++entry)
+    {
+        // ln|X| = ln(|X|^2) / 2. Only the peak is above the threshold, a neighbour can be exactly zero (e.g. a
+        // tone right on a bin with a rectangular window), so it is clamped to the smallest normal number first.
+        const size_t bin_number = peaks.whole_bin(entry);
+        const T alpha = std::log(std::max(std::norm(samples_arr[bin_number - 1]), std::numeric_limits<T>::min())) / 2;
+        const T beta = std::log(peaks.m_magnitudes[entry]) / 2;
+        const T gamma = std::log(std::max(std::norm(samples_arr[bin_number + 1]), std::numeric_limits<T>::min())) / 2;
+        const T curvature = alpha - 2 * beta + gamma;
+        // a flat top (curvature 0) can only happen with equal neighbours, the peak is on the bin then.
+        const T offset = curvature < 0 ? static_cast<T>(0.5) * (alpha - gamma) / curvature : 0;
+        peaks.set(entry,
+                  static_cast<T>(bin_number) + offset,
+                  std::exp(beta - static_cast<T>(0.25) * (alpha - gamma) * offset));
+    }
+    // the interpolation barely changes the order, an insertion sort is close to linear then.
+    for (size_t entry = 1; entry < valid_entries; ++entry)
+    {
+        const uint32_t fixed_bin = peaks.m_bins[entry];
+        const T magnitude = peaks.m_magnitudes[entry];
+        size_t position = entry;
+        for (; position > 0 && peaks.m_magnitudes[position - 1] < magnitude; --position)
         {
-            bin_mag_arr[valid_entries] = std::make_pair(bin_number, abs_val);
-            ++valid_entries;
+            peaks.m_bins[position] = peaks.m_bins[position - 1];
+            peaks.m_magnitudes[position] = peaks.m_magnitudes[position - 1];
         }
+        peaks.m_bins[position] = fixed_bin;
+        peaks.m_magnitudes[position] = magnitude;
     }
-    // sort the spectrum by descending magnitude (lambda)
-    std::partial_sort(bin_mag_arr.begin(),
-                      bin_mag_arr.begin() + valid_entries,
-                      bin_mag_arr.end(),
-                      [](const std::pair<size_t, T>& pair_a, const std::pair<size_t, T>& pair_b) -> bool
-                      { return pair_a.second > pair_b.second; });
     return valid_entries;
 }
 
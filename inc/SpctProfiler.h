@@ -0,0 +1,214 @@
+/**
+ * Author: Lucas Scheidt
+ * Date: 14.10.26
+ *
+ * Description: Optional instrumentation of the processing stages. The audio thread pushes the cost of every stage
+ * into a wait-free ring, any other thread drains it into histograms. Enabled with SPCT_ENABLE_PROFILING, otherwise
+ * the profiler is an empty type and every timer compiles to nothing.
+ */
+
+#pragma once
+#include "SpctDomainSpecific.h"
+#include "SpctSpscQueue.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#if defined(__x86_64__) || defined(_M_X64)
+#include <x86intrin.h>
+#endif
+
+namespace LBTS::Spectral
+{
+#if defined(SPCT_ENABLE_PROFILING)
+inline constexpr bool profiling_enabled = true;
+#else
+inline constexpr bool profiling_enabled = false;
+#endif
+
+/// @brief Stages of BufferManager::process_daw_chunk.
+enum class ProfileStage : uint8_t
+{
+    FILL,
+    FFT,
+    PEAK_SELECT,
+    TUNE,
+    RENDER
+};
+
+inline constexpr size_t num_profile_stages = 5;
+
+constexpr const char* profile_stage_name(const ProfileStage stage) noexcept
+{
+    constexpr std::array<const char*, num_profile_stages> names{"fill", "fft", "peak select", "tune", "render"};
+    return names[static_cast<size_t>(stage)];
+}
+
+/// @brief Time stamp counter on x86 (cycles), nanoseconds of the steady clock everywhere else.
+inline uint64_t read_profile_ticks() noexcept
+{
+#if defined(__x86_64__) || defined(_M_X64)
+    return __rdtsc();
+#else
+    return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+}
+
+/// @brief One measured stage.
+struct ProfileSample
+{
+    ProfileStage m_stage;
+    uint64_t m_ticks;
+};
+
+/// @brief Per instance ring of measurements, the audio thread is the producer, one other thread the consumer.
+/// @tparam ENABLED: false gives an empty type without any code (the default unless SPCT_ENABLE_PROFILING is set).
+/// @tparam CAPACITY: Measurements that can be buffered, if the consumer doesn't keep up the newest ones get dropped.
+template <bool ENABLED = profiling_enabled, size_t CAPACITY = 1024>
+class StageProfiler
+{
+  public:
+    static constexpr bool enabled = true;
+
+    /// @brief Audio thread only. Never blocks or allocates.
+    void record(const ProfileStage stage, const uint64_t ticks) noexcept
+    {
+        if (!m_samples.push({stage, ticks}))
+        {
+            m_dropped_samples.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    /// @brief Consumer thread only.
+    std::optional<ProfileSample> pop() noexcept { return m_samples.pop(); }
+
+    [[nodiscard]] uint64_t dropped_samples() const noexcept
+    {
+        return m_dropped_samples.load(std::memory_order_relaxed);
+    }
+
+  private:
+    SpscQueue<ProfileSample, CAPACITY> m_samples{};
+    std::atomic<uint64_t> m_dropped_samples{0};
+};
+
+template <size_t CAPACITY>
+class StageProfiler<false, CAPACITY>
+{
+  public:
+    static constexpr bool enabled = false;
+
+    void record(const ProfileStage, const uint64_t) noexcept {}
+
+    std::optional<ProfileSample> pop() noexcept { return std::nullopt; }
+
+    [[nodiscard]] uint64_t dropped_samples() const noexcept { return 0; }
+};
+
+/// @brief Records the ticks between construction and destruction as one stage.
+template <typename PROFILER>
+class ScopedStageTimer
+{
+  public:
+    ScopedStageTimer(PROFILER& profiler, const ProfileStage stage) noexcept : m_profiler{profiler}, m_stage{stage}
+    {
+        if constexpr (PROFILER::enabled)
+        {
+            m_start = read_profile_ticks();
+        }
+    }
+
+    ~ScopedStageTimer()
+    {
+        if constexpr (PROFILER::enabled)
+        {
+            m_profiler.record(m_stage, read_profile_ticks() - m_start);
+        }
+    }
+
+    ScopedStageTimer(const ScopedStageTimer&) = delete;
+    ScopedStageTimer& operator=(const ScopedStageTimer&) = delete;
+
+  private:
+    PROFILER& m_profiler;
+    ProfileStage m_stage;
+    uint64_t m_start = 0;
+};
+
+/// @brief Aggregation of the drained measurements (not real-time safe code is fine here, but it doesn't allocate
+/// either). The buckets are powers of two of the ticks.
+class ProfileHistogram
+{
+  public:
+    static constexpr size_t num_buckets = 64;
+
+    struct StageStatistics
+    {
+        uint64_t m_count = 0;
+        uint64_t m_total_ticks = 0;
+        uint64_t m_max_ticks = 0;
+        // bucket b counts the measurements with bit_width(ticks) == b.
+        std::array<uint64_t, num_buckets + 1> m_buckets{};
+    };
+
+    void add(const ProfileSample& sample) noexcept
+    {
+        auto& statistics = m_stages[static_cast<size_t>(sample.m_stage)];
+        ++statistics.m_count;
+        statistics.m_total_ticks += sample.m_ticks;
+        statistics.m_max_ticks = std::max(statistics.m_max_ticks, sample.m_ticks);
+        ++statistics.m_buckets[std::bit_width(sample.m_ticks)];
+    }
+
+    /// @brief Take over everything the profiler recorded so far.
+    /// @return The number of drained measurements.
+    template <typename PROFILER>
+    size_t drain(PROFILER& profiler) noexcept
+    {
+        size_t num_samples = 0;
+        while (const auto sample = profiler.pop())
+        {
+            add(*sample);
+            ++num_samples;
+        }
+        return num_samples;
+    }
+
+    [[nodiscard]] const StageStatistics& statistics(const ProfileStage stage) const noexcept
+    {
+        return m_stages[static_cast<size_t>(stage)];
+    }
+
+    /// @brief Upper bound of the ticks of the given fraction (e.g. 0.99) of the measurements of a stage.
+    [[nodiscard]] uint64_t percentile_ticks(const ProfileStage stage, const double fraction) const noexcept
+    {
+        const auto& statistics = m_stages[static_cast<size_t>(stage)];
+        const auto needed = static_cast<uint64_t>(fraction * static_cast<double>(statistics.m_count));
+        uint64_t counted = 0;
+        for (size_t bucket = 0; bucket < statistics.m_buckets.size(); ++bucket)
+        {
+            counted += statistics.m_buckets[bucket];
+            if (counted >= needed && counted > 0)
+            {
+                return std::min(statistics.m_max_ticks, bucket_upper_bound(bucket));
+            }
+        }
+        return statistics.m_max_ticks;
+    }
+
+    void reset() noexcept { m_stages = {}; }
+
+  private:
+    /// @brief Largest tick count of a bucket, the top one ends at the range of uint64_t (a shift by 64 is UB).
+    static constexpr uint64_t bucket_upper_bound(const size_t bucket) noexcept
+    {
+        return bucket >= num_buckets ? std::numeric_limits<uint64_t>::max() : (uint64_t{1} << bucket) - 1;
+    }
+
+    std::array<StageStatistics, num_profile_stages> m_stages{};
+};
+} // namespace LBTS::Spectral
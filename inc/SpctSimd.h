@@ -0,0 +1,302 @@
+/**
+ * Author: Lucas Scheidt
+ * Date: 14.10.26
+ *
+ * Description: Thin wrapper around the SIMD registers of the supported platforms (AVX2, SSE2, NEON). The instruction
+ * set is chosen at build time by the compiler flags, if none is available (or SPCT_DISABLE_SIMD is defined) the
+ * wrapper falls back to a width of one, which is plain scalar code.
+ */
+
+#pragma once
+#include "SpctDomainSpecific.h"
+#include <cstdint>
+
+#if !defined(SPCT_DISABLE_SIMD)
+#if defined(__AVX2__)
+#define SPCT_SIMD_AVX2
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#define SPCT_SIMD_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#define SPCT_SIMD_NEON
+#include <arm_neon.h>
+#endif
+#endif
+
+namespace LBTS::Spectral
+{
+/**
+ * @section this header contains:
+ * ScalarVec<T> and SimdVec<T> with the members:
+ * - width: number of values of type T in one register
+ * - load / store (unaligned)
+ * - broadcast
+ * - add / sub / mul
+ * - ireg: register with one uint32_t per lane of reg (the fixed point phases of the oscillators) with
+ *   load_u32 / store_u32 / broadcast_u32, add_u32 (wraps around), and_u32, shift_right_u32 and to_float (only for
+ *   values below 2^31, which the fractions of the phases are)
+ * - gather (table[i] for every lane of an ireg, no mask: the tables have guard points around them)
+ *
+ * @note
+ * (At least) 16 Byte are available with every implementation except the fallback. AVX2 has to be enabled explicitely
+ * (e.g. with the cmake option SPCT_ENABLE_AVX2) since the default x86-64 target only guarantees SSE2.
+ * Double precision vectors aren't available with 32 Bit NEON, in that case double runs scalar.
+ */
+
+/// @brief Name of the instruction set the SIMD kernels got compiled with.
+#if defined(SPCT_SIMD_AVX2)
+constexpr const char* simd_instruction_set = "AVX2";
+#elif defined(SPCT_SIMD_SSE2)
+constexpr const char* simd_instruction_set = "SSE2";
+#elif defined(SPCT_SIMD_NEON)
+constexpr const char* simd_instruction_set = "NEON";
+#else
+constexpr const char* simd_instruction_set = "none (scalar)";
+#endif
+
+/// @brief Scalar "register" with the same interface as the vector implementations. Used for the fallback as well as
+/// for the parts of the kernels that are too short for a whole register.
+template <FloatingPt T>
+struct ScalarVec
+{
+    using reg = T;
+    static constexpr size_t width = 1;
+    static reg load(const T* ptr) noexcept { return *ptr; }
+    static void store(T* ptr, const reg value) noexcept { *ptr = value; }
+    static reg broadcast(const T value) noexcept { return value; }
+    static reg add(const reg lhs, const reg rhs) noexcept { return lhs + rhs; }
+    static reg sub(const reg lhs, const reg rhs) noexcept { return lhs - rhs; }
+    static reg mul(const reg lhs, const reg rhs) noexcept { return lhs * rhs; }
+
+    using ireg = uint32_t;
+    static ireg load_u32(const uint32_t* ptr) noexcept { return *ptr; }
+    static void store_u32(uint32_t* ptr, const ireg value) noexcept { *ptr = value; }
+    static ireg broadcast_u32(const uint32_t value) noexcept { return value; }
+    static ireg add_u32(const ireg lhs, const ireg rhs) noexcept { return lhs + rhs; }
+    static ireg and_u32(const ireg lhs, const ireg rhs) noexcept { return lhs & rhs; }
+    template <int SHIFT>
+    static ireg shift_right_u32(const ireg value) noexcept
+    {
+        return value >> SHIFT;
+    }
+    static reg to_float(const ireg value) noexcept { return static_cast<T>(value); }
+    static reg gather(const T* table, const ireg index) noexcept { return table[index]; }
+};
+
+/// @brief Gather for the platforms without a gather instruction, the lanes get loaded one after the other.
+template <typename VEC, FloatingPt T>
+typename VEC::reg gather_per_lane(const T* table, const typename VEC::ireg index) noexcept
+{
+    alignas(64) uint32_t lane_indices[VEC::width];
+    alignas(64) T lane_values[VEC::width];
+    VEC::store_u32(lane_indices, index);
+    for (size_t lane = 0; lane < VEC::width; ++lane)
+    {
+        lane_values[lane] = table[lane_indices[lane]];
+    }
+    return VEC::load(lane_values);
+}
+
+/// @brief Fallback for every type / platform combination without vector support.
+template <FloatingPt T>
+struct SimdVec : ScalarVec<T>
+{};
+
+#if defined(SPCT_SIMD_AVX2)
+template <>
+struct SimdVec<float>
+{
+    using reg = __m256;
+    static constexpr size_t width = 8;
+    static reg load(const float* ptr) noexcept { return _mm256_loadu_ps(ptr); }
+    static void store(float* ptr, const reg value) noexcept { _mm256_storeu_ps(ptr, value); }
+    static reg broadcast(const float value) noexcept { return _mm256_set1_ps(value); }
+    static reg add(const reg lhs, const reg rhs) noexcept { return _mm256_add_ps(lhs, rhs); }
+    static reg sub(const reg lhs, const reg rhs) noexcept { return _mm256_sub_ps(lhs, rhs); }
+    static reg mul(const reg lhs, const reg rhs) noexcept { return _mm256_mul_ps(lhs, rhs); }
+
+    using ireg = __m256i;
+    static ireg load_u32(const uint32_t* ptr) noexcept { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ptr)); }
+    static void store_u32(uint32_t* ptr, const ireg value) noexcept
+    {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(ptr), value);
+    }
+    static ireg broadcast_u32(const uint32_t value) noexcept { return _mm256_set1_epi32(static_cast<int>(value)); }
+    static ireg add_u32(const ireg lhs, const ireg rhs) noexcept { return _mm256_add_epi32(lhs, rhs); }
+    static ireg and_u32(const ireg lhs, const ireg rhs) noexcept { return _mm256_and_si256(lhs, rhs); }
+    template <int SHIFT>
+    static ireg shift_right_u32(const ireg value) noexcept
+    {
+        return _mm256_srli_epi32(value, SHIFT);
+    }
+    static reg to_float(const ireg value) noexcept { return _mm256_cvtepi32_ps(value); }
+    static reg gather(const float* table, const ireg index) noexcept { return _mm256_i32gather_ps(table, index, 4); }
+};
+
+template <>
+struct SimdVec<double>
+{
+    using reg = __m256d;
+    static constexpr size_t width = 4;
+    static reg load(const double* ptr) noexcept { return _mm256_loadu_pd(ptr); }
+    static void store(double* ptr, const reg value) noexcept { _mm256_storeu_pd(ptr, value); }
+    static reg broadcast(const double value) noexcept { return _mm256_set1_pd(value); }
+    static reg add(const reg lhs, const reg rhs) noexcept { return _mm256_add_pd(lhs, rhs); }
+    static reg sub(const reg lhs, const reg rhs) noexcept { return _mm256_sub_pd(lhs, rhs); }
+    static reg mul(const reg lhs, const reg rhs) noexcept { return _mm256_mul_pd(lhs, rhs); }
+
+    // four lanes of uint32_t fill half a register.
+    using ireg = __m128i;
+    static ireg load_u32(const uint32_t* ptr) noexcept { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr)); }
+    static void store_u32(uint32_t* ptr, const ireg value) noexcept
+    {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(ptr), value);
+    }
+    static ireg broadcast_u32(const uint32_t value) noexcept { return _mm_set1_epi32(static_cast<int>(value)); }
+    static ireg add_u32(const ireg lhs, const ireg rhs) noexcept { return _mm_add_epi32(lhs, rhs); }
+    static ireg and_u32(const ireg lhs, const ireg rhs) noexcept { return _mm_and_si128(lhs, rhs); }
+    template <int SHIFT>
+    static ireg shift_right_u32(const ireg value) noexcept
+    {
+        return _mm_srli_epi32(value, SHIFT);
+    }
+    static reg to_float(const ireg value) noexcept { return _mm256_cvtepi32_pd(value); }
+    static reg gather(const double* table, const ireg index) noexcept { return _mm256_i32gather_pd(table, index, 8); }
+};
+#elif defined(SPCT_SIMD_SSE2)
+template <>
+struct SimdVec<float>
+{
+    using reg = __m128;
+    static constexpr size_t width = 4;
+    static reg load(const float* ptr) noexcept { return _mm_loadu_ps(ptr); }
+    static void store(float* ptr, const reg value) noexcept { _mm_storeu_ps(ptr, value); }
+    static reg broadcast(const float value) noexcept { return _mm_set1_ps(value); }
+    static reg add(const reg lhs, const reg rhs) noexcept { return _mm_add_ps(lhs, rhs); }
+    static reg sub(const reg lhs, const reg rhs) noexcept { return _mm_sub_ps(lhs, rhs); }
+    static reg mul(const reg lhs, const reg rhs) noexcept { return _mm_mul_ps(lhs, rhs); }
+
+    using ireg = __m128i;
+    static ireg load_u32(const uint32_t* ptr) noexcept { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr)); }
+    static void store_u32(uint32_t* ptr, const ireg value) noexcept
+    {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(ptr), value);
+    }
+    static ireg broadcast_u32(const uint32_t value) noexcept { return _mm_set1_epi32(static_cast<int>(value)); }
+    static ireg add_u32(const ireg lhs, const ireg rhs) noexcept { return _mm_add_epi32(lhs, rhs); }
+    static ireg and_u32(const ireg lhs, const ireg rhs) noexcept { return _mm_and_si128(lhs, rhs); }
+    template <int SHIFT>
+    static ireg shift_right_u32(const ireg value) noexcept
+    {
+        return _mm_srli_epi32(value, SHIFT);
+    }
+    static reg to_float(const ireg value) noexcept { return _mm_cvtepi32_ps(value); }
+    static reg gather(const float* table, const ireg index) noexcept
+    {
+        return gather_per_lane<SimdVec<float>>(table, index);
+    }
+};
+
+template <>
+struct SimdVec<double>
+{
+    using reg = __m128d;
+    static constexpr size_t width = 2;
+    static reg load(const double* ptr) noexcept { return _mm_loadu_pd(ptr); }
+    static void store(double* ptr, const reg value) noexcept { _mm_storeu_pd(ptr, value); }
+    static reg broadcast(const double value) noexcept { return _mm_set1_pd(value); }
+    static reg add(const reg lhs, const reg rhs) noexcept { return _mm_add_pd(lhs, rhs); }
+    static reg sub(const reg lhs, const reg rhs) noexcept { return _mm_sub_pd(lhs, rhs); }
+    static reg mul(const reg lhs, const reg rhs) noexcept { return _mm_mul_pd(lhs, rhs); }
+
+    // only the lower two lanes of uint32_t are used.
+    using ireg = __m128i;
+    static ireg load_u32(const uint32_t* ptr) noexcept { return _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ptr)); }
+    static void store_u32(uint32_t* ptr, const ireg value) noexcept
+    {
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(ptr), value);
+    }
+    static ireg broadcast_u32(const uint32_t value) noexcept { return _mm_set1_epi32(static_cast<int>(value)); }
+    static ireg add_u32(const ireg lhs, const ireg rhs) noexcept { return _mm_add_epi32(lhs, rhs); }
+    static ireg and_u32(const ireg lhs, const ireg rhs) noexcept { return _mm_and_si128(lhs, rhs); }
+    template <int SHIFT>
+    static ireg shift_right_u32(const ireg value) noexcept
+    {
+        return _mm_srli_epi32(value, SHIFT);
+    }
+    static reg to_float(const ireg value) noexcept { return _mm_cvtepi32_pd(value); }
+    static reg gather(const double* table, const ireg index) noexcept
+    {
+        return gather_per_lane<SimdVec<double>>(table, index);
+    }
+};
+#elif defined(SPCT_SIMD_NEON)
+template <>
+struct SimdVec<float>
+{
+    using reg = float32x4_t;
+    static constexpr size_t width = 4;
+    static reg load(const float* ptr) noexcept { return vld1q_f32(ptr); }
+    static void store(float* ptr, const reg value) noexcept { vst1q_f32(ptr, value); }
+    static reg broadcast(const float value) noexcept { return vdupq_n_f32(value); }
+    static reg add(const reg lhs, const reg rhs) noexcept { return vaddq_f32(lhs, rhs); }
+    static reg sub(const reg lhs, const reg rhs) noexcept { return vsubq_f32(lhs, rhs); }
+    static reg mul(const reg lhs, const reg rhs) noexcept { return vmulq_f32(lhs, rhs); }
+
+    using ireg = uint32x4_t;
+    static ireg load_u32(const uint32_t* ptr) noexcept { return vld1q_u32(ptr); }
+    static void store_u32(uint32_t* ptr, const ireg value) noexcept { vst1q_u32(ptr, value); }
+    static ireg broadcast_u32(const uint32_t value) noexcept { return vdupq_n_u32(value); }
+    static ireg add_u32(const ireg lhs, const ireg rhs) noexcept { return vaddq_u32(lhs, rhs); }
+    static ireg and_u32(const ireg lhs, const ireg rhs) noexcept { return vandq_u32(lhs, rhs); }
+    template <int SHIFT>
+    static ireg shift_right_u32(const ireg value) noexcept
+    {
+        return vshrq_n_u32(value, SHIFT);
+    }
+    static reg to_float(const ireg value) noexcept { return vcvtq_f32_u32(value); }
+    static reg gather(const float* table, const ireg index) noexcept
+    {
+        return gather_per_lane<SimdVec<float>>(table, index);
+    }
+};
+
+#if defined(__aarch64__)
+template <>
+struct SimdVec<double>
+{
+    using reg = float64x2_t;
+    static constexpr size_t width = 2;
+    static reg load(const double* ptr) noexcept { return vld1q_f64(ptr); }
+    static void store(double* ptr, const reg value) noexcept { vst1q_f64(ptr, value); }
+    static reg broadcast(const double value) noexcept { return vdupq_n_f64(value); }
+    static reg add(const reg lhs, const reg rhs) noexcept { return vaddq_f64(lhs, rhs); }
+    static reg sub(const reg lhs, const reg rhs) noexcept { return vsubq_f64(lhs, rhs); }
+    static reg mul(const reg lhs, const reg rhs) noexcept { return vmulq_f64(lhs, rhs); }
+
+    using ireg = uint32x2_t;
+    static ireg load_u32(const uint32_t* ptr) noexcept { return vld1_u32(ptr); }
+    static void store_u32(uint32_t* ptr, const ireg value) noexcept { vst1_u32(ptr, value); }
+    static ireg broadcast_u32(const uint32_t value) noexcept { return vdup_n_u32(value); }
+    static ireg add_u32(const ireg lhs, const ireg rhs) noexcept { return vadd_u32(lhs, rhs); }
+    static ireg and_u32(const ireg lhs, const ireg rhs) noexcept { return vand_u32(lhs, rhs); }
+    template <int SHIFT>
+    static ireg shift_right_u32(const ireg value) noexcept
+    {
+        return vshr_n_u32(value, SHIFT);
+    }
+    static reg to_float(const ireg value) noexcept { return vcvtq_f64_u64(vmovl_u32(value)); }
+    static reg gather(const double* table, const ireg index) noexcept
+    {
+        return gather_per_lane<SimdVec<double>>(table, index);
+    }
+};
+#endif
+#endif
+
+/// @brief True if there is a vector implementation for this type on the current platform.
+template <FloatingPt T>
+constexpr bool has_simd_v = SimdVec<T>::width > 1;
+
+} // namespace LBTS::Spectral
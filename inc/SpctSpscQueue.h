@@ -0,0 +1,73 @@
+/**
+ * Author: Lucas Scheidt
+ * Date: 14.10.26
+ *
+ * Description: Wait-free single producer single consumer queue. Used to hand data from the control (UI) thread to
+ * the audio thread without locks, so the audio thread can never be blocked by a lower priority thread.
+ */
+
+#pragma once
+#include "SpctDomainSpecific.h"
+#include <array>
+#include <atomic>
+#include <optional>
+#include <type_traits>
+
+namespace LBTS::Spectral
+{
+/// @brief Fixed size ring of elements between exactly one producer and exactly one consumer thread.
+/// Both sides only ever do a bounded number of steps (wait-free), a full queue rejects the element instead of
+/// waiting.
+/// @tparam T: Type of the elements, has to be trivially copyable (no allocation, no torn objects).
+/// @tparam CAPACITY: Number of elements, power of two so the wrap around is a mask.
+template <typename T, size_t CAPACITY>
+    requires(std::is_trivially_copyable_v<T> && CAPACITY >= 2 && (CAPACITY & (CAPACITY - 1)) == 0)
+class SpscQueue
+{
+  public:
+    static constexpr size_t capacity = CAPACITY;
+
+    /// @brief Producer side only.
+    /// @return false if the queue is full, the element is dropped then.
+    bool push(const T& element) noexcept
+    {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load(std::memory_order_acquire) == CAPACITY)
+        {
+            return false;
+        }
+        m_elements[tail & (CAPACITY - 1)] = element;
+        // publishes the element to the consumer
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// @brief Consumer side only.
+    /// @return The oldest element or nothing if the queue is empty.
+    std::optional<T> pop() noexcept
+    {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire))
+        {
+            return std::nullopt;
+        }
+        const T element = m_elements[head & (CAPACITY - 1)];
+        // hands the slot back to the producer
+        m_head.store(head + 1, std::memory_order_release);
+        return element;
+    }
+
+    /// @note Only a snapshot if called while the other side is active.
+    [[nodiscard]] bool empty() const noexcept
+    {
+        return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+    }
+
+  private:
+    // the indices only ever increase (and wrap at the end of size_t which is a multiple of CAPACITY), the indices live
+    // on separate cache lines so producer and consumer don't invalidate each other.
+    alignas(64) std::atomic<size_t> m_head{0};
+    alignas(64) std::atomic<size_t> m_tail{0};
+    alignas(64) std::array<T, CAPACITY> m_elements{};
+};
+} // namespace LBTS::Spectral
@@ -0,0 +1,63 @@
+/**
+ * Author: Lucas Scheidt
+ * Date: 14.10.26
+ *
+ * Description: Lock-free triple buffer. Hands the latest version of a (large) value from one writer thread to one
+ * reader thread. Neither side ever waits for the other and no element gets copied: the three buffers only change
+ * their roles.
+ */
+
+#pragma once
+#include "SpctDomainSpecific.h"
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace LBTS::Spectral
+{
+/// @brief The writer fills its back buffer and swaps it with the middle one, the reader swaps its front buffer with the
+/// middle one if that contains something new. Older versions the reader didn't pick up in time get overwritten
+/// (latest value wins, which is what a stream of analysis results wants).
+/// @tparam T: Type of the value.
+template <typename T>
+class TripleBuffer
+{
+  public:
+    /// @brief Writer side only. The buffer stays owned by the writer until publish.
+    T& write_buffer() noexcept { return m_buffers[m_write_index]; }
+
+    /// @brief Writer side only. Publishes the write buffer, afterwards write_buffer refers to another buffer.
+    void publish() noexcept
+    {
+        const uint8_t previous = m_middle.exchange(static_cast<uint8_t>(m_write_index | fresh_flag),
+                                                   std::memory_order_acq_rel);
+        m_write_index = previous & index_mask;
+    }
+
+    /// @brief Reader side only. Makes the latest published value available in read_buffer.
+    /// @return false if nothing was published since the last update (read_buffer stays the same).
+    bool update() noexcept
+    {
+        if ((m_middle.load(std::memory_order_relaxed) & fresh_flag) == 0)
+        {
+            return false;
+        }
+        const uint8_t previous = m_middle.exchange(m_read_index, std::memory_order_acq_rel);
+        m_read_index = previous & index_mask;
+        return true;
+    }
+
+    /// @brief Reader side only. Stays valid (and unchanged) until the next update.
+    [[nodiscard]] const T& read_buffer() const noexcept { return m_buffers[m_read_index]; }
+
+  private:
+    static constexpr uint8_t index_mask = 0x03;
+    static constexpr uint8_t fresh_flag = 0x04;
+
+    std::array<T, 3> m_buffers{};
+    // index of the middle buffer (+ flag if it wasn't read yet), the only state both sides touch.
+    alignas(64) std::atomic<uint8_t> m_middle{1};
+    alignas(64) uint8_t m_write_index = 0;
+    alignas(64) uint8_t m_read_index = 2;
+};
+} // namespace LBTS::Spectral
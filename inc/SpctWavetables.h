@@ -2,63 +2,102 @@
  * Author: Lucas Scheidt
  * Date: 28.12.24
  *
- * Description: Wavetables to choose from. The first implementation only creates raw wavetables without regard to
- * the frequency they will later be used.
- *
- * @todo avoid aliasing:
- * wavetables shall be created with a frequency-dependent number of overtones via fourier series calculation.
+ * Description: Wavetables to choose from. The raw wavetables contain every overtone the table can hold and alias as
+ * soon as they are played back above a few hertz. The oscillators therefore read from the mip-mapped tables which are
+ * created with a pitch-dependent number of overtones via fourier series calculation (one table per octave). Both are
+ * generated at compile time, so creating an instance costs the same for every table size.
  */
 
 #pragma once
 
+#include "SpctConstexprMath.h"
 #include "SpctDomainSpecific.h"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <stdexcept>
+#include <type_traits>
 
 namespace LBTS::Spectral
 {
+/// @brief Every table (and every level of a mip map) is surrounded by copies of the entries of the opposite end:
+/// [x_N-1] x_0 .. x_N-1 [x_0 x_1]. The interpolation can then read x_i-1 .. x_i+2 for every i < N without a wrap check.
+constexpr size_t wt_guard_points_before = 1;
+constexpr size_t wt_guard_points_after = 2;
+
+/// @brief Write the guard points around the N entries that begin at first_entry.
+template <FloatingPt T>
+constexpr void fill_guard_points(T* first_entry, const size_t num_entries) noexcept
+{
+    for (size_t guard = 1; guard <= wt_guard_points_before; ++guard)
+    {
+        *(first_entry - guard) = first_entry[num_entries - guard];
+    }
+    for (size_t guard = 0; guard < wt_guard_points_after; ++guard)
+    {
+        first_entry[num_entries + guard] = first_entry[guard % num_entries];
+    }
+}
 
+/// @brief One cycle of a periodic function. Every table can be created at compile time (the generators are constexpr),
+/// the shared instances (SineWT_v etc.) are constant and therefore cost nothing at runtime, they are part of the binary.
+/// The entries are read only, so the guard points (see wt_guard_points_before) always match them.
 template <FloatingPt T, size_t WT_SIZE>
     requires(is_bounded_pow_two(WT_SIZE))
 struct WaveTable
 {
     // default wavetable
-    WaveTable() { m_wavetable.fill(0); }
-    // fill output with one cycle of the periodic function
-    explicit WaveTable(std::function<T(T)> periodic_fn)
+    constexpr WaveTable() { m_wavetable.fill(0); }
+    // fill output with one cycle of the periodic function (has to be constexpr for a compile-time table).
+    template <typename PERIODIC_FN>
+        requires std::is_invocable_r_v<T, PERIODIC_FN, T>
+    constexpr explicit WaveTable(PERIODIC_FN periodic_fn)
     {
         const T resolution = static_cast<T>(1) / WT_SIZE;
-        // for (auto& element : m_wavetable)
         for (size_t index = 0; index < WT_SIZE; ++index)
         {
-            m_wavetable[index] = periodic_fn(two_pi<T> * index * resolution);
+            m_wavetable[wt_guard_points_before + index] = periodic_fn(two_pi<T> * index * resolution);
         }
+        fill_guard_points(m_wavetable.data() + wt_guard_points_before, WT_SIZE);
     }
     ~WaveTable() = default;
     // read only access.
     // without range check
-    T operator[](const size_t index) const { return m_wavetable[index]; }
+    constexpr T operator[](const size_t index) const { return data()[index]; }
     // with range check
-    T at(size_t index) const { return m_wavetable.at(index); }
-    auto begin() noexcept { return m_wavetable.begin(); }
-    auto cbegin() const noexcept { return m_wavetable.cbegin(); }
-    auto end() noexcept { return m_wavetable.end(); }
-    auto cend() const noexcept { return m_wavetable.cend(); }
+    constexpr T at(size_t index) const
+    {
+        if (index >= WT_SIZE)
+        {
+            throw std::out_of_range("Tried to access a wavetable entry that is out of range!");
+        }
+        return data()[index];
+    }
+    // raw read only access for the block rendering, the guard points are in front of and behind the entries.
+    constexpr const T* data() const noexcept { return m_wavetable.data() + wt_guard_points_before; }
+    constexpr const T* begin() const noexcept { return data(); }
+    constexpr const T* cbegin() const noexcept { return data(); }
+    constexpr const T* end() const noexcept { return data() + WT_SIZE; }
+    constexpr const T* cend() const noexcept { return data() + WT_SIZE; }
 
   private:
-    std::array<T, WT_SIZE> m_wavetable{};
+    std::array<T, wt_guard_points_before + WT_SIZE + wt_guard_points_after> m_wavetable{};
 };
 
 template <FloatingPt T, size_t WT_SIZE>
     requires(is_bounded_pow_two(WT_SIZE))
 struct SineWT : public WaveTable<T, WT_SIZE>
 {
-    SineWT() : WaveTable<T, WT_SIZE>([](T value) -> T { return std::sin<T>(value); }) {}
+    // std::sin isn't constexpr, see SpctConstexprMath.h.
+    constexpr SineWT() : WaveTable<T, WT_SIZE>([](T value) -> T { return constexpr_sin(value); }) {}
 };
 
 template <FloatingPt T, size_t WT_SIZE>
     requires(is_bounded_pow_two(WT_SIZE))
 struct SquareWT : public WaveTable<T, WT_SIZE>
 {
-    SquareWT()
+    constexpr SquareWT()
         : WaveTable<T, WT_SIZE>([](T value)
                                 { return (value < std::numbers::pi_v<T>) ? static_cast<T>(-1) : static_cast<T>(1); })
     {
@@ -69,9 +108,8 @@ template <FloatingPt T, size_t WT_SIZE>
     requires(is_bounded_pow_two(WT_SIZE))
 struct SawWT : public WaveTable<T, WT_SIZE>
 {
-    SawWT()
-        : WaveTable<T, WT_SIZE>([](T value)
-                                { return -2 * std::numbers::inv_pi_v<T> * value + 1; })
+    constexpr SawWT()
+        : WaveTable<T, WT_SIZE>([](T value) { return -std::numbers::inv_pi_v<T> * value + 1; })
     {
     }
 };
@@ -80,7 +118,7 @@ template <FloatingPt T, size_t WT_SIZE>
     requires(is_bounded_pow_two(WT_SIZE))
 struct TriWT : public WaveTable<T, WT_SIZE>
 {
-    TriWT()
+    constexpr TriWT()
         : WaveTable<T, WT_SIZE>(
               [](T value)
               {
@@ -105,4 +143,151 @@ struct TriWT : public WaveTable<T, WT_SIZE>
     }
 };
 
-} // namespace LBTS::Spectral
\ No newline at end of file
+/// @brief For conveniance the raw tables can be accessed directly with the "_v" suffix, these are generated at compile
+/// time once per type and size and shared by everyone who uses them.
+template <FloatingPt T, size_t WT_SIZE>
+inline constexpr SineWT<T, WT_SIZE> SineWT_v{};
+template <FloatingPt T, size_t WT_SIZE>
+inline constexpr SquareWT<T, WT_SIZE> SquareWT_v{};
+template <FloatingPt T, size_t WT_SIZE>
+inline constexpr SawWT<T, WT_SIZE> SawWT_v{};
+template <FloatingPt T, size_t WT_SIZE>
+inline constexpr TriWT<T, WT_SIZE> TriWT_v{};
+
+/// @brief Band-limited versions of one waveform, one table per octave of the playback increment.
+/// Level l is meant for increments up to 2^l (table entries per sample) and contains the overtones up to WT_SIZE /
+/// 2^(l + 1), so none of them can exceed the nyquist frequency. The levels are stored one after the other (each one
+/// with its own guard points), so an oscillator only needs an offset to switch between them.
+/// @tparam T: Type of the wavetable entries.
+/// @tparam WT_SIZE: Size of every level.
+template <FloatingPt T, size_t WT_SIZE>
+    requires(is_bounded_pow_two(WT_SIZE) && WT_SIZE >= 2)
+class MipMappedWaveTable
+{
+  public:
+    static constexpr size_t num_levels = degree_of_pow_two_value(WT_SIZE);
+
+    /// @brief Sum up the fourier series of the waveform for every level (constexpr, see MipMappedWaveTable_v).
+    constexpr explicit MipMappedWaveTable(const OscWaveform osc_waveform);
+
+    /// @brief Highest overtone (as multiple of the fundamental) contained in a level.
+    [[nodiscard]] static constexpr size_t max_harmonic(const size_t level) noexcept { return WT_SIZE >> (level + 1); }
+
+    /// @brief Level that can be played with the given increment without aliasing (call once per retune).
+    [[nodiscard]] static size_t level_for_increment(const T increment) noexcept
+    {
+        // the smallest l with increment <= 2^l
+        const auto whole_increment = std::max<size_t>(static_cast<size_t>(std::ceil(increment)), 1);
+        return std::min<size_t>(std::bit_width(whole_increment - 1), num_levels - 1);
+    }
+
+    /// @brief Distance between the first entries of two neighbouring levels.
+    static constexpr size_t level_stride = wt_guard_points_before + WT_SIZE + wt_guard_points_after;
+
+    /// @brief Offset of a level relative to data().
+    [[nodiscard]] static constexpr size_t level_offset(const size_t level) noexcept { return level * level_stride; }
+
+    /// @brief WARNING! No range check, raw read only access to one level.
+    [[nodiscard]] constexpr const T* level(const size_t level) const noexcept { return data() + level_offset(level); }
+
+    /// @brief First entry of level 0, the other levels follow every level_stride entries.
+    [[nodiscard]] constexpr const T* data() const noexcept { return m_levels.data() + wt_guard_points_before; }
+
+  private:
+    std::array<T, level_stride * num_levels> m_levels{};
+};
+
+template <FloatingPt T, size_t WT_SIZE>
+    requires(is_bounded_pow_two(WT_SIZE) && WT_SIZE >= 2)
+constexpr MipMappedWaveTable<T, WT_SIZE>::MipMappedWaveTable(const OscWaveform osc_waveform)
+{
+    // sin(h * 2pi * i / N) is the entry (h * i) mod N of a sine table, so no sine has to be calculated at all.
+    const auto& sine_wt = SineWT_v<double, WT_SIZE>;
+    // coefficients of the series (same orientation as the raw tables)
+    const auto coefficient = [osc_waveform](const size_t harmonic) -> double
+    {
+        const auto order = static_cast<double>(harmonic);
+        const bool is_odd = (harmonic & 1) == 1;
+        switch (osc_waveform)
+        {
+        case OscWaveform::SAW:
+            return 2.0 * std::numbers::inv_pi / order;
+        case OscWaveform::SQUARE:
+            return is_odd ? -4.0 * std::numbers::inv_pi / order : 0.0;
+        case OscWaveform::TRIANGLE:
+        {
+            const double sign = (harmonic & 3) == 1 ? 1.0 : -1.0;
+            return is_odd ? sign * 8.0 * std::numbers::inv_pi * std::numbers::inv_pi / (order * order) : 0.0;
+        }
+        default:
+            return harmonic == 1 ? 1.0 : 0.0;
+        }
+    };
+    // the levels only differ in their highest harmonic: the sum runs once from the top level (the fewest harmonics)
+    // down to level 0 and every level is a snapshot of it, so every harmonic is added only once. The series only
+    // contains sines (odd functions), so the second half of a level is the mirrored first one: x_N-i = -x_i.
+    constexpr size_t half_size = WT_SIZE / 2;
+    std::array<double, half_size + 1> summed_half{};
+    size_t summed_harmonics = 0;
+    for (size_t level = num_levels; level-- > 0;)
+    {
+        for (size_t harmonic = summed_harmonics + 1; harmonic <= max_harmonic(level); ++harmonic)
+        {
+            const double harmonic_coefficient = coefficient(harmonic);
+            if (harmonic_coefficient == 0.0)
+            {
+                continue;
+            }
+            for (size_t index = 0, phase = 0; index <= half_size; ++index, phase = (phase + harmonic) & (WT_SIZE - 1))
+            {
+                summed_half[index] += harmonic_coefficient * sine_wt[phase];
+            }
+        }
+        summed_harmonics = max_harmonic(level);
+        T* first_entry = m_levels.data() + wt_guard_points_before + level_offset(level);
+        for (size_t index = 0; index <= half_size; ++index)
+        {
+            first_entry[index] = static_cast<T>(summed_half[index]);
+        }
+        for (size_t index = half_size + 1; index < WT_SIZE; ++index)
+        {
+            first_entry[index] = -first_entry[WT_SIZE - index];
+        }
+        fill_guard_points(first_entry, WT_SIZE);
+    }
+}
+
+/// @brief The mip maps every oscillator reads from, generated at compile time once per type, size and waveform.
+template <FloatingPt T, size_t WT_SIZE, OscWaveform WAVEFORM>
+inline constexpr MipMappedWaveTable<T, WT_SIZE> MipMappedWaveTable_v{WAVEFORM};
+
+/// @brief The read-only (mip-mapped) wavetables shared by every instance, keyed by (T, WT_SIZE, waveform).
+/// The tables are the compile-time instances (MipMappedWaveTable_v), so acquiring one neither locks nor allocates nor
+/// generates anything and can be done from any thread. A handle stays valid for the whole lifetime of the program.
+template <FloatingPt T, size_t WT_SIZE>
+    requires(is_bounded_pow_two(WT_SIZE) && WT_SIZE >= 2)
+class SharedWaveTables
+{
+  public:
+    using Handle = const MipMappedWaveTable<T, WT_SIZE>*;
+
+    SharedWaveTables() = delete;
+
+    /// @brief Get the table of a waveform.
+    [[nodiscard]] static constexpr Handle acquire(const OscWaveform osc_waveform) noexcept
+    {
+        switch (osc_waveform)
+        {
+        case OscWaveform::TRIANGLE:
+            return &MipMappedWaveTable_v<T, WT_SIZE, OscWaveform::TRIANGLE>;
+        case OscWaveform::SAW:
+            return &MipMappedWaveTable_v<T, WT_SIZE, OscWaveform::SAW>;
+        case OscWaveform::SQUARE:
+            return &MipMappedWaveTable_v<T, WT_SIZE, OscWaveform::SQUARE>;
+        default:
+            return &MipMappedWaveTable_v<T, WT_SIZE, OscWaveform::SINE>;
+        }
+    }
+};
+
+} // namespace LBTS::Spectral
@@ -0,0 +1,330 @@
+/**
+ * Author: Lucas Scheidt
+ * Date: 14.10.26
+ *
+ * Description: Polyphonic resynthesis. Every voice plays the peaks of the one shared analysis of the BufferManager,
+ * transposed to the pitch of its MIDI note. All voices are allocated up front, a note on / note off never touches the
+ * heap and runs in constant time.
+ */
+
+#pragma once
+#include "SpctBufferManager.h"
+#include "SpctDomainSpecific.h"
+#include "SpctOscillators.h"
+#include <array>
+#include <cmath>
+#include <utility>
+
+namespace LBTS::Spectral
+{
+/// @brief Fixed pool of voices with stealing of the oldest voice.
+/// @tparam T: Type of the samples.
+/// @tparam BUFFER_SIZE: Maximum FFT size of the BufferManager.
+/// @tparam NUM_VOICES: Size of the voice pool.
+///
+/// @note
+/// The active voices are kept in an intrusive list (oldest first), the idle voices on a stack and every note knows
+/// its voice, so allocating, stealing and releasing are O(1). Note events are expected on the audio thread (between
+/// two blocks), use the ControlPanel for anything coming from another thread.
+template <FloatingPt T, size_t BUFFER_SIZE = BoundedPowTwo_v<size_t, 1024>, size_t NUM_VOICES = 8>
+    requires(is_bounded_pow_two(BUFFER_SIZE) && NUM_VOICES > 0)
+class VoiceManager
+{
+  public:
+    /// @brief The analysed input is played back untransposed on this note (middle C).
+    static constexpr uint8_t root_note = 60;
+    static constexpr size_t num_voices = NUM_VOICES;
+    /// @brief Fade out after a note off, avoids clicks.
+    static constexpr double release_time_s = 0.01;
+    /// @brief The peaks of the shared analysis.
+    using Peaks = PeakArr<T, BufferManager<T, BUFFER_SIZE>::partial_capacity>;
+
+    /// @param buffer_manager: Provides the analysis, has to outlive the voice manager.
+    explicit VoiceManager(BufferManager<T, BUFFER_SIZE>& buffer_manager)
+        : m_buffer_manager{buffer_manager},
+          m_voices{make_voices(buffer_manager.sampling_freq(), std::make_index_sequence<NUM_VOICES>{})}
+    {
+        reset(buffer_manager.sampling_freq());
+    }
+
+    /// @note Deleted! The voice manager is tied to one BufferManager.
+    VoiceManager(const VoiceManager&) = delete;
+    /// @note Deleted! The voice manager is tied to one BufferManager.
+    VoiceManager& operator=(const VoiceManager&) = delete;
+
+    ~VoiceManager() = default;
+
+    /// @brief Start (or retrigger) a note, steals the oldest voice if all voices play.
+    /// @param velocity: 0 is treated as note off (MIDI running status).
+    void note_on(const uint8_t note, const uint8_t velocity) noexcept;
+
+    /// @brief Release the voice of a note (if it still has one).
+    void note_off(const uint8_t note) noexcept;
+
+    /// @brief Silence every voice immediately.
+    void reset(const double sampling_freq) noexcept;
+
+    void select_osc_waveform(const OscWaveform& osc_waveform) noexcept
+    {
+        for (auto& voice : m_voices)
+        {
+            voice.m_oscillators.select_waveform(osc_waveform);
+        }
+    }
+
+    void select_interpolation(const WTInterpolation interpolation) noexcept
+    {
+        for (auto& voice : m_voices)
+        {
+            voice.m_oscillators.select_interpolation(interpolation);
+        }
+    }
+
+    /// @brief Analyse the chunk once and render all active voices into it (overwrites the input).
+    void process_daw_chunk(T* daw_chunk, const size_t t_size, const T threshold = 1.0)
+    {
+        m_buffer_manager.process_daw_chunk(daw_chunk, t_size, threshold, *this);
+    }
+
+    [[nodiscard]] size_t active_voices() const noexcept { return NUM_VOICES - m_num_idle_voices; }
+
+    /**
+     * Resynthesizer interface, called by the BufferManager.
+     */
+    /// @brief Render the sum of all active voices (overwrites the output).
+    void process(T* output, const size_t num_samples) noexcept;
+
+    /// @brief Retune every active voice to the peaks of the latest frame.
+    void tune_oscillators(const Peaks& peaks, const size_t valid_entries) noexcept;
+
+  private:
+    using VoiceOscs = ResynthOscs<T, BoundedPowTwo_v<size_t, 512>, BUFFER_SIZE,
+                                  BufferManager<T, BUFFER_SIZE>::partial_capacity>;
+    static constexpr size_t no_voice = NUM_VOICES;
+    static constexpr size_t voice_block_size = 256;
+
+    struct Voice
+    {
+        explicit Voice(const double sampling_freq) : m_oscillators{sampling_freq} {}
+
+        VoiceOscs m_oscillators;
+        double m_frequency_ratio = 1.0;
+        T m_gain = 0;
+        // negative while releasing, zero otherwise
+        T m_gain_step = 0;
+        uint8_t m_note = 0;
+        // neighbours in the list of active voices
+        size_t m_older = no_voice;
+        size_t m_newer = no_voice;
+    };
+
+    template <size_t... VOICES>
+    static std::array<Voice, NUM_VOICES> make_voices(const double sampling_freq, std::index_sequence<VOICES...>)
+    {
+        return {((void)VOICES, Voice{sampling_freq})...};
+    }
+
+    void retune_voice(Voice& voice, const Peaks& peaks, const size_t valid_entries) noexcept;
+    void append_newest(const size_t voice_index) noexcept;
+    void unlink(const size_t voice_index) noexcept;
+    void free_voice(const size_t voice_index) noexcept;
+
+    BufferManager<T, BUFFER_SIZE>& m_buffer_manager;
+    std::array<Voice, NUM_VOICES> m_voices;
+    std::array<size_t, NUM_VOICES> m_idle_voices{};
+    size_t m_num_idle_voices = 0;
+    std::array<size_t, 128> m_note_to_voice{};
+    size_t m_oldest_voice = no_voice;
+    size_t m_newest_voice = no_voice;
+    T m_release_samples = 441;
+    std::array<T, voice_block_size> m_voice_block{};
+};
+
+/*
+ * IMPLEMENTATION
+ */
+template <FloatingPt T, size_t BUFFER_SIZE, size_t NUM_VOICES>
+    requires(is_bounded_pow_two(BUFFER_SIZE) && NUM_VOICES > 0)
+void VoiceManager<T, BUFFER_SIZE, NUM_VOICES>::note_on(const uint8_t note, const uint8_t velocity) noexcept
+{
+    if (velocity == 0)
+    {
+        note_off(note);
+        return;
+    }
+    const uint8_t valid_note = note & 0x7F;
+    size_t voice_index = m_note_to_voice[valid_note];
+    if (voice_index != no_voice)
+    {
+        // retrigger, the voice becomes the newest one
+        unlink(voice_index);
+    }
+    else if (m_num_idle_voices > 0)
+    {
+        voice_index = m_idle_voices[--m_num_idle_voices];
+    }
+    else
+    {
+        // steal the oldest voice, its note (if not released yet) loses the voice.
+        voice_index = m_oldest_voice;
+        if (m_note_to_voice[m_voices[voice_index].m_note] == voice_index)
+        {
+            m_note_to_voice[m_voices[voice_index].m_note] = no_voice;
+        }
+        unlink(voice_index);
+    }
+    append_newest(voice_index);
+    m_note_to_voice[valid_note] = voice_index;
+
+    Voice& voice = m_voices[voice_index];
+    voice.m_note = valid_note;
+    voice.m_frequency_ratio = std::exp2((static_cast<double>(valid_note) - root_note) / 12.0);
+    voice.m_gain = static_cast<T>(velocity & 0x7F) / 127;
+    voice.m_gain_step = 0;
+    // the new note starts with the latest analysis instead of waiting for the next frame.
+    voice.m_oscillators.reset(m_buffer_manager.sampling_freq());
+    retune_voice(voice, m_buffer_manager.peaks(), m_buffer_manager.valid_entries());
+}
+
+template <FloatingPt T, size_t BUFFER_SIZE, size_t NUM_VOICES>
+    requires(is_bounded_pow_two(BUFFER_SIZE) && NUM_VOICES > 0)
+void VoiceManager<T, BUFFER_SIZE, NUM_VOICES>::note_off(const uint8_t note) noexcept
+{
+    const uint8_t valid_note = note & 0x7F;
+    const size_t voice_index = m_note_to_voice[valid_note];
+    if (voice_index == no_voice)
+    {
+        return;
+    }
+    m_note_to_voice[valid_note] = no_voice;
+    Voice& voice = m_voices[voice_index];
+    voice.m_gain_step = -voice.m_gain / m_release_samples;
+}
+
+template <FloatingPt T, size_t BUFFER_SIZE, size_t NUM_VOICES>
+    requires(is_bounded_pow_two(BUFFER_SIZE) && NUM_VOICES > 0)
+void VoiceManager<T, BUFFER_SIZE, NUM_VOICES>::reset(const double sampling_freq) noexcept
+{
+    m_release_samples = std::max(static_cast<T>(release_time_s * sampling_freq), static_cast<T>(1));
+    m_note_to_voice.fill(no_voice);
+    m_oldest_voice = no_voice;
+    m_newest_voice = no_voice;
+    m_num_idle_voices = NUM_VOICES;
+    for (size_t voice_index = 0; voice_index < NUM_VOICES; ++voice_index)
+    {
+        // the first voice is on top of the stack
+        m_idle_voices[voice_index] = NUM_VOICES - 1 - voice_index;
+        m_voices[voice_index].m_oscillators.reset(sampling_freq);
+        m_voices[voice_index].m_older = no_voice;
+        m_voices[voice_index].m_newer = no_voice;
+    }
+}
+
+template <FloatingPt T, size_t BUFFER_SIZE, size_t NUM_VOICES>
+    requires(is_bounded_pow_two(BUFFER_SIZE) && NUM_VOICES > 0)
+void VoiceManager<T, BUFFER_SIZE, NUM_VOICES>::process(T* output, const size_t num_samples) noexcept
+{
+    std::fill_n(output, num_samples, static_cast<T>(0));
+    size_t voice_index = m_oldest_voice;
+    while (voice_index != no_voice)
+    {
+        Voice& voice = m_voices[voice_index];
+        const size_t newer_voice = voice.m_newer;
+        for (size_t block_start = 0; block_start < num_samples && voice.m_gain > 0; block_start += voice_block_size)
+        {
+            const size_t block_length = std::min(voice_block_size, num_samples - block_start);
+            voice.m_oscillators.process(m_voice_block.data(), block_length);
+            T* block_output = output + block_start;
+            if (voice.m_gain_step == 0)
+            {
+                for (size_t sample = 0; sample < block_length; ++sample)
+                {
+                    block_output[sample] += voice.m_gain * m_voice_block[sample];
+                }
+            }
+            else
+            {
+                for (size_t sample = 0; sample < block_length; ++sample)
+                {
+                    block_output[sample] += voice.m_gain * m_voice_block[sample];
+                    voice.m_gain = std::max(voice.m_gain + voice.m_gain_step, static_cast<T>(0));
+                }
+            }
+        }
+        // a released voice that faded out completely goes back to the pool
+        if (voice.m_gain <= 0)
+        {
+            free_voice(voice_index);
+        }
+        voice_index = newer_voice;
+    }
+}
+
+template <FloatingPt T, size_t BUFFER_SIZE, size_t NUM_VOICES>
+    requires(is_bounded_pow_two(BUFFER_SIZE) && NUM_VOICES > 0)
+void VoiceManager<T, BUFFER_SIZE, NUM_VOICES>::tune_oscillators(const Peaks& peaks,
+                                                                const size_t valid_entries) noexcept
+{
+    for (size_t voice_index = m_oldest_voice; voice_index != no_voice; voice_index = m_voices[voice_index].m_newer)
+    {
+        retune_voice(m_voices[voice_index], peaks, valid_entries);
+    }
+}
+
+template <FloatingPt T, size_t BUFFER_SIZE, size_t NUM_VOICES>
+    requires(is_bounded_pow_two(BUFFER_SIZE) && NUM_VOICES > 0)
+void VoiceManager<T, BUFFER_SIZE, NUM_VOICES>::retune_voice(Voice& voice,
+                                                            const Peaks& peaks,
+                                                            const size_t valid_entries) noexcept
+{
+    // the analysis may have changed its size or partial count in the meantime.
+    voice.m_oscillators.set_fft_size(m_buffer_manager.fft_size());
+    voice.m_oscillators.set_partial_count(m_buffer_manager.partial_count());
+    voice.m_oscillators.set_hop_size(m_buffer_manager.hop_size());
+    voice.m_oscillators.tune_oscillators(peaks, valid_entries, voice.m_frequency_ratio);
+}
+
+template <FloatingPt T, size_t BUFFER_SIZE, size_t NUM_VOICES>
+    requires(is_bounded_pow_two(BUFFER_SIZE) && NUM_VOICES > 0)
+void VoiceManager<T, BUFFER_SIZE, NUM_VOICES>::append_newest(const size_t voice_index) noexcept
+{
+    Voice& voice = m_voices[voice_index];
+    voice.m_older = m_newest_voice;
+    voice.m_newer = no_voice;
+    if (m_newest_voice != no_voice)
+    {
+        m_voices[m_newest_voice].m_newer = voice_index;
+    }
+    else
+    {
+        m_oldest_voice = voice_index;
+    }
+    m_newest_voice = voice_index;
+}
+
+template <FloatingPt T, size_t BUFFER_SIZE, size_t NUM_VOICES>
+    requires(is_bounded_pow_two(BUFFER_SIZE) && NUM_VOICES > 0)
+void VoiceManager<T, BUFFER_SIZE, NUM_VOICES>::unlink(const size_t voice_index) noexcept
+{
+    Voice& voice = m_voices[voice_index];
+    (voice.m_older != no_voice ? m_voices[voice.m_older].m_newer : m_oldest_voice) = voice.m_newer;
+    (voice.m_newer != no_voice ? m_voices[voice.m_newer].m_older : m_newest_voice) = voice.m_older;
+    voice.m_older = no_voice;
+    voice.m_newer = no_voice;
+}
+
+template <FloatingPt T, size_t BUFFER_SIZE, size_t NUM_VOICES>
+    requires(is_bounded_pow_two(BUFFER_SIZE) && NUM_VOICES > 0)
+void VoiceManager<T, BUFFER_SIZE, NUM_VOICES>::free_voice(const size_t voice_index) noexcept
+{
+    unlink(voice_index);
+    Voice& voice = m_voices[voice_index];
+    if (m_note_to_voice[voice.m_note] == voice_index)
+    {
+        m_note_to_voice[voice.m_note] = no_voice;
+    }
+    voice.m_gain = 0;
+    voice.m_gain_step = 0;
+    m_idle_voices[m_num_idle_voices++] = voice_index;
+}
+} // namespace LBTS::Spectral
@@ -1,6 +1,12 @@
+#include "test/SpctAnalysisFileTest.h"
 #include "test/SpctArraySliceTest.h"
 #include "test/SpctBufferManagerTest.h"
+#include "test/SpctControlPanelTest.h"
 #include "test/SpctDomainSpecificTest.h"
+#include "test/SpctFourierTransformTest.h"
+#include "test/SpctIfftResynthTest.h"
+#include "test/SpctMultiChannelTest.h"
+#include "test/SpctVoiceManagerTest.h"
 #include "test/SpctWTTest.h"
 
 int main()
@@ -8,6 +14,25 @@ int main()
     using namespace LBTS::Spectral;
     test_array_slice();
     test_buffer_manager();
+    test_analysis_framing();
+    test_runtime_fft_size();
+    test_async_analysis();
+    test_incremental_analysis();
+    test_host_block_sizes();
+    test_offline_render();
+    test_analysis_file();
+    test_stage_profiler();
+    test_silence_and_denormals();
+    test_staggered_frames();
+    test_control_panel();
     test_domain_specific_functions_and_values();
+    test_fourier_transform();
     test_wavetable_creation();
+    test_oscillator_bank();
+    test_smooth_retuning();
+    test_ifft_resynthesis();
+    test_mip_mapped_wavetables();
+    test_wavetable_interpolation();
+    test_voice_manager();
+    test_multi_channel_processor();
 }
@@ -0,0 +1,194 @@
+/**
+ * Author: Lucas Scheidt
+ * Date: 14.10.26
+ *
+ * Description: Cached analyses have to come back the way they were stored, playing them has to sound like the render
+ * that recorded them.
+ *
+ */
+
+#pragma once
+#include "SpctAnalysisFile.h"
+#include "SpctOfflineRenderer.h"
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace LBTS::Spectral;
+
+inline void test_analysis_file()
+{
+    std::cout << "Testing the analysis file..." << std::endl;
+    // every half precision value survives the round trip, the rest rounds to the nearest one.
+    for (uint32_t half = 0; half <= 0xFFFF; ++half)
+    {
+        if ((half & 0x7C00U) != 0x7C00U || (half & 0x3FFU) == 0)
+        {
+            assert(float_to_half_bits(half_bits_to_float(static_cast<uint16_t>(half))) == half);
+        }
+    }
+    assert(float_to_half_bits(1.0f) == 0x3C00);
+    assert(float_to_half_bits(65504.0f) == 0x7BFF);
+    assert(float_to_half_bits(65520.0f) == 0x7C00);
+    assert(float_to_half_bits(0x1p-24f) == 0x0001);
+    assert(float_to_half_bits(1e-9f) == 0);
+    // ties to even
+    assert(float_to_half_bits(1.0f + 0x1p-11f) == 0x3C00);
+    assert(float_to_half_bits(1.0f + 3 * 0x1p-11f) == 0x3C02);
+    assert(std::isnan(half_bits_to_float(float_to_half_bits(std::nanf("")))));
+    assert(bin_fraction_bits(1024) == 23);
+
+    constexpr auto one_twenty_four = BoundedPowTwo_v<size_t, 1024>;
+    const auto path = (std::filesystem::temp_directory_path() / "spct_analysis_test.spct").string();
+
+    // frames that are exactly representable, the playback has to retune on the same grid as a direct retune.
+    constexpr size_t hop_size = 256;
+    constexpr size_t num_frames = 12;
+    auto frames = std::make_unique<std::vector<PeakArr<double, 512>>>(num_frames);
+    {
+        AnalysisFileWriter writer{path};
+        writer.begin({.m_fft_size = 1024,
+                      .m_hop_size = hop_size,
+                      .m_max_entries = 3,
+                      .m_first_frame_end = 100,
+                      .m_sampling_freq = 44100.0});
+        for (size_t frame = 0; frame < num_frames; ++frame)
+        {
+            auto& peaks = (*frames)[frame];
+            peaks.set(0, 10.0 + static_cast<double>(frame) / 128.0, 256.0);
+            peaks.set(1, 55.5, 64.0 + static_cast<double>(frame));
+            peaks.set(2, 300.25, 12.0);
+            // beyond max_entries, dropped
+            peaks.set(3, 400.0, 100.0);
+            writer.append_frame(peaks, frame % 3 == 2 ? 2 : 4);
+        }
+        assert(writer.num_frames() == num_frames);
+    }
+    {
+        const MappedAnalysisFile file{path};
+        assert(file.num_frames() == num_frames && file.format().m_hop_size == hop_size);
+        assert(file.frame(2).size() == 2 && file.frame(3).size() == 3);
+        PeakArr<double, 512> loaded{};
+        for (size_t frame = 0; frame < num_frames; ++frame)
+        {
+            const size_t valid_entries = file.load_frame(frame, loaded);
+            assert(valid_entries == (frame % 3 == 2 ? 2 : 3));
+            const auto& peaks = (*frames)[frame];
+            assert(std::equal(loaded.m_bins.begin(), loaded.m_bins.begin() + valid_entries, peaks.m_bins.begin()));
+            assert(std::equal(loaded.m_magnitudes.begin(),
+                              loaded.m_magnitudes.begin() + valid_entries,
+                              peaks.m_magnitudes.begin()));
+        }
+        auto playback = std::make_unique<AnalysisPlayback<double, one_twenty_four>>(file);
+        auto oscillators = std::make_unique<ResynthOscs<double, 512, one_twenty_four, 512>>(44100.0);
+        oscillators->set_partial_count(3);
+        std::vector<double> played(100 + (num_frames + 1) * hop_size);
+        std::vector<double> expected(played.size());
+        // odd blocks, the frames are retuned on the grid of the analysis anyway.
+        for (size_t offset = 0; offset < played.size(); offset += 77)
+        {
+            playback->process(played.data() + offset, std::min<size_t>(77, played.size() - offset));
+        }
+        for (size_t frame = 0, offset = 0; offset < expected.size(); ++frame)
+        {
+            const size_t segment_size = std::min(frame == 0 ? 100 : hop_size, expected.size() - offset);
+            oscillators->process(expected.data() + offset, segment_size);
+            offset += segment_size;
+            if (frame < num_frames)
+            {
+                oscillators->tune_oscillators((*frames)[frame], frame % 3 == 2 ? 2 : 3);
+            }
+        }
+        assert(played == expected);
+        assert(playback->next_frame() == num_frames);
+        playback->seek(4);
+        assert(playback->next_frame() == 4);
+    }
+
+    // a recorded render played back, the half precision magnitudes are the only audible difference.
+    constexpr size_t num_samples = 44100;
+    std::vector<double> signal(num_samples);
+    for (size_t index = 0; index < num_samples; ++index)
+    {
+        const double time = static_cast<double>(index) / 44100.0;
+        signal[index] = 0.6 * std::sin(two_pi<double> * 330.0 * time) + 0.2 * std::sin(two_pi<double> * 1250.0 * time);
+    }
+    BufferManager<double, one_twenty_four> buffer_manager{44100.0};
+    buffer_manager.select_hop_size(HopSize::QUARTER);
+    buffer_manager.select_analysis_window(AnalysisWindow::HANN);
+    buffer_manager.select_partial_count(16);
+    auto rendered = signal;
+    {
+        OfflineRenderer<double, one_twenty_four> renderer{2};
+        AnalysisFileWriter writer{path};
+        renderer.render(buffer_manager, rendered.data(), num_samples / 2, 1.0, &writer);
+        renderer.render(buffer_manager, rendered.data() + num_samples / 2, num_samples / 2, 1.0, &writer);
+        assert(writer.num_frames() == num_samples / hop_size);
+        assert(writer.format().m_max_entries == 16);
+    }
+    {
+        const MappedAnalysisFile file{path};
+        auto playback = std::make_unique<AnalysisPlayback<double, one_twenty_four>>(file);
+        std::vector<double> played(num_samples);
+        playback->process(played.data(), played.size());
+        double error_energy = 0.0;
+        double energy = 0.0;
+        for (size_t index = 0; index < num_samples; ++index)
+        {
+            error_energy += (played[index] - rendered[index]) * (played[index] - rendered[index]);
+            energy += rendered[index] * rendered[index];
+        }
+        assert(energy > 0.0);
+        assert(error_energy < 1e-6 * energy);
+    }
+
+    // anything that isn't a complete analysis file of this version is refused.
+    const auto refused = [&path]
+    {
+        try
+        {
+            const MappedAnalysisFile file{path};
+        }
+        catch (const std::runtime_error&)
+        {
+            return true;
+        }
+        return false;
+    };
+    // counts in the header that would wrap the size computations around (a frame table of 2^64 byte = 0 byte).
+    std::vector<char> valid_file(std::filesystem::file_size(path));
+    std::ifstream{path, std::ios::binary}.read(valid_file.data(), static_cast<std::streamsize>(valid_file.size()));
+    const auto write_corrupted = [&path, &valid_file](const size_t field_offset, const uint64_t value)
+    {
+        auto corrupted = valid_file;
+        std::memcpy(corrupted.data() + field_offset, &value, sizeof(value));
+        std::ofstream{path, std::ios::binary}.write(corrupted.data(), static_cast<std::streamsize>(corrupted.size()));
+    };
+    write_corrupted(offsetof(AnalysisFileHeader, m_num_frames), (uint64_t{1} << 61) - 1);
+    assert(refused());
+    write_corrupted(offsetof(AnalysisFileHeader, m_num_peaks), 0xAAAAAAAAAAAAAAABULL);
+    assert(refused());
+    write_corrupted(offsetof(AnalysisFileHeader, m_frame_table_offset), ~uint64_t{7});
+    assert(refused());
+    // a header cut off in the middle
+    std::ofstream{path, std::ios::binary}.write(valid_file.data(), sizeof(AnalysisFileHeader) / 2);
+    assert(refused());
+    std::ofstream{path, std::ios::binary}.write(valid_file.data(), static_cast<std::streamsize>(valid_file.size()));
+    {
+        const MappedAnalysisFile restored_file{path};
+    }
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 8);
+    assert(refused());
+    std::ofstream{path, std::ios::binary} << "SPCTANLX" << std::string(sizeof(AnalysisFileHeader), '\0');
+    assert(refused());
+    std::filesystem::remove(path);
+    assert(refused());
+    std::cout << "Test passed." << std::endl;
+}
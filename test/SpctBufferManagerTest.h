@@ -7,8 +7,17 @@
  */
 
 #pragma once
+#include "SpctAnalysisFile.h"
 #include "SpctBufferManager.h"
+#include "SpctOfflineRenderer.h"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
 #include <fstream>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <vector>
 
 static void dummy_fill(double* t_arr, const size_t t_arr_size)
 {
@@ -32,29 +41,36 @@ inline void test_buffer_manager()
     // l_buffer.process_daw_chunk(l_array, five_twelve);
 
     BufferManager<double> xl_buffer;
-    std::ofstream txt_file_with_raw_sine{"raw_sine_values.txt"};
     double xl_array[one_twenty_four];
     for (size_t i = 0; i < one_twenty_four; ++i)
     {
         xl_array[i] = 0.3 * std::sin(6 * 2 * M_PI * static_cast<double>(i) / one_twenty_four) +
                       0.65 * std::sin(16 * 2 * M_PI * static_cast<double>(i) / one_twenty_four) +
                       0.9 * std::sin(10 * 2 * M_PI * static_cast<double>(i) / one_twenty_four);
-        txt_file_with_raw_sine << xl_array[i] << std::endl;
     }
+    // raw doubles and the analysed frames for Visualizations/check_outputs.py (np.fromfile / np.memmap).
+    std::ofstream{"raw_sine_values.f64", std::ios::binary}.write(reinterpret_cast<const char*>(xl_array),
+                                                                 sizeof(xl_array));
+    AnalysisFileWriter analysis_file{"analysed_frames.spct"};
+    analysis_file.begin({.m_fft_size = one_twenty_four,
+                         .m_hop_size = one_twenty_four,
+                         .m_max_entries = static_cast<uint32_t>(xl_buffer.partial_count()),
+                         .m_first_frame_end = one_twenty_four,
+                         .m_sampling_freq = xl_buffer.sampling_freq()});
     auto now = std::chrono::system_clock::now();
     xl_buffer.process_daw_chunk(xl_array, one_twenty_four, 1);
 
     auto end = std::chrono::system_clock::now();
+    analysis_file.append_frame(xl_buffer.peaks(), xl_buffer.valid_entries());
     std::cout << "Base case algorithm took " << std::chrono::duration_cast<std::chrono::microseconds>(end - now).count()
               << " µs." << std::endl;
 
     // advance one iteration to get the first calculated output
     xl_buffer.process_daw_chunk(xl_array, one_twenty_four, 1);
-    std::ofstream txt_file_resynthesized{"resynthesized_values.txt"};
-    for (double i : xl_array)
-    {
-        txt_file_resynthesized << i << std::endl;
-    }
+    analysis_file.append_frame(xl_buffer.peaks(), xl_buffer.valid_entries());
+    analysis_file.finish();
+    std::ofstream{"resynthesized_values.f64", std::ios::binary}.write(reinterpret_cast<const char*>(xl_array),
+                                                                      sizeof(xl_array));
 
     double rising_value = 1.01;
     for (double& element : xl_array)
@@ -88,4 +104,600 @@ inline void test_buffer_manager()
     double xxl_array[two_fourty_eight];
     xxl_buffer.process_daw_chunk(xxl_array, two_fourty_eight);
     std::cout << "Test passed." << std::endl;
-}
\ No newline at end of file
+}
+
+inline void test_analysis_framing()
+{
+    std::cout << "Testing overlapping analysis frames..." << std::endl;
+    // the hop decides how often a frame is signaled, FULL is the wrap of the buffer.
+    CircularSampleBuffer<double, 16> ring_buffer{};
+    ring_buffer.set_hop_size(HopSize::QUARTER);
+    assert(ring_buffer.hop_size() == 4);
+    size_t signaled_frames = 0;
+    for (size_t sample = 0; sample < 32; ++sample)
+    {
+        ring_buffer.fill_input(1.0);
+        signaled_frames += ring_buffer.advance() ? 1 : 0;
+    }
+    assert(signaled_frames == 8);
+
+    // the bulk copy signals the frame at the end of a span, also across the wrap.
+    const std::array<double, 16> span{};
+    assert(!ring_buffer.fill_span(span.data(), 3) && ring_buffer.current_index() == 3);
+    assert(ring_buffer.fill_span(span.data(), 1) && ring_buffer.samples_to_next_frame() == 4);
+    assert(!ring_buffer.fill_span(span.data(), 10) && ring_buffer.current_index() == 14);
+    assert(ring_buffer.fill_span(nullptr, 6) && ring_buffer.current_index() == 4);
+    ring_buffer.set_hop_size(HopSize::FULL);
+    assert(ring_buffer.hop_size() == 16);
+
+    // windows are periodic and normalized to a coherent gain of one
+    constexpr auto& hann = AnalysisWindowTable_v<double, 1024, AnalysisWindow::HANN>;
+    constexpr auto& blackman = AnalysisWindowTable_v<float, 1024, AnalysisWindow::BLACKMAN>;
+    static_assert(hann[0] == 0.0);
+    static_assert(AnalysisWindowTable_v<double, 16, AnalysisWindow::RECTANGULAR>[7] == 1.0);
+    double hann_sum = 0;
+    double blackman_sum = 0;
+    for (size_t index = 0; index < hann.size(); ++index)
+    {
+        hann_sum += hann[index];
+        blackman_sum += blackman[index];
+        assert(std::abs(hann[index] - hann[(hann.size() - index) & (hann.size() - 1)]) < 1e-12);
+    }
+    assert(std::abs(hann_sum - 1024) < 1e-9);
+    assert(std::abs(blackman_sum - 1024) < 1e-2);
+    assert(std::abs(hann[512] - 2.0) < 1e-12);
+
+    // with a quarter hop the oscillators start to play after a quarter of the buffer, with a full hop after the whole.
+    constexpr auto one_twenty_four = BoundedPowTwo_v<size_t, 1024>;
+    BufferManager<double, one_twenty_four> full_hop{};
+    BufferManager<double, one_twenty_four> quarter_hop{};
+    quarter_hop.select_hop_size(HopSize::QUARTER);
+    quarter_hop.select_analysis_window(AnalysisWindow::HANN);
+    std::array<double, one_twenty_four / 2> full_chunk{};
+    std::array<double, one_twenty_four / 2> quarter_chunk{};
+    for (size_t index = 0; index < full_chunk.size(); ++index)
+    {
+        full_chunk[index] = 0.9 * std::sin(10 * 2 * M_PI * static_cast<double>(index) / one_twenty_four);
+    }
+    quarter_chunk = full_chunk;
+    full_hop.process_daw_chunk(full_chunk.data(), full_chunk.size());
+    quarter_hop.process_daw_chunk(quarter_chunk.data(), quarter_chunk.size());
+    assert(std::ranges::all_of(full_chunk, [](const double value) { return value == 0.0; }));
+    assert(std::ranges::any_of(quarter_chunk, [](const double value) { return value != 0.0; }));
+    std::cout << "Test passed." << std::endl;
+}
+
+inline void test_runtime_fft_size()
+{
+    std::cout << "Testing runtime FFT sizes..." << std::endl;
+    constexpr auto five_twelve = BoundedPowTwo_v<size_t, 512>;
+    BufferManager<double, BoundedPowTwo_v<size_t, 2048>> resizable{44100.0};
+    assert(resizable.fft_size() == 2048);
+    resizable.select_fft_size(4);
+    assert(resizable.fft_size() == 16);
+    resizable.select_fft_size(3000);
+    assert(resizable.fft_size() == 2048);
+    resizable.select_fft_size(1000);
+    assert(resizable.fft_size() == five_twelve);
+
+    // a resized instance has to behave exactly like an instance of that size.
+    BufferManager<double, five_twelve> fixed{44100.0};
+    resizable.select_hop_size(HopSize::HALF);
+    fixed.select_hop_size(HopSize::HALF);
+    resizable.select_analysis_window(AnalysisWindow::HANN);
+    fixed.select_analysis_window(AnalysisWindow::HANN);
+    std::array<double, 3 * five_twelve> resizable_chunk{};
+    for (size_t index = 0; index < resizable_chunk.size(); ++index)
+    {
+        resizable_chunk[index] = 0.8 * std::sin(two_pi<double> * 440.0 * static_cast<double>(index) / 44100.0);
+    }
+    auto fixed_chunk = resizable_chunk;
+    resizable.process_daw_chunk(resizable_chunk.data(), resizable_chunk.size());
+    fixed.process_daw_chunk(fixed_chunk.data(), fixed_chunk.size());
+    assert(resizable_chunk == fixed_chunk);
+    assert(std::ranges::any_of(resizable_chunk, [](const double value) { return value != 0.0; }));
+
+    BufferManager<float, BoundedPowTwo_v<size_t, 1024>> small{48000.0, 64};
+    assert(small.fft_size() == 64);
+    std::array<float, 256> small_chunk{};
+    small_chunk.fill(0.5f);
+    small.process_daw_chunk(small_chunk.data(), small_chunk.size());
+    std::cout << "Test passed." << std::endl;
+}
+
+inline void test_async_analysis()
+{
+    std::cout << "Testing the asynchronous analysis..." << std::endl;
+    constexpr auto five_twelve = BoundedPowTwo_v<size_t, 512>;
+    BufferManager<double, BoundedPowTwo_v<size_t, 1024>> sync_bm{44100.0, five_twelve};
+    BufferManager<double, BoundedPowTwo_v<size_t, 1024>> async_bm{44100.0, five_twelve};
+    sync_bm.select_hop_size(HopSize::HALF);
+    async_bm.select_hop_size(HopSize::HALF);
+    assert(!async_bm.async_analysis() && async_bm.analysis_latency() == 0);
+    async_bm.enable_async_analysis(true);
+    assert(async_bm.async_analysis());
+    assert(async_bm.analysis_latency() == (five_twelve >> 1));
+
+    // the asynchronous instance plays the peaks of every frame exactly one hop later.
+    std::array<double, (five_twelve >> 1)> sync_chunk{};
+    std::array<double, (five_twelve >> 1)> async_chunk{};
+    PeakArr<double, decltype(sync_bm)::partial_capacity> previous_peaks{};
+    size_t previous_entries = 0;
+    size_t sample_index = 0;
+    for (size_t hop = 0; hop < 12; ++hop)
+    {
+        for (size_t index = 0; index < sync_chunk.size(); ++index, ++sample_index)
+        {
+            sync_chunk[index] = 0.5 * std::sin(two_pi<double> * 1000.0 * static_cast<double>(sample_index) / 44100.0) +
+                                0.25 * std::sin(two_pi<double> * 3100.0 * static_cast<double>(sample_index) / 44100.0);
+        }
+        async_chunk = sync_chunk;
+        sync_bm.process_daw_chunk(sync_chunk.data(), sync_chunk.size());
+        async_bm.process_daw_chunk(async_chunk.data(), async_chunk.size());
+        async_bm.wait_for_analysis();
+        if (hop > 0)
+        {
+            assert(async_bm.valid_entries() == previous_entries);
+            const auto& peaks = async_bm.peaks();
+            assert(std::equal(previous_peaks.m_bins.begin(),
+                              previous_peaks.m_bins.begin() + static_cast<std::ptrdiff_t>(previous_entries),
+                              peaks.m_bins.begin()));
+            assert(std::equal(previous_peaks.m_magnitudes.begin(),
+                              previous_peaks.m_magnitudes.begin() + static_cast<std::ptrdiff_t>(previous_entries),
+                              peaks.m_magnitudes.begin()));
+        }
+        previous_peaks = sync_bm.peaks();
+        previous_entries = sync_bm.valid_entries();
+    }
+    assert(previous_entries > 0);
+    assert(std::ranges::any_of(async_chunk, [](const double value) { return value != 0.0; }));
+
+    // results of the old size get dropped after a size change.
+    async_bm.select_fft_size(BoundedPowTwo_v<size_t, 256>);
+    async_bm.process_daw_chunk(async_chunk.data(), async_chunk.size());
+    async_bm.wait_for_analysis();
+    async_bm.enable_async_analysis(false);
+    assert(!async_bm.async_analysis());
+    async_bm.process_daw_chunk(async_chunk.data(), async_chunk.size());
+    std::cout << "Test passed." << std::endl;
+}
+
+inline void test_incremental_analysis()
+{
+    std::cout << "Testing the incremental analysis..." << std::endl;
+    constexpr auto five_twelve = BoundedPowTwo_v<size_t, 512>;
+    constexpr size_t daw_buffer_size = 64;
+    BufferManager<double, BoundedPowTwo_v<size_t, 1024>> sync_bm{44100.0, five_twelve};
+    BufferManager<double, BoundedPowTwo_v<size_t, 1024>> incremental_bm{44100.0, five_twelve};
+    sync_bm.select_hop_size(HopSize::HALF);
+    incremental_bm.select_hop_size(HopSize::HALF);
+    incremental_bm.select_analysis_window(AnalysisWindow::HANN);
+    sync_bm.select_analysis_window(AnalysisWindow::HANN);
+    incremental_bm.enable_incremental_analysis(true);
+    assert(incremental_bm.incremental_analysis() && !incremental_bm.async_analysis());
+    assert(incremental_bm.analysis_latency() == (five_twelve >> 1));
+
+    // the steps of a frame are spread over the small callbacks of the next hop, the result is the same as the one of
+    // the synchronous analysis, one hop later.
+    std::array<double, daw_buffer_size> sync_chunk{};
+    std::array<double, daw_buffer_size> incremental_chunk{};
+    PeakArr<double, decltype(sync_bm)::partial_capacity> previous_peaks{};
+    size_t previous_entries = 0;
+    size_t sample_index = 0;
+    for (size_t hop = 0; hop < 10; ++hop)
+    {
+        for (size_t chunk = 0; chunk < (five_twelve >> 1) / daw_buffer_size; ++chunk)
+        {
+            for (size_t index = 0; index < daw_buffer_size; ++index, ++sample_index)
+            {
+                sync_chunk[index] = 0.5 * std::sin(two_pi<double> * 700.0 * static_cast<double>(sample_index) / 44100.0) +
+                                    0.3 * std::sin(two_pi<double> * 2900.0 * static_cast<double>(sample_index) / 44100.0);
+            }
+            incremental_chunk = sync_chunk;
+            sync_bm.process_daw_chunk(sync_chunk.data(), sync_chunk.size());
+            incremental_bm.process_daw_chunk(incremental_chunk.data(), incremental_chunk.size());
+        }
+        if (hop > 0)
+        {
+            assert(incremental_bm.valid_entries() == previous_entries);
+            const auto& peaks = incremental_bm.peaks();
+            assert(std::equal(previous_peaks.m_bins.begin(),
+                              previous_peaks.m_bins.begin() + static_cast<std::ptrdiff_t>(previous_entries),
+                              peaks.m_bins.begin()));
+            assert(std::equal(previous_peaks.m_magnitudes.begin(),
+                              previous_peaks.m_magnitudes.begin() + static_cast<std::ptrdiff_t>(previous_entries),
+                              peaks.m_magnitudes.begin()));
+        }
+        previous_peaks = sync_bm.peaks();
+        previous_entries = sync_bm.valid_entries();
+    }
+    assert(previous_entries > 0);
+    assert(std::ranges::any_of(incremental_chunk, [](const double value) { return value != 0.0; }));
+
+    // begin_analysis only remembers the frame. Once the part that is about to be overwritten got packed, the ring
+    // buffer may change there, the result is still the one of the whole analysis.
+    auto frame_kernel = std::make_unique<FrameKernel<double, 9>>();
+    std::array<double, five_twelve> ring{};
+    for (size_t index = 0; index < ring.size(); ++index)
+    {
+        ring[index] = 0.5 * std::sin(two_pi<double> * 1300.0 * static_cast<double>(index) / 44100.0);
+    }
+    constexpr size_t oldest_index = 100;
+    PeakArr<double, 64> reference_peaks{};
+    const size_t reference_entries =
+        frame_kernel->analyse(ring, oldest_index, AnalysisWindow::HANN, reference_peaks, 1.0, 64);
+    assert(reference_entries > 0);
+    frame_kernel->begin_analysis(ring, oldest_index, AnalysisWindow::HANN, 1.0, 64);
+    frame_kernel->pack_frame_until(daw_buffer_size);
+    std::fill_n(ring.begin() + oldest_index, daw_buffer_size, 99.0);
+    PeakArr<double, 64> stepped_peaks{};
+    size_t stepped_entries = 0;
+    size_t num_steps = 0;
+    for (; frame_kernel->analysis_pending(); ++num_steps)
+    {
+        frame_kernel->analysis_step(stepped_peaks, stepped_entries);
+    }
+    assert((num_steps == FrameKernel<double, 9>::num_analysis_steps));
+    assert(stepped_entries == reference_entries);
+    assert(std::equal(reference_peaks.m_bins.begin(),
+                      reference_peaks.m_bins.begin() + static_cast<std::ptrdiff_t>(reference_entries),
+                      stepped_peaks.m_bins.begin()));
+
+    // a hop size that shrinks in the middle of a frame leaves more steps than a boundary catches up, that frame is
+    // dropped and the next ones are analysed again.
+    for (size_t chunk = 0; chunk < 3; ++chunk, sample_index += daw_buffer_size)
+    {
+        incremental_chunk.fill(0.0);
+        incremental_bm.process_daw_chunk(incremental_chunk.data(), incremental_chunk.size());
+    }
+    incremental_bm.select_hop_size(HopSize::EIGHTH);
+    for (size_t chunk = 0; chunk < 8; ++chunk)
+    {
+        for (size_t index = 0; index < daw_buffer_size; ++index, ++sample_index)
+        {
+            incremental_chunk[index] =
+                0.5 * std::sin(two_pi<double> * 700.0 * static_cast<double>(sample_index) / 44100.0);
+        }
+        incremental_bm.process_daw_chunk(incremental_chunk.data(), incremental_chunk.size());
+    }
+    assert(incremental_bm.valid_entries() > 0);
+
+    // switching to the asynchronous mode ends the incremental one.
+    incremental_bm.enable_async_analysis(true);
+    assert(!incremental_bm.incremental_analysis() && incremental_bm.async_analysis());
+    incremental_bm.enable_incremental_analysis(true);
+    assert(incremental_bm.incremental_analysis() && !incremental_bm.async_analysis());
+    std::cout << "Test passed." << std::endl;
+}
+
+inline void test_host_block_sizes()
+{
+    std::cout << "Testing arbitrary host block sizes..." << std::endl;
+    // a large block spans several frames, every one of them has to be analysed. Feeding the same signal sample by
+    // sample (one frame at most per call) has to give exactly the same output.
+    constexpr auto one_twenty_four = BoundedPowTwo_v<size_t, 1024>;
+    constexpr size_t offline_block_size = 4096;
+    constexpr size_t num_samples = 3 * offline_block_size;
+    std::vector<double> signal(num_samples);
+    for (size_t index = 0; index < num_samples; ++index)
+    {
+        // the pitch changes with every frame, so a skipped frame changes the output.
+        const double time = static_cast<double>(index) / 44100.0;
+        signal[index] = 0.7 * std::sin(two_pi<double> * (200.0 + 0.05 * static_cast<double>(index)) * time);
+    }
+    const auto render = [&signal](const auto& next_block_size, const bool smooth_retuning = false)
+    {
+        BufferManager<double, one_twenty_four> buffer_manager{44100.0};
+        buffer_manager.select_hop_size(HopSize::QUARTER);
+        buffer_manager.enable_smooth_retuning(smooth_retuning);
+        buffer_manager.select_analysis_window(AnalysisWindow::HANN);
+        auto output = signal;
+        for (size_t block = 0, offset = 0; offset < output.size(); ++block)
+        {
+            const size_t block_size = std::min(next_block_size(block), output.size() - offset);
+            buffer_manager.process_daw_chunk(output.data() + offset, block_size);
+            offset += block_size;
+        }
+        return output;
+    };
+    const auto sample_by_sample = render([](const size_t) { return size_t{1}; });
+    const auto offline_blocks = render([](const size_t) { return offline_block_size; });
+    // variable and non power of two sizes
+    const auto variable_blocks = render(
+        [](const size_t block)
+        {
+            constexpr std::array<size_t, 7> block_sizes{37, 500, 1, 4096, 1023, 3, 2500};
+            return block_sizes[block % block_sizes.size()];
+        });
+    assert(std::ranges::any_of(sample_by_sample, [](const double value) { return value != 0.0; }));
+    assert(offline_blocks == sample_by_sample);
+    assert(variable_blocks == sample_by_sample);
+    // the ramps of the smooth retuning run per sample as well.
+    const auto smooth_sample_by_sample = render([](const size_t) { return size_t{1}; }, true);
+    assert(smooth_sample_by_sample != sample_by_sample);
+    assert(render([](const size_t) { return offline_block_size; }, true) == smooth_sample_by_sample);
+    std::cout << "Test passed." << std::endl;
+}
+
+inline void test_offline_render()
+{
+    std::cout << "Testing the offline render..." << std::endl;
+    // more frames than fit into one batch, the last batch ends between two frames.
+    constexpr auto one_twenty_four = BoundedPowTwo_v<size_t, 1024>;
+    constexpr size_t num_samples = 70001;
+    constexpr size_t streamed_before = 777;
+    constexpr size_t streamed_after = 1500;
+    std::vector<double> signal(num_samples);
+    for (size_t index = 0; index < num_samples; ++index)
+    {
+        const double time = static_cast<double>(index) / 44100.0;
+        signal[index] = 0.7 * std::sin(two_pi<double> * (200.0 + 0.01 * static_cast<double>(index)) * time);
+    }
+    const auto configure = [](BufferManager<double, one_twenty_four>& buffer_manager, const ResynthesisEngine engine)
+    {
+        buffer_manager.select_hop_size(HopSize::QUARTER);
+        buffer_manager.select_analysis_window(AnalysisWindow::HANN);
+        buffer_manager.enable_smooth_retuning(true);
+        buffer_manager.select_resynthesis_engine(engine);
+    };
+    for (const auto engine : {ResynthesisEngine::OSCILLATOR_BANK, ResynthesisEngine::INVERSE_FFT})
+    {
+        BufferManager<double, one_twenty_four> streamed_bm{44100.0};
+        configure(streamed_bm, engine);
+        auto streamed = signal;
+        streamed_bm.process_daw_chunk(streamed.data(), streamed.size());
+        assert(std::ranges::any_of(streamed, [](const double value) { return value != 0.0; }));
+        for (const size_t num_threads : {1, 2, 5})
+        {
+            // streaming before and after the render continues the same state.
+            BufferManager<double, one_twenty_four> offline_bm{44100.0};
+            configure(offline_bm, engine);
+            OfflineRenderer<double, one_twenty_four> renderer{num_threads};
+            assert(renderer.num_threads() == num_threads);
+            auto rendered = signal;
+            offline_bm.process_daw_chunk(rendered.data(), streamed_before);
+            renderer.render(offline_bm, rendered.data() + streamed_before,
+                            num_samples - streamed_before - streamed_after);
+            offline_bm.process_daw_chunk(rendered.data() + num_samples - streamed_after, streamed_after);
+            assert(rendered == streamed);
+            assert(offline_bm.ring_buffer_index() == streamed_bm.ring_buffer_index());
+        }
+    }
+    std::cout << "Test passed." << std::endl;
+}
+
+inline void test_stage_profiler()
+{
+    std::cout << "Testing the stage profiler..." << std::endl;
+    // disabled it has to vanish completely.
+    static_assert(std::is_empty_v<StageProfiler<false>>);
+    StageProfiler<true, 4> profiler{};
+    {
+        ScopedStageTimer timer{profiler, ProfileStage::FFT};
+    }
+    profiler.record(ProfileStage::TUNE, 100);
+    profiler.record(ProfileStage::TUNE, 3000);
+    profiler.record(ProfileStage::RENDER, 7);
+    // full, the newest one gets dropped instead of blocking the audio thread.
+    profiler.record(ProfileStage::RENDER, 8);
+    assert(profiler.dropped_samples() == 1);
+    ProfileHistogram histogram{};
+    assert(histogram.drain(profiler) == 4);
+    assert(!profiler.pop().has_value());
+    assert(histogram.statistics(ProfileStage::FFT).m_count == 1);
+    const auto& tune_statistics = histogram.statistics(ProfileStage::TUNE);
+    assert(tune_statistics.m_count == 2 && tune_statistics.m_total_ticks == 3100 && tune_statistics.m_max_ticks == 3000);
+    assert(histogram.percentile_ticks(ProfileStage::TUNE, 0.5) == 127);
+    assert(histogram.percentile_ticks(ProfileStage::TUNE, 1.0) == 3000);
+    assert(histogram.statistics(ProfileStage::RENDER).m_max_ticks == 7);
+    // the top bucket (bit width 64) ends at the largest tick count.
+    constexpr uint64_t huge_ticks = std::numeric_limits<uint64_t>::max() - 1;
+    histogram.add({ProfileStage::FILL, huge_ticks});
+    assert(histogram.statistics(ProfileStage::FILL).m_buckets[ProfileHistogram::num_buckets] == 1);
+    assert(histogram.percentile_ticks(ProfileStage::FILL, 1.0) == huge_ticks);
+
+    // every stage of the synchronous pipeline shows up if profiling is compiled in, nothing otherwise.
+    BufferManager<double, BoundedPowTwo_v<size_t, 1024>> buffer_manager{44100.0};
+    std::vector<double> chunk(4096);
+    dummy_fill(chunk.data(), chunk.size());
+    buffer_manager.process_daw_chunk(chunk.data(), chunk.size());
+    histogram.reset();
+    const size_t num_samples = histogram.drain(buffer_manager.profiler());
+    for (const auto stage :
+         {ProfileStage::FILL, ProfileStage::FFT, ProfileStage::PEAK_SELECT, ProfileStage::TUNE, ProfileStage::RENDER})
+    {
+        assert((histogram.statistics(stage).m_count > 0) == profiling_enabled);
+    }
+    assert((num_samples > 0) == profiling_enabled);
+    std::cout << "Test passed." << std::endl;
+}
+
+inline void test_silence_and_denormals()
+{
+    std::cout << "Testing the silence fast path and the flushing of denormals..." << std::endl;
+    // denormals are flushed within the scope only (volatile, so the compiler can't fold the products).
+    volatile float smallest_normal = std::numeric_limits<float>::min();
+    volatile float half = 0.5F;
+    {
+        const ScopedFlushDenormals flush_denormals{};
+        if constexpr (ScopedFlushDenormals::supported)
+        {
+            assert(smallest_normal * half == 0.0F);
+        }
+    }
+    assert(smallest_normal * half != 0.0F);
+
+    // the bound of is_silent_frame holds for the windows that exceed 1 as well.
+    constexpr size_t fft_size = 1024;
+    std::array<double, fft_size> ring{};
+    ComplexArr<double, (fft_size >> 1)> packed{};
+    for (size_t index = 0; index < fft_size; ++index)
+    {
+        ring[index] = 1e-4 * std::sin(two_pi<double> * 5.0 * static_cast<double>(index) / fft_size);
+    }
+    pack_real_frame<double, 10>(ring, 0, analysis_window_table<double, fft_size>(AnalysisWindow::BLACKMAN), packed);
+    assert(is_silent_frame(packed, 1.0));
+    std::ranges::transform(ring, ring.begin(), [](const double sample) { return sample * 1e4; });
+    pack_real_frame<double, 10>(ring, 0, analysis_window_table<double, fft_size>(AnalysisWindow::BLACKMAN), packed);
+    assert(!is_silent_frame(packed, 1.0));
+
+    // after a tone the silent frames have no peaks and the oscillators fade out, in all analysis modes.
+    for (const bool incremental : {false, true})
+    {
+        BufferManager<double, BoundedPowTwo_v<size_t, fft_size>> buffer_manager{44100.0,
+                                                                                BoundedPowTwo_v<size_t, fft_size>};
+        buffer_manager.select_analysis_window(AnalysisWindow::HANN);
+        buffer_manager.enable_incremental_analysis(incremental);
+        std::array<double, 128> chunk{};
+        size_t sample_index = 0;
+        for (size_t block = 0; block < 24; ++block)
+        {
+            for (auto& sample : chunk)
+            {
+                sample = 0.5 * std::sin(two_pi<double> * 440.0 * static_cast<double>(sample_index++) / 44100.0);
+            }
+            buffer_manager.process_daw_chunk(chunk.data(), chunk.size());
+        }
+        assert(buffer_manager.valid_entries() > 0);
+        for (size_t block = 0; block < 48; ++block)
+        {
+            chunk.fill(0.0);
+            buffer_manager.process_daw_chunk(chunk.data(), chunk.size());
+        }
+        assert(buffer_manager.valid_entries() == 0);
+        assert(std::ranges::all_of(chunk, [](const double sample) { return std::abs(sample) < 1e-9; }));
+    }
+
+    // without smooth retuning (default) the silent frame fades the partials out over the hop instead of cutting them.
+    BufferManager<double, BoundedPowTwo_v<size_t, fft_size>> buffer_manager{44100.0, BoundedPowTwo_v<size_t, fft_size>};
+    assert(!buffer_manager.smooth_retuning());
+    buffer_manager.select_analysis_window(AnalysisWindow::HANN);
+    std::vector<double> output{};
+    std::array<double, 64> chunk{};
+    size_t sample_index = 0;
+    for (size_t block = 0; block < 96; ++block)
+    {
+        for (auto& sample : chunk)
+        {
+            // the tone ends with the second frame, the third frame (ending at 3 * fft_size) is silent.
+            sample = sample_index < 2 * fft_size
+                         ? 0.5 * std::sin(two_pi<double> * 440.0 * static_cast<double>(sample_index) / 44100.0)
+                         : 0.0;
+            ++sample_index;
+        }
+        buffer_manager.process_daw_chunk(chunk.data(), chunk.size());
+        output.insert(output.end(), chunk.begin(), chunk.end());
+    }
+    const auto chunk_peak = [&output](const size_t start)
+    {
+        return std::abs(*std::ranges::max_element(output.begin() + static_cast<std::ptrdiff_t>(start),
+                                                  output.begin() + static_cast<std::ptrdiff_t>(start + 64),
+                                                  {},
+                                                  [](const double sample) { return std::abs(sample); }));
+    };
+    const size_t silent_frame_end = 3 * fft_size;
+    const double level_before = chunk_peak(silent_frame_end - 64);
+    assert(level_before > 0.01);
+    // no step at the frame boundary, the level falls from chunk to chunk and is gone one hop later.
+    assert(chunk_peak(silent_frame_end) > 0.8 * level_before);
+    for (size_t start = silent_frame_end + 64; start < silent_frame_end + fft_size; start += 64)
+    {
+        assert(chunk_peak(start) <= chunk_peak(start - 64) * 1.01);
+    }
+    assert(chunk_peak(silent_frame_end + fft_size - 64) < 0.1 * level_before);
+    assert(std::all_of(output.begin() + static_cast<std::ptrdiff_t>(silent_frame_end + fft_size),
+                       output.end(),
+                       [](const double sample) { return sample == 0.0; }));
+    std::cout << "Test passed." << std::endl;
+}
+
+/// @brief Counts the frames that completed, instead of rendering them.
+struct FrameCounter
+{
+    void process(double* /*output*/, const size_t /*num_samples*/) noexcept {}
+    template <size_t CAPACITY>
+    void tune_oscillators(const PeakArr<double, CAPACITY>& /*peaks*/, const size_t /*valid_entries*/) noexcept
+    {
+        ++m_frames;
+    }
+    size_t m_frames = 0;
+};
+
+inline void test_staggered_frames()
+{
+    std::cout << "Testing the staggered frames of several instances..." << std::endl;
+    static_assert(FramePhaseScheduler::phase_of_slot(0) == 0.0 && FramePhaseScheduler::phase_of_slot(1) == 0.5);
+    static_assert(FramePhaseScheduler::phase_of_slot(2) == 0.25 && FramePhaseScheduler::phase_of_slot(3) == 0.75);
+
+    // a phase of a half moves the boundaries of a hop of 4 by 2 samples, the phase survives a new hop size.
+    CircularSampleBuffer<double, 16> ring_buffer{};
+    ring_buffer.set_hop_size(HopSize::QUARTER);
+    ring_buffer.set_frame_phase(0.5);
+    assert(ring_buffer.samples_to_next_frame() == 2);
+    assert(ring_buffer.fill_span(nullptr, 2) && ring_buffer.samples_to_next_frame() == 4);
+    ring_buffer.set_hop_size(HopSize::HALF);
+    assert(ring_buffer.frame_phase() == 0.5 && ring_buffer.samples_to_next_frame() == 2);
+
+    // every instance gets its own phase, freed slots are reused.
+    constexpr size_t num_instances = 4;
+    constexpr auto fft_size = BoundedPowTwo_v<size_t, 1024>;
+    std::vector<std::unique_ptr<BufferManager<double, fft_size>>> instances{};
+    for (size_t instance = 0; instance < num_instances; ++instance)
+    {
+        instances.push_back(std::make_unique<BufferManager<double, fft_size>>(44100.0, fft_size));
+        instances.back()->select_hop_size(HopSize::HALF);
+    }
+    const size_t occupied_before = FramePhaseScheduler::num_occupied_slots();
+    for (auto& instance : instances)
+    {
+        instance->enable_staggered_frames(true);
+        assert(instance->staggered_frames());
+    }
+    assert(FramePhaseScheduler::num_occupied_slots() == occupied_before + num_instances);
+    for (size_t first = 0; first < num_instances; ++first)
+    {
+        for (size_t second = first + 1; second < num_instances; ++second)
+        {
+            assert(instances[first]->frame_phase() != instances[second]->frame_phase());
+        }
+    }
+    const double freed_phase = instances[1]->frame_phase();
+    instances[1]->enable_staggered_frames(false);
+    assert(instances[1]->frame_phase() == 0.0);
+    instances.push_back(std::make_unique<BufferManager<double, fft_size>>(44100.0, fft_size));
+    instances.back()->enable_staggered_frames(true);
+    assert(instances.back()->frame_phase() == freed_phase);
+    instances.pop_back();
+    instances[1]->enable_staggered_frames(true);
+
+    // aligned, all instances complete their frames in the same callback. Staggered, at most one per callback of 64
+    // samples (the phases are a quarter of a hop of 512 apart), while every instance still gets every frame.
+    std::array<double, 64> chunk{};
+    std::array<FrameCounter, num_instances> counters{};
+    size_t max_frames_per_callback = 0;
+    for (size_t callback = 0; callback < 64; ++callback)
+    {
+        size_t frames = 0;
+        for (size_t instance = 0; instance < num_instances; ++instance)
+        {
+            const size_t frames_before = counters[instance].m_frames;
+            instances[instance]->process_daw_chunk(chunk.data(), chunk.size(), 1.0, counters[instance]);
+            frames += counters[instance].m_frames - frames_before;
+        }
+        max_frames_per_callback = std::max(max_frames_per_callback, frames);
+    }
+    assert(max_frames_per_callback == 1);
+    for (const auto& counter : counters)
+    {
+        assert(counter.m_frames == 64 * chunk.size() / (fft_size >> 1));
+    }
+
+    // the latency is the same with and without staggering.
+    instances[0]->enable_incremental_analysis(true);
+    const size_t staggered_latency = instances[0]->analysis_latency();
+    instances[0]->enable_staggered_frames(false);
+    assert(instances[0]->analysis_latency() == staggered_latency && staggered_latency == (fft_size >> 1));
+    instances.clear();
+    assert(FramePhaseScheduler::num_occupied_slots() == occupied_before);
+    std::cout << "Test passed." << std::endl;
+}
@@ -0,0 +1,84 @@
+/**
+ * Author: Lucas Scheidt
+ * Date: 14.10.26
+ *
+ * Description: Test cases for the lock-free parameter queue and the control panel.
+ */
+
+#pragma once
+#include "ControlPanel.h"
+#include <cassert>
+#include <iostream>
+#include <thread>
+
+using namespace LBTS::Spectral;
+
+inline void test_control_panel()
+{
+    std::cout << "Testing control panel..." << std::endl;
+    // a full queue rejects, the order is first in first out.
+    SpscQueue<size_t, 4> small_queue{};
+    assert(small_queue.empty() && !small_queue.pop());
+    for (size_t element = 0; element < 4; ++element)
+    {
+        assert(small_queue.push(element));
+    }
+    assert(!small_queue.push(4));
+    assert(small_queue.pop() == 0u);
+    assert(small_queue.push(4));
+    for (size_t element = 1; element < 5; ++element)
+    {
+        assert(small_queue.pop() == element);
+    }
+    assert(small_queue.empty());
+
+    // one producer and one consumer thread, nothing may get lost or reordered.
+    constexpr size_t num_elements = 200000;
+    SpscQueue<size_t, 64> threaded_queue{};
+    std::thread producer{[&threaded_queue]
+                         {
+                             for (size_t element = 0; element < num_elements; ++element)
+                             {
+                                 while (!threaded_queue.push(element))
+                                 {
+                                     std::this_thread::yield();
+                                 }
+                             }
+                         }};
+    size_t expected = 0;
+    while (expected < num_elements)
+    {
+        if (const auto element = threaded_queue.pop())
+        {
+            assert(*element == expected);
+            ++expected;
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+    assert(threaded_queue.empty());
+
+    // changes are only applied by the audio thread at the start of the next chunk.
+    BufferManager<float, BoundedPowTwo_v<size_t, 2048>> buffer_manager{44100.0};
+    ControlPanel<float, BoundedPowTwo_v<size_t, 2048>, 8> control_panel{buffer_manager};
+    assert(control_panel.select_fft_size(512));
+    assert(control_panel.select_partial_count(64));
+    assert(control_panel.set_threshold(2.0f));
+    assert(control_panel.set_threshold(3.0f));
+    assert(control_panel.select_osc_waveform(OscWaveform::SAW));
+    assert(control_panel.select_hop_size(HopSize::QUARTER));
+    assert(control_panel.select_analysis_window(AnalysisWindow::BLACKMAN));
+    assert(control_panel.select_interpolation(WTInterpolation::CUBIC_HERMITE));
+    assert(buffer_manager.fft_size() == 2048 && control_panel.threshold() == 1.0f);
+    assert(buffer_manager.interpolation() == WTInterpolation::LINEAR);
+    std::array<float, 256> chunk{};
+    control_panel.process_daw_chunk(chunk.data(), chunk.size());
+    assert(buffer_manager.fft_size() == 512);
+    assert(buffer_manager.interpolation() == WTInterpolation::CUBIC_HERMITE);
+    assert(control_panel.threshold() == 3.0f);
+    assert(control_panel.apply_parameter_updates() == 0);
+    std::cout << "Test passed." << std::endl;
+}
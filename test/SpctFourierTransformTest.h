@@ -0,0 +1,299 @@
+/**
+ * Author: Lucas Scheidt
+ * Date: 14.10.26
+ *
+ * Description: Test cases for the different FFT engines inside SpctProcessingFunctions.h. Every engine has to produce
+ * the same bins as the radix-2 reference implementation.
+ */
+
+#pragma once
+#include "SpctAnalysisWindows.h"
+#include "SpctProcessingFunctions.h"
+
+#include <cassert>
+#include <cmath>
+#include <iostream>
+
+namespace LBTS::Spectral
+{
+
+template <FloatingPt T, size_t N_SAMPLES>
+void fill_test_signal(ComplexArr<T, N_SAMPLES>& samples_arr)
+{
+    for (size_t index = 0; index < N_SAMPLES; ++index)
+    {
+        const T phase = two_pi<T> * static_cast<T>(index) / N_SAMPLES;
+        samples_arr[index] = static_cast<T>(0.9) * std::sin(3 * phase) + static_cast<T>(0.4) * std::cos(7 * phase) +
+                             static_cast<T>(index % 5) / 10;
+    }
+}
+
+template <FloatingPt T, size_t N_SAMPLES>
+double max_deviation(const ComplexArr<double, N_SAMPLES>& reference, const ComplexArr<T, N_SAMPLES>& to_compare)
+{
+    double deviation = 0;
+    for (size_t index = 0; index < N_SAMPLES; ++index)
+    {
+        const std::complex<double> widened{to_compare[index].real(), to_compare[index].imag()};
+        deviation = std::max(deviation, std::abs(reference[index] - widened));
+    }
+    return deviation;
+}
+
+/// @note the reference is always calculated in double precision, the float reference is checked against it as well.
+template <FloatingPt T, size_t DEG_TWO>
+void compare_radix_four_with_reference(const double tolerance)
+{
+    constexpr auto num_samples = pow_two_value_of_degree(DEG_TWO);
+    ComplexArr<double, num_samples> reference{};
+    ComplexArr<T, num_samples> radix_four{};
+    fill_test_signal(reference);
+    fill_test_signal(radix_four);
+
+    ExponentLUT<double> exponent_lut{};
+    const RadixFourLUT<T, DEG_TWO> radix_four_lut{};
+    spct_fourier_transform<double, DEG_TWO>(reference, exponent_lut);
+    spct_fourier_transform_radix_four<T, DEG_TWO>(radix_four, radix_four_lut);
+    assert(max_deviation(reference, radix_four) <= tolerance * num_samples);
+    if constexpr (std::is_same_v<T, float>)
+    {
+        ComplexArr<float, num_samples> float_reference{};
+        fill_test_signal(float_reference);
+        spct_fourier_transform<float, DEG_TWO>(float_reference, ExponentLUT<float>{});
+        assert(max_deviation(reference, float_reference) <= tolerance * num_samples);
+    }
+
+    if constexpr (num_samples >= 2)
+    {
+        // the resulting maps have to match for the resynthesis to behave the same.
+        PeakArr<double, (num_samples >> 1)> reference_map{};
+        PeakArr<T, (num_samples >> 1)> radix_four_map{};
+        const auto reference_entries = calculate_max_map<double, num_samples>(reference, reference_map, 1);
+        const auto radix_four_entries = calculate_max_map<T, num_samples>(radix_four, radix_four_map, 1);
+        assert(reference_entries == radix_four_entries);
+        for (size_t entry = 0; entry < reference_entries; ++entry)
+        {
+            assert(std::abs(reference_map.magnitude(entry) - radix_four_map.magnitude(entry)) <= tolerance * num_samples);
+        }
+    }
+}
+
+template <FloatingPt T, size_t... DEGREES>
+void compare_radix_four_for_degrees(const double tolerance, std::index_sequence<DEGREES...>)
+{
+    (compare_radix_four_with_reference<T, DEGREES>(tolerance), ...);
+}
+
+/// @note the SIMD engine has to produce the same bins as the scalar radix-4 engine (same algorithm, so the results
+/// are allowed to differ in the rounding only).
+template <FloatingPt T, size_t DEG_TWO>
+void compare_simd_with_radix_four(const double tolerance)
+{
+    constexpr auto num_samples = pow_two_value_of_degree(DEG_TWO);
+    ComplexArr<T, num_samples> radix_four{};
+    ComplexArr<T, num_samples> simd{};
+    fill_test_signal(radix_four);
+    fill_test_signal(simd);
+    const RadixFourLUT<T, DEG_TWO> radix_four_lut{};
+    const SoaRadixFourLUT<T, DEG_TWO> soa_lut{};
+    SplitComplexArr<T, num_samples> split_arr{};
+    spct_fourier_transform_radix_four<T, DEG_TWO>(radix_four, radix_four_lut);
+    spct_fourier_transform_simd<T, DEG_TWO>(simd, split_arr, soa_lut);
+    for (size_t index = 0; index < num_samples; ++index)
+    {
+        assert(std::abs(radix_four[index] - simd[index]) <= tolerance * num_samples);
+        assert(split_arr.m_real[index] == simd[index].real() && split_arr.m_imag[index] == simd[index].imag());
+    }
+}
+
+template <FloatingPt T, size_t... DEGREES>
+void compare_simd_for_degrees(const double tolerance, std::index_sequence<DEGREES...>)
+{
+    (compare_simd_with_radix_four<T, DEGREES>(tolerance), ...);
+}
+
+/// @note compares the real input FFT with the complex radix-4 engine fed with the same (real) values.
+template <FloatingPt T, size_t DEG_TWO>
+void compare_real_with_complex_transform(const double tolerance)
+{
+    constexpr auto num_samples = pow_two_value_of_degree(DEG_TWO);
+    ComplexArr<T, num_samples> complex_samples{};
+    fill_test_signal(complex_samples);
+    std::array<T, num_samples> real_samples{};
+    ComplexArr<T, (num_samples >> 1)> packed_simd{};
+    SplitComplexArr<T, (num_samples >> 1)> split_arr{};
+    std::transform(complex_samples.begin(),
+                   complex_samples.end(),
+                   real_samples.begin(),
+                   [](const std::complex<T>& value) { return value.real(); });
+
+    const RadixFourLUT<T, DEG_TWO> radix_four_lut{};
+    const RealFourierLUT<T, DEG_TWO> real_fourier_lut{};
+    ComplexArr<T, (num_samples >> 1)> spectrum{};
+    spct_fourier_transform_radix_four<T, DEG_TWO>(complex_samples, radix_four_lut);
+    spct_real_fourier_transform<T, DEG_TWO>(real_samples, spectrum, real_fourier_lut);
+    pack_real_samples<T, DEG_TWO>(real_samples, packed_simd);
+    spct_real_fourier_transform<T, DEG_TWO>(packed_simd, split_arr, real_fourier_lut);
+    for (size_t bin = 0; bin < (num_samples >> 1); ++bin)
+    {
+        assert(std::abs(complex_samples[bin] - spectrum[bin]) <= tolerance * num_samples);
+        assert(std::abs(complex_samples[bin] - packed_simd[bin]) <= tolerance * num_samples);
+    }
+
+    PeakArr<T, (num_samples >> 1)> complex_map{};
+    PeakArr<T, (num_samples >> 1)> real_map{};
+    const auto complex_entries = calculate_max_map<T, num_samples>(complex_samples, complex_map, 1);
+    const auto real_entries = calculate_max_map<T, num_samples>(spectrum, real_map, 1);
+    assert(complex_entries == real_entries);
+}
+
+template <FloatingPt T, size_t... DEGREES>
+void compare_real_transform_for_degrees(const double tolerance, std::index_sequence<DEGREES...>)
+{
+    // degree 0 has no real input transformation.
+    (compare_real_with_complex_transform<T, DEGREES + 1>(tolerance), ...);
+}
+
+/// @note the inverse has to give back the signal (without its nyquist component, which the real transform drops).
+template <FloatingPt T, size_t DEG_TWO>
+void compare_inverse_with_forward_transform(const double tolerance)
+{
+    constexpr auto num_samples = pow_two_value_of_degree(DEG_TWO);
+    ComplexArr<T, num_samples> complex_samples{};
+    fill_test_signal(complex_samples);
+    std::array<T, num_samples> real_samples{};
+    T nyquist = 0;
+    for (size_t index = 0; index < num_samples; ++index)
+    {
+        real_samples[index] = complex_samples[index].real();
+        nyquist += (index & 1 ? -real_samples[index] : real_samples[index]) / num_samples;
+    }
+    for (size_t index = 0; index < num_samples; ++index)
+    {
+        real_samples[index] -= index & 1 ? -nyquist : nyquist;
+    }
+    const RealFourierLUT<T, DEG_TWO> real_fourier_lut{};
+    ComplexArr<T, (num_samples >> 1)> spectrum{};
+    SplitComplexArr<T, (num_samples >> 1)> split_arr{};
+    spct_real_fourier_transform<T, DEG_TWO>(real_samples, spectrum, real_fourier_lut);
+    spct_inverse_real_fourier_transform<T, DEG_TWO>(spectrum, split_arr, real_fourier_lut);
+    for (size_t packed_ndx = 0; packed_ndx < (num_samples >> 1); ++packed_ndx)
+    {
+        assert(std::abs(spectrum[packed_ndx].real() - real_samples[packed_ndx << 1]) <= tolerance);
+        assert(std::abs(spectrum[packed_ndx].imag() - real_samples[(packed_ndx << 1) + 1]) <= tolerance);
+    }
+}
+
+template <FloatingPt T, size_t... DEGREES>
+void compare_inverse_transform_for_degrees(const double tolerance, std::index_sequence<DEGREES...>)
+{
+    (compare_inverse_with_forward_transform<T, DEGREES + 1>(tolerance), ...);
+}
+
+/// @note the K loudest bins have to be the first K entries of the complete (sorted) map.
+template <FloatingPt T, size_t DEG_TWO>
+void compare_top_k_with_full_map(const size_t max_entries)
+{
+    constexpr auto num_samples = pow_two_value_of_degree(DEG_TWO);
+    ComplexArr<T, num_samples> spectrum{};
+    fill_test_signal(spectrum);
+    const RadixFourLUT<T, DEG_TWO> radix_four_lut{};
+    spct_fourier_transform_radix_four<T, DEG_TWO>(spectrum, radix_four_lut);
+    PeakArr<T, (num_samples >> 1)> full_map{};
+    PeakArr<T, (num_samples >> 1)> top_k_map{};
+    const auto full_entries = calculate_max_map<T, num_samples>(spectrum, full_map, 1);
+    const auto top_k_entries = calculate_max_map<T, num_samples>(spectrum, top_k_map, 1, max_entries);
+    assert(top_k_entries == std::min(full_entries, max_entries));
+    for (size_t entry = 0; entry < top_k_entries; ++entry)
+    {
+        assert(top_k_map.magnitude(entry) == full_map.magnitude(entry));
+        assert(std::abs(top_k_map.magnitude(entry) - std::abs(spectrum[static_cast<size_t>(top_k_map.bin(entry))])) <=
+               1e-5 * top_k_map.magnitude(entry));
+    }
+}
+
+/// @note a windowed sinusoid between two bins has to be found as a single peak close to its true frequency.
+template <FloatingPt T>
+void test_peak_interpolation(const double true_bin, const double tolerance)
+{
+    constexpr size_t num_samples = BoundedPowTwo_v<size_t, 512>;
+    constexpr size_t deg_two = degree_of_pow_two_value(num_samples);
+    const auto& hann_window = AnalysisWindowTable_v<T, num_samples, AnalysisWindow::HANN>;
+    std::array<T, num_samples> real_samples{};
+    for (size_t index = 0; index < num_samples; ++index)
+    {
+        const double phase = two_pi<double> * true_bin * static_cast<double>(index) / num_samples;
+        real_samples[index] = static_cast<T>(0.5 * std::sin(phase + 0.3)) * hann_window[index];
+    }
+    const RealFourierLUT<T, deg_two> real_fourier_lut{};
+    ComplexArr<T, (num_samples >> 1)> spectrum{};
+    spct_real_fourier_transform<T, deg_two>(real_samples, spectrum, real_fourier_lut);
+    PeakArr<T, (num_samples >> 1)> peak_map{};
+    PeakArr<T, (num_samples >> 1)> max_map{};
+    const auto peak_entries = calculate_peak_map<T, num_samples>(spectrum, peak_map, 1, 10);
+    const auto max_entries = calculate_max_map<T, num_samples>(spectrum, max_map, 1, 10);
+    // the main lobe spans several bins, but only one of them is a peak.
+    assert(peak_entries == 1 && max_entries > 1);
+    assert(std::abs(peak_map.bin(0) - true_bin) < tolerance);
+    assert(std::abs(max_map.bin(0) - true_bin) <= 0.5);
+    // amplitude 0.5 means |X| = 0.5 * N / 2 with a coherent gain of 1.
+    assert(std::abs(peak_map.magnitude(0) - 0.25 * num_samples) < 0.02 * num_samples);
+}
+
+inline void test_fourier_transform()
+{
+    std::cout << "Testing fourier transform engines..." << std::endl;
+    static_assert(BitReversalTable_v<3>[1] == 4);
+    static_assert(BitReversalTable_v<3>[3] == 6);
+    static_assert(BitReversalTable_v<4>[1] == 8);
+
+    // a pure cosine on bin 4 has to show up on bin 4 (and its mirror) only.
+    constexpr auto num_samples = BoundedPowTwo_v<size_t, 64>;
+    ComplexArr<double, num_samples> cosine{};
+    for (size_t index = 0; index < num_samples; ++index)
+    {
+        cosine[index] = std::cos(two_pi<double> * 4 * static_cast<double>(index) / num_samples);
+    }
+    const RadixFourLUT<double, 6> radix_four_lut{};
+    spct_fourier_transform_radix_four<double, 6>(cosine, radix_four_lut);
+    assert(std::abs(std::abs(cosine[4]) - num_samples / 2.0) < 1e-9);
+    assert(std::abs(std::abs(cosine[num_samples - 4]) - num_samples / 2.0) < 1e-9);
+    assert(std::abs(cosine[5]) < 1e-9);
+
+    // the twiddle table has to cover every allowed size and has to be generated in the right precision.
+    static_assert(ExponentLUT<float>::num_twiddles == max_num_of_samples - 1);
+    static_assert(std::is_same_v<decltype(ExponentLUT<float>::stage(0))::element_type, const std::complex<float>>);
+    static_assert(ExponentLUT<double>::stage(max_pow_two_degree - 1).size() == max_num_of_samples / 2);
+    static_assert(ExponentLUT<double>::stage(0)[0] == std::complex<double>{1, 0});
+    for (size_t stage_index = 0; stage_index < ExponentLUT<double>::num_stages; ++stage_index)
+    {
+        const auto twiddles = ExponentLUT<double>::stage_at(stage_index);
+        for (size_t index = 0; index < twiddles.size(); ++index)
+        {
+            const double angle = std::numbers::pi * static_cast<double>(index) / static_cast<double>(twiddles.size());
+            assert(std::abs(twiddles[index] - std::polar(1.0, -angle)) < 1e-15);
+        }
+    }
+
+    compare_radix_four_for_degrees<double>(1e-12, std::make_index_sequence<max_pow_two_degree + 1>{});
+    compare_radix_four_for_degrees<float>(1e-5, std::make_index_sequence<max_pow_two_degree + 1>{});
+    std::cout << "SIMD instruction set: " << simd_instruction_set << std::endl;
+    compare_simd_for_degrees<double>(1e-12, std::make_index_sequence<max_pow_two_degree + 1>{});
+    compare_simd_for_degrees<float>(1e-5, std::make_index_sequence<max_pow_two_degree + 1>{});
+    compare_real_transform_for_degrees<double>(1e-12, std::make_index_sequence<max_pow_two_degree>{});
+    compare_real_transform_for_degrees<float>(1e-5, std::make_index_sequence<max_pow_two_degree>{});
+    compare_inverse_transform_for_degrees<double>(1e-12, std::make_index_sequence<max_pow_two_degree>{});
+    compare_inverse_transform_for_degrees<float>(1e-4, std::make_index_sequence<max_pow_two_degree>{});
+    for (const double true_bin : {20.0, 20.25, 37.5, 100.8})
+    {
+        test_peak_interpolation<float>(true_bin, 0.05);
+        test_peak_interpolation<double>(true_bin, 0.05);
+    }
+    for (const size_t max_entries : {0, 1, 10, 64, 512})
+    {
+        compare_top_k_with_full_map<float, 10>(max_entries);
+        compare_top_k_with_full_map<double, 10>(max_entries);
+    }
+    std::cout << "Test passed." << std::endl;
+}
+} // namespace LBTS::Spectral
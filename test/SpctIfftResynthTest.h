@@ -0,0 +1,108 @@
+/**
+ * Author: Lucas Scheidt
+ * Date: 14.10.26
+ *
+ * Description: The overlapped grains of the inverse FFT resynthesis have to add up to continuous partials.
+ *
+ */
+
+#pragma once
+#include "SpctBufferManager.h"
+#include "SpctIfftResynth.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+using namespace LBTS::Spectral;
+
+template <FloatingPt T>
+void check_ifft_partials(const size_t hop_size, const std::vector<double>& bins, const double tolerance)
+{
+    constexpr size_t fft_size = 1024;
+    IfftResynth<T, fft_size, 16> resynth{44100.0};
+    resynth.set_hop_size(hop_size);
+    assert(resynth.hop_size() == hop_size);
+    PeakArr<T, 16> peaks{};
+    for (size_t peak = 0; peak < bins.size(); ++peak)
+    {
+        peaks.set(peak, static_cast<T>(bins[peak]), static_cast<T>(300));
+    }
+    resynth.tune_oscillators(peaks, bins.size());
+    std::vector<T> output(8 * fft_size);
+    // odd blocks, the grains don't care about the block size.
+    for (size_t offset = 0; offset < output.size(); offset += 100)
+    {
+        resynth.process(output.data() + offset, std::min<size_t>(100, output.size() - offset));
+    }
+    // the first grain fades in and has its center (phase zero) at the end of the first hop, from there on the grains
+    // sum up to cosines of the same amplitude ResynthOscs would play (2 / N * magnitude).
+    const double amplitude = 2.0 / fft_size * 300.0;
+    double max_deviation = 0.0;
+    for (size_t sample = hop_size; sample < output.size(); ++sample)
+    {
+        double expected = 0.0;
+        for (const double bin : bins)
+        {
+            const double frequency = bin / fft_size;
+            expected += amplitude * std::cos(two_pi<double> * frequency * static_cast<double>(sample - hop_size));
+        }
+        max_deviation = std::max(max_deviation, std::abs(static_cast<double>(output[sample]) - expected));
+    }
+    assert(max_deviation < tolerance * amplitude);
+}
+
+inline void test_ifft_resynthesis()
+{
+    std::cout << "Testing the inverse FFT resynthesis..." << std::endl;
+    for (const size_t hop_size : {64, 256, 1024})
+    {
+        for (const double bin : {3.0, 40.0, 40.3, 123.77})
+        {
+            check_ifft_partials<double>(hop_size, {bin}, 0.01);
+            check_ifft_partials<float>(hop_size, {bin}, 0.01);
+        }
+        // both round to the same bin of the grain (except with the largest hop) but keep a phase each.
+        check_ifft_partials<double>(hop_size, {40.2, 40.6}, 0.02);
+        check_ifft_partials<float>(hop_size, {40.6, 40.2}, 0.02);
+    }
+
+    // partials at or above nyquist (after the transposition) and beyond the partial count are dropped.
+    IfftResynth<double, 1024, 16> resynth{44100.0};
+    resynth.set_partial_count(1);
+    PeakArr<double, 16> peaks{};
+    peaks.set(0, 300.0, 300.0);
+    peaks.set(1, 10.0, 300.0);
+    resynth.tune_oscillators(peaks, 2, 2.0);
+    std::vector<double> output(2048);
+    resynth.process(output.data(), output.size());
+    assert(std::ranges::all_of(output, [](const double value) { return value == 0.0; }));
+
+    // selectable per instance, both engines play the same partials at about the same level.
+    const auto render = [](const ResynthesisEngine engine)
+    {
+        BufferManager<double, BoundedPowTwo_v<size_t, 1024>> buffer_manager{44100.0};
+        buffer_manager.select_hop_size(HopSize::QUARTER);
+        buffer_manager.select_analysis_window(AnalysisWindow::HANN);
+        buffer_manager.select_resynthesis_engine(engine);
+        assert(buffer_manager.resynthesis_engine() == engine);
+        std::vector<double> signal(16384);
+        for (size_t index = 0; index < signal.size(); ++index)
+        {
+            signal[index] = 0.5 * std::sin(two_pi<double> * 440.0 * static_cast<double>(index) / 44100.0);
+        }
+        buffer_manager.process_daw_chunk(signal.data(), signal.size());
+        double energy = 0.0;
+        for (size_t index = signal.size() / 2; index < signal.size(); ++index)
+        {
+            energy += signal[index] * signal[index];
+        }
+        return std::sqrt(energy / static_cast<double>(signal.size() / 2));
+    };
+    const double oscillator_rms = render(ResynthesisEngine::OSCILLATOR_BANK);
+    const double ifft_rms = render(ResynthesisEngine::INVERSE_FFT);
+    assert(oscillator_rms > 0.01);
+    assert(ifft_rms > 0.8 * oscillator_rms && ifft_rms < 1.25 * oscillator_rms);
+    std::cout << "Test passed." << std::endl;
+}
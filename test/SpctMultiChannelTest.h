@@ -0,0 +1,140 @@
+/**
+ * Author: Lucas Scheidt
+ * Date: 14.10.26
+ *
+ * Description: The batched analysis has to find the same peaks as one BufferManager per channel.
+ *
+ */
+
+#pragma once
+#include "SpctBufferManager.h"
+#include "SpctMultiChannelProcessor.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+using namespace LBTS::Spectral;
+
+inline void test_multi_channel_processor()
+{
+    std::cout << "Testing the multi-channel processor..." << std::endl;
+    constexpr auto one_twenty_four = BoundedPowTwo_v<size_t, 1024>;
+    constexpr size_t num_channels = 5;
+    constexpr size_t chunk_size = 3 * one_twenty_four;
+    constexpr double fs = 44100.0;
+    // more channels than lanes, so there is at least one full and one partial batch.
+    std::vector<std::vector<double>> channels(num_channels, std::vector<double>(chunk_size));
+    for (size_t channel = 0; channel < num_channels; ++channel)
+    {
+        for (size_t index = 0; index < chunk_size; ++index)
+        {
+            const double time = static_cast<double>(index) / fs;
+            channels[channel][index] = 0.6 * std::sin(two_pi<double> * (300.0 + 250.0 * channel) * time) +
+                                       0.2 * std::sin(two_pi<double> * (4000.0 - 500.0 * channel) * time);
+        }
+    }
+    auto reference_channels = channels;
+
+    MultiChannelProcessor<double, one_twenty_four, 8> processor{fs};
+    processor.select_hop_size(HopSize::HALF);
+    processor.select_analysis_window(AnalysisWindow::HANN);
+    std::array<double*, num_channels> channel_ptrs{};
+    for (size_t channel = 0; channel < num_channels; ++channel)
+    {
+        channel_ptrs[channel] = channels[channel].data();
+    }
+    processor.process_daw_chunk(channel_ptrs.data(), num_channels, chunk_size);
+    for (size_t channel = 0; channel < num_channels; ++channel)
+    {
+        BufferManager<double, one_twenty_four> reference{fs};
+        reference.select_hop_size(HopSize::HALF);
+        reference.select_analysis_window(AnalysisWindow::HANN);
+        reference.process_daw_chunk(reference_channels[channel].data(), chunk_size);
+        assert(reference.valid_entries() > 0);
+        assert(processor.valid_entries(channel) == reference.valid_entries());
+        for (size_t entry = 0; entry < reference.valid_entries(); ++entry)
+        {
+            const auto& peaks = processor.peaks(channel);
+            const auto& reference_peaks = reference.peaks();
+            assert(std::abs(peaks.bin(entry) - reference_peaks.bin(entry)) < 1e-6);
+            assert(std::abs(peaks.magnitude(entry) - reference_peaks.magnitude(entry)) <
+                   1e-9 * reference_peaks.magnitude(entry));
+        }
+        for (size_t index = 0; index < chunk_size; ++index)
+        {
+            assert(std::abs(channels[channel][index] - reference_channels[channel][index]) < 1e-6);
+        }
+    }
+
+    // with fewer channels the idle ring buffers aren't filled. Once the channels come back their ring buffers start
+    // over from silence, so they find the peaks of a BufferManager that got silence in the meantime.
+    MultiChannelProcessor<double, one_twenty_four, 8> shrinking{fs};
+    shrinking.select_hop_size(HopSize::HALF);
+    shrinking.select_analysis_window(AnalysisWindow::HANN);
+    std::vector<std::unique_ptr<BufferManager<double, one_twenty_four>>> silenced_references{};
+    for (size_t channel = 0; channel < num_channels; ++channel)
+    {
+        silenced_references.push_back(std::make_unique<BufferManager<double, one_twenty_four>>(fs));
+        silenced_references.back()->select_hop_size(HopSize::HALF);
+        silenced_references.back()->select_analysis_window(AnalysisWindow::HANN);
+    }
+    // the phases are no multiple of the FFT size, so the ring buffers are somewhere in the middle when channels return.
+    constexpr size_t phase_size = chunk_size - 100;
+    constexpr std::array<size_t, 3> phase_channels{num_channels, 2, num_channels};
+    for (const size_t active_channels : phase_channels)
+    {
+        for (size_t channel = 0; channel < num_channels; ++channel)
+        {
+            for (size_t index = 0; index < chunk_size; ++index)
+            {
+                const double time = static_cast<double>(index) / fs;
+                channels[channel][index] = 0.4 * std::sin(two_pi<double> * (500.0 + 300.0 * channel) * time);
+            }
+            reference_channels[channel] = channels[channel];
+            if (channel >= active_channels)
+            {
+                std::ranges::fill(reference_channels[channel], 0.0);
+            }
+            silenced_references[channel]->process_daw_chunk(reference_channels[channel].data(), phase_size);
+        }
+        shrinking.process_daw_chunk(channel_ptrs.data(), active_channels, phase_size);
+    }
+    for (size_t channel = 0; channel < num_channels; ++channel)
+    {
+        assert(silenced_references[channel]->valid_entries() > 0);
+        assert(shrinking.valid_entries(channel) == silenced_references[channel]->valid_entries());
+        const auto& reference_peaks = silenced_references[channel]->peaks();
+        for (size_t entry = 0; entry < shrinking.valid_entries(channel); ++entry)
+        {
+            assert(std::abs(shrinking.peaks(channel).bin(entry) - reference_peaks.bin(entry)) < 1e-6);
+        }
+    }
+
+    // a linked analysis plays the same in every channel.
+    processor.select_channel_link(ChannelLink::LINKED);
+    processor.process_daw_chunk(channel_ptrs.data(), num_channels, chunk_size);
+    assert(processor.valid_entries(0) > 0);
+    for (size_t channel = 1; channel < num_channels; ++channel)
+    {
+        assert(channels[channel] == channels[0]);
+    }
+
+    // a mono signal has no side, so both outputs are the mid.
+    MultiChannelProcessor<float, one_twenty_four, 2> stereo{fs};
+    stereo.select_channel_link(ChannelLink::MID_SIDE);
+    std::array<std::vector<float>, 2> stereo_channels{std::vector<float>(chunk_size), std::vector<float>(chunk_size)};
+    for (size_t index = 0; index < chunk_size; ++index)
+    {
+        stereo_channels[0][index] = 0.5f * std::sin(two_pi<float> * 880.f * static_cast<float>(index) / 44100.f);
+        stereo_channels[1][index] = stereo_channels[0][index];
+    }
+    std::array<float*, 2> stereo_ptrs{stereo_channels[0].data(), stereo_channels[1].data()};
+    stereo.process_daw_chunk(stereo_ptrs.data(), 2, chunk_size);
+    assert(stereo.valid_entries(0) > 0 && stereo.valid_entries(1) == 0);
+    assert(stereo_channels[0] == stereo_channels[1]);
+    assert(std::ranges::any_of(stereo_channels[0], [](const float value) { return value != 0.f; }));
+    std::cout << "Test passed." << std::endl;
+}
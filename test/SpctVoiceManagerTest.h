@@ -0,0 +1,92 @@
+/**
+ * Author: Lucas Scheidt
+ * Date: 14.10.26
+ *
+ * Description: Allocation, stealing and transposition of the polyphonic resynthesis.
+ *
+ */
+
+#pragma once
+#include "VoiceManager.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <complex>
+#include <iostream>
+
+using namespace LBTS::Spectral;
+
+/// @brief Magnitude of a single frequency (plain DFT), enough to tell the played pitch.
+inline double magnitude_at(const double* signal, const size_t size, const double frequency, const double sampling_freq)
+{
+    std::complex<double> sum{};
+    for (size_t index = 0; index < size; ++index)
+    {
+        sum += signal[index] * std::polar(1.0, -two_pi<double> * frequency * static_cast<double>(index) / sampling_freq);
+    }
+    return std::abs(sum);
+}
+
+inline void test_voice_manager()
+{
+    std::cout << "Testing the voice manager..." << std::endl;
+    constexpr auto one_twenty_four = BoundedPowTwo_v<size_t, 1024>;
+    constexpr double fs = 44100.0;
+    std::array<double, 4 * one_twenty_four> input{};
+    for (size_t index = 0; index < input.size(); ++index)
+    {
+        input[index] = 0.8 * std::sin(two_pi<double> * 440.0 * static_cast<double>(index) / fs);
+    }
+
+    // without notes the voices stay silent although the input gets analysed.
+    BufferManager<double, one_twenty_four> silent_bm{fs};
+    VoiceManager<double, one_twenty_four, 2> silent_voices{silent_bm};
+    auto silent_chunk = input;
+    silent_voices.process_daw_chunk(silent_chunk.data(), silent_chunk.size());
+    assert(std::ranges::all_of(silent_chunk, [](const double value) { return value == 0.0; }));
+    assert(silent_bm.valid_entries() > 0);
+
+    // a full velocity note on the root plays exactly what the BufferManager would play on its own.
+    BufferManager<double, one_twenty_four> mono_bm{fs};
+    BufferManager<double, one_twenty_four> poly_bm{fs};
+    VoiceManager<double, one_twenty_four, 2> voices{poly_bm};
+    voices.note_on(VoiceManager<double, one_twenty_four, 2>::root_note, 127);
+    auto mono_chunk = input;
+    auto poly_chunk = input;
+    mono_bm.process_daw_chunk(mono_chunk.data(), mono_chunk.size());
+    voices.process_daw_chunk(poly_chunk.data(), poly_chunk.size());
+    assert(mono_chunk == poly_chunk);
+
+    // an octave up doubles every partial.
+    voices.note_off(VoiceManager<double, one_twenty_four, 2>::root_note);
+    voices.note_on(VoiceManager<double, one_twenty_four, 2>::root_note + 12, 127);
+    assert(voices.active_voices() == 2);
+    auto octave_chunk = input;
+    voices.process_daw_chunk(octave_chunk.data(), octave_chunk.size());
+    // the released root note has faded out and its voice went back to the pool
+    assert(voices.active_voices() == 1);
+    const double* octave_tail = octave_chunk.data() + one_twenty_four;
+    const size_t tail_size = octave_chunk.size() - one_twenty_four;
+    assert(magnitude_at(octave_tail, tail_size, 880.0, fs) > 10.0 * magnitude_at(octave_tail, tail_size, 440.0, fs));
+
+    // the third note steals the oldest voice, its note off must not release the new owner
+    voices.note_on(64, 100);
+    voices.note_on(67, 100);
+    assert(voices.active_voices() == 2);
+    voices.note_off(VoiceManager<double, one_twenty_four, 2>::root_note + 12);
+    voices.note_on(64, 0);
+    assert(voices.active_voices() == 2);
+    auto chord_chunk = input;
+    voices.process_daw_chunk(chord_chunk.data(), chord_chunk.size());
+    assert(voices.active_voices() == 1);
+    // the second half of the chunk only contains the remaining note
+    const double* chord_tail = chord_chunk.data() + 2 * one_twenty_four;
+    const double g_freq = 440.0 * std::exp2(7.0 / 12.0);
+    assert(magnitude_at(chord_tail, 2 * one_twenty_four, g_freq, fs) > 0.0);
+    assert(magnitude_at(chord_tail, 2 * one_twenty_four, g_freq, fs) >
+           10.0 * magnitude_at(chord_tail, 2 * one_twenty_four, 440.0 * std::exp2(4.0 / 12.0), fs));
+
+    voices.reset(fs);
+    assert(voices.active_voices() == 0);
+    std::cout << "Test passed." << std::endl;
+}
@@ -8,6 +8,13 @@
 #pragma once
 #include "SpctWavetables.h"
 #include "SpctOscillators.h"
+#include "SpctProcessingFunctions.h"
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <iostream>
+#include <vector>
 
 namespace LBTS::Spectral
 {
@@ -31,8 +38,392 @@ inline void test_wavetable_creation()
     assert(m_tri_wt[128] <= 0);
     assert(m_tri_wt[255] < 0);
 
+    // the raw tables are generated at compile time, the compile-time sine is as accurate as std::sin.
+    static_assert(SineWT_v<double, 256>[64] > 0.999999 && SquareWT_v<float, 256>[128] == 1.0F);
+    static_assert(SawWT_v<double, 256>[0] == 1.0 && TriWT_v<double, 256>[64] == 1.0);
+    const auto& compile_time_sine = SineWT_v<double, 256>;
+    const auto& compile_time_square = SquareWT_v<double, 256>;
+    const auto& compile_time_tri = TriWT_v<double, 256>;
+    for (size_t index = 0; index < 256; ++index)
+    {
+        assert(std::abs(compile_time_sine[index] - std::sin(two_pi<double> * index / 256.0)) < 1e-14);
+        assert(compile_time_square[index] == m_square_wt[index]);
+        assert(compile_time_tri[index] == m_tri_wt[index]);
+    }
+
+    // the tables are generated at compile time and shared between all instances.
+    static_assert(SharedWaveTables<double, 256>::acquire(OscWaveform::SAW) ==
+                  &MipMappedWaveTable_v<double, 256, OscWaveform::SAW>);
+    static_assert(MipMappedWaveTable_v<double, 256, OscWaveform::SQUARE>.level(0)[0] == 0.0);
+    {
+        const auto first_saw = SharedWaveTables<double, 256>::acquire(OscWaveform::SAW);
+        const auto second_saw = SharedWaveTables<double, 256>::acquire(OscWaveform::SAW);
+        assert(first_saw == second_saw);
+        const auto square = SharedWaveTables<double, 256>::acquire(OscWaveform::SQUARE);
+        assert(first_saw != square);
+        // the shared table is the band-limited saw (the mip map of it).
+        const MipMappedWaveTable<double, 256> saw_mip_map{OscWaveform::SAW};
+        assert(first_saw->level(0)[1] == saw_mip_map.level(0)[1]);
+        assert(first_saw->level(MipMappedWaveTable<double, 256>::num_levels - 1)[1] ==
+               saw_mip_map.level(MipMappedWaveTable<double, 256>::num_levels - 1)[1]);
+    }
+    {
+        const ResynthOscs<float, 512, 1024> first_oscs{44100.0};
+        const ResynthOscs<float, 512, 1024> second_oscs{48000.0};
+        assert(first_oscs.m_sin_wt == second_oscs.m_sin_wt);
+        assert(first_oscs.m_sin_wt != second_oscs.m_tri_wt);
+    }
+
     ResynthOscs<double, 512, 1024> m_res_oscs{48000.0};
     m_res_oscs.reset(44100.0);
+
+    // rendering a block has to be the same as rendering sample by sample.
+    PeakArr<double, max_partials> peaks{};
+    peaks.set(0, 10, 300.0);
+    peaks.set(1, 23, 120.0);
+    peaks.set(2, 511, 50.0);
+    ResynthOscs<double, 512, 1024> block_oscs{44100.0};
+    block_oscs.select_waveform(OscWaveform::SAW);
+    m_res_oscs.select_waveform(OscWaveform::SAW);
+    block_oscs.tune_oscillators(peaks, 3);
+    m_res_oscs.tune_oscillators(peaks, 3);
+    std::array<double, 300> block{};
+    block_oscs.process(block.data(), 100);
+    block_oscs.process(block.data() + 100, 200);
+    for (const double rendered : block)
+    {
+        assert(rendered == m_res_oscs.receive_output());
+    }
+    assert(std::ranges::any_of(block, [](const double value) { return value != 0.0; }));
+
+    // the partial count is a runtime value, but never above the capacity.
+    block_oscs.set_partial_count(2 * max_partials);
+    assert(block_oscs.partial_count() == max_partials);
+    ResynthOscs<double, 512, 1024, 16> small_oscs{44100.0};
+    small_oscs.set_partial_count(300);
+    assert(small_oscs.partial_count() == 16);
+}
+
+/// @note the SIMD bank only sums up the lanes in a different order, so it has to match the scalar bank up to rounding.
+template <FloatingPt T>
+void compare_simd_bank_with_scalar_bank(const size_t num_partials, const double tolerance,
+                                        const WTInterpolation interpolation)
+{
+    constexpr size_t wt_size = 512;
+    const SawWT<T, wt_size> saw_wt{};
+    OscillatorBank<T, wt_size, max_partials> simd_bank{};
+    OscillatorBank<T, wt_size, max_partials, ScalarVec<T>> scalar_bank{};
+    simd_bank.select_interpolation(interpolation);
+    scalar_bank.select_interpolation(interpolation);
+    for (size_t partial = 0; partial < num_partials; ++partial)
+    {
+        // spread the partials up to nyquist (increment of WT_SIZE / 2).
+        const T increment = static_cast<T>(wt_size / 2) * static_cast<T>(partial + 1) / static_cast<T>(num_partials);
+        const T gain = static_cast<T>(1) / static_cast<T>(partial + 1);
+        simd_bank.set_partial(partial, increment, gain);
+        scalar_bank.set_partial(partial, increment, gain);
+    }
+    simd_bank.set_active_partials(num_partials);
+    scalar_bank.set_active_partials(num_partials);
+    std::array<T, 200> simd_block{};
+    std::array<T, 200> scalar_block{};
+    simd_bank.process(saw_wt.data(), simd_block.data(), 77);
+    simd_bank.process(saw_wt.data(), simd_block.data() + 77, 123);
+    scalar_bank.process(saw_wt.data(), scalar_block.data(), simd_block.size());
+    for (size_t sample = 0; sample < simd_block.size(); ++sample)
+    {
+        assert(std::abs(simd_block[sample] - scalar_block[sample]) <= tolerance * static_cast<double>(num_partials));
+    }
+}
+
+inline void test_oscillator_bank()
+{
+    std::cout << "Testing the oscillator bank..." << std::endl;
+    for (const size_t num_partials : {1, 3, 64, 255, 512})
+    {
+        for (const auto interpolation : {WTInterpolation::LINEAR, WTInterpolation::CUBIC_HERMITE})
+        {
+            compare_simd_bank_with_scalar_bank<float>(num_partials, 1e-4, interpolation);
+            compare_simd_bank_with_scalar_bank<double>(num_partials, 1e-12, interpolation);
+        }
+    }
+
+    // a silenced bank has to output zeros, no matter what was tuned before.
+    OscillatorBank<float, 512, 8> bank{};
+    bank.set_partial(0, 3.0f, 1.0f);
+    bank.set_active_partials(0);
+    const SineWT<float, 512> sine_wt{};
+    assert(bank.receive_output(sine_wt.data()) == 0.0f);
+
+    // the per sample output follows the block output, also during a ramp and with both interpolations.
+    const SawWT<double, 512> saw_wt{};
+    for (const auto interpolation : {WTInterpolation::LINEAR, WTInterpolation::CUBIC_HERMITE})
+    {
+        OscillatorBank<double, 512, 12> block_bank{};
+        OscillatorBank<double, 512, 12> sample_bank{};
+        for (auto* tuned_bank : {&block_bank, &sample_bank})
+        {
+            tuned_bank->select_interpolation(interpolation);
+            for (size_t partial = 0; partial < 11; ++partial)
+            {
+                tuned_bank->set_partial(partial, 1.37 * static_cast<double>(partial + 1), 0.1);
+                tuned_bank->set_partial_target(partial, 2.11 * static_cast<double>(partial + 1), 0.05);
+            }
+            tuned_bank->start_ramp(100, 11);
+        }
+        std::array<double, 300> block_output{};
+        block_bank.process(saw_wt.data(), block_output.data(), block_output.size());
+        for (const double expected : block_output)
+        {
+            assert(std::abs(sample_bank.receive_output(saw_wt.data()) - expected) < 1e-12);
+        }
+    }
+    std::cout << "Test passed." << std::endl;
+}
+
+inline void test_smooth_retuning()
+{
+    std::cout << "Testing smooth retuning..." << std::endl;
+    // the ramp is linear and ends exactly on the target (a table of ones outputs the gain).
+    std::array<double, 512> ones{};
+    ones.fill(1.0);
+    OscillatorBank<double, 512, 8> bank{};
+    bank.set_partial(0, 1.0, 0.0);
+    bank.set_partial_target(0, 2.0, 1.0);
+    bank.start_ramp(100, 1);
+    std::array<double, 150> ramp_output{};
+    bank.process(ones.data(), ramp_output.data(), 70);
+    bank.process(ones.data(), ramp_output.data() + 70, 80);
+    for (size_t sample = 0; sample < ramp_output.size(); ++sample)
+    {
+        assert(std::abs(ramp_output[sample] - std::min(static_cast<double>(sample) / 100.0, 1.0)) < 1e-12);
+    }
+    assert(bank.increment(0) == 2.0);
+
+    using Oscs = ResynthOscs<double, 512, 1024, 16>;
+    const auto render = [](Oscs& oscs, const PeakArr<double, 16>& peaks, const size_t num_peaks, const size_t size)
+    {
+        oscs.tune_oscillators(peaks, num_peaks);
+        std::vector<double> output(size);
+        oscs.process(output.data(), size);
+        return output;
+    };
+    PeakArr<double, 16> peaks{};
+    PeakArr<double, 16> swapped_peaks{};
+    peaks.set(0, 10.3, 200.0);
+    peaks.set(1, 50.7, 60.0);
+    swapped_peaks.set(0, 50.7, 60.0);
+    swapped_peaks.set(1, 10.3, 200.0);
+    // the same peaks in another order have to continue the same oscillators, so the output is the one of a single
+    // frame (once the first ramp faded them in). Assigning by the order (without a ramp) swaps the oscillators and
+    // breaks the phases.
+    Oscs reference_oscs{44100.0};
+    const auto reference = render(reference_oscs, peaks, 2, 1024);
+    for (const size_t ramp : {0, 256})
+    {
+        Oscs oscs{44100.0};
+        oscs.set_retune_ramp(ramp);
+        auto output = render(oscs, peaks, 2, 512);
+        const auto continued = render(oscs, swapped_peaks, 2, 512);
+        output.insert(output.end(), continued.begin(), continued.end());
+        double max_deviation = 0.0;
+        for (size_t sample = ramp; sample < output.size(); ++sample)
+        {
+            max_deviation = std::max(max_deviation, std::abs(output[sample] - reference[sample]));
+        }
+        assert(ramp == 0 ? max_deviation > 1e-3 : max_deviation < 1e-9);
+    }
+
+    // a partial that moves less than max_track_deviation glides, a new one fades in: no step at the frame boundary.
+    Oscs oscs{44100.0};
+    oscs.set_retune_ramp(256);
+    auto output = render(oscs, peaks, 1, 512);
+    PeakArr<double, 16> moved_peaks{};
+    moved_peaks.set(0, 30.0, 100.0);
+    moved_peaks.set(1, 11.2, 400.0);
+    const auto moved = render(oscs, moved_peaks, 2, 512);
+    output.insert(output.end(), moved.begin(), moved.end());
+    // |dx/dn| <= sum of amplitude * 2 pi f / fs, the amplitudes are 2 / N * magnitude.
+    const double max_slope = 2.0 / 1024.0 * two_pi<double> / 1024.0 * (400.0 * 11.2 + 100.0 * 30.0);
+    for (size_t sample = 1; sample < output.size(); ++sample)
+    {
+        assert(std::abs(output[sample] - output[sample - 1]) < 1.05 * max_slope);
+    }
+    std::cout << "Test passed." << std::endl;
+}
+
+/// @note every level must not contain anything above its highest harmonic.
+template <FloatingPt T>
+void check_mip_map_is_band_limited(const OscWaveform osc_waveform, const double tolerance)
+{
+    constexpr size_t wt_size = 512;
+    constexpr size_t deg_two = degree_of_pow_two_value(wt_size);
+    using MipMap = MipMappedWaveTable<T, wt_size>;
+    const MipMap mip_map{osc_waveform};
+    const RealFourierLUT<T, deg_two> real_fourier_lut{};
+    for (size_t level = 0; level < MipMap::num_levels; ++level)
+    {
+        std::array<T, wt_size> level_samples{};
+        std::copy_n(mip_map.level(level), wt_size, level_samples.begin());
+        ComplexArr<T, (wt_size >> 1)> spectrum{};
+        spct_real_fourier_transform<T, deg_two>(level_samples, spectrum, real_fourier_lut);
+        // the fundamental is always there
+        assert(std::abs(spectrum[1]) > 0.1 * wt_size);
+        for (size_t bin = MipMap::max_harmonic(level) + 1; bin < spectrum.size(); ++bin)
+        {
+            assert(std::abs(spectrum[bin]) < tolerance * wt_size);
+        }
+    }
+}
+
+inline void test_mip_mapped_wavetables()
+{
+    using MipMap = MipMappedWaveTable<double, 512>;
+    static_assert(MipMap::num_levels == 9);
+    static_assert(MipMap::max_harmonic(0) == 256 && MipMap::max_harmonic(8) == 1);
+    assert(MipMap::level_for_increment(0.0) == 0);
+    assert(MipMap::level_for_increment(1.0) == 0);
+    assert(MipMap::level_for_increment(1.5) == 1);
+    assert(MipMap::level_for_increment(2.0) == 1);
+    assert(MipMap::level_for_increment(3.0) == 2);
+    assert(MipMap::level_for_increment(256.0) == 8);
+    assert(MipMap::level_for_increment(1000.0) == 8);
+    for (const auto osc_waveform : {OscWaveform::SINE, OscWaveform::TRIANGLE, OscWaveform::SAW, OscWaveform::SQUARE})
+    {
+        check_mip_map_is_band_limited<double>(osc_waveform, 1e-12);
+        check_mip_map_is_band_limited<float>(osc_waveform, 1e-5);
+    }
+    const MipMap sine_mip_map{OscWaveform::SINE};
+    const SineWT<double, 512> sine_wt{};
+    assert(std::abs(sine_mip_map.level(4)[100] - sine_wt[100]) < 1e-15);
+
+    // a square on bin 93 of 1024 has its 7th harmonic above nyquist, the raw table folds it back to bin 373.
+    constexpr size_t num_samples = 1024;
+    constexpr double sampling_freq = 44100.0;
+    const SquareWT<double, 512> raw_square{};
+    const MipMap square_mip_map{OscWaveform::SQUARE};
+    WTOscillator<double, 512> raw_osc{sampling_freq, &raw_square};
+    WTOscillator<double, 512> band_limited_osc{sampling_freq, &square_mip_map};
+    raw_osc.tune(93 * sampling_freq / num_samples);
+    band_limited_osc.tune(93 * sampling_freq / num_samples);
+    std::array<double, num_samples> raw_output{};
+    std::array<double, num_samples> band_limited_output{};
+    for (size_t sample = 0; sample < num_samples; ++sample)
+    {
+        raw_output[sample] = raw_osc.receive_output();
+        band_limited_output[sample] = band_limited_osc.receive_output();
+    }
+    const RealFourierLUT<double, 10> real_fourier_lut{};
+    ComplexArr<double, (num_samples >> 1)> raw_spectrum{};
+    ComplexArr<double, (num_samples >> 1)> band_limited_spectrum{};
+    spct_real_fourier_transform<double, 10>(raw_output, raw_spectrum, real_fourier_lut);
+    spct_real_fourier_transform<double, 10>(band_limited_output, band_limited_spectrum, real_fourier_lut);
+    assert(std::abs(raw_spectrum[373]) > 0.1 * std::abs(raw_spectrum[93]));
+    assert(std::abs(band_limited_spectrum[373]) < 0.01 * std::abs(band_limited_spectrum[93]));
+}
+
+/// @brief Largest deviation of a sine oscillator from std::sin.
+template <size_t WT_SIZE>
+double sine_oscillator_error(const WTInterpolation interpolation)
+{
+    constexpr double sampling_freq = 44100.0;
+    constexpr double freq = 1234.5;
+    WTOscillator<double, WT_SIZE> oscillator{sampling_freq, &SineWT_v<double, WT_SIZE>};
+    oscillator.select_interpolation(interpolation);
+    oscillator.tune(freq);
+    double max_error = 0.0;
+    for (size_t sample = 0; sample < 4096; ++sample)
+    {
+        const double expected = std::sin(two_pi<double> * freq * static_cast<double>(sample) / sampling_freq);
+        max_error = std::max(max_error, std::abs(oscillator.receive_output() - expected));
+    }
+    return max_error;
+}
+
+/// @brief Largest deviation of a bank playing a sine from std::sin (same tuning as sine_oscillator_error).
+template <size_t WT_SIZE>
+double sine_bank_error(const WTInterpolation interpolation)
+{
+    constexpr double sampling_freq = 44100.0;
+    constexpr double freq = 1234.5;
+    OscillatorBank<double, WT_SIZE, 4> bank{};
+    bank.select_interpolation(interpolation);
+    bank.set_partial(0, static_cast<double>(WT_SIZE) * freq / sampling_freq, 1.0);
+    bank.set_active_partials(1);
+    std::array<double, 4096> output{};
+    bank.process(SineWT_v<double, WT_SIZE>.data(), output.data(), output.size());
+    double max_error = 0.0;
+    for (size_t sample = 0; sample < output.size(); ++sample)
+    {
+        const double expected = std::sin(two_pi<double> * freq * static_cast<double>(sample) / sampling_freq);
+        max_error = std::max(max_error, std::abs(output[sample] - expected));
+    }
+    return max_error;
+}
+
+inline void test_wavetable_interpolation()
+{
+    std::cout << "Testing the wavetable interpolation..." << std::endl;
+    // the guard points repeat the entries of the opposite end, in the raw tables as well as in every mip-map level.
+    const auto& sine_wt = SineWT_v<double, 256>;
+    static_assert(SineWT_v<double, 256>.data()[-1] == SineWT_v<double, 256>[255]);
+    assert(sine_wt.data()[256] == sine_wt[0] && sine_wt.data()[257] == sine_wt[1]);
+    using MipMap = MipMappedWaveTable<double, 256>;
+    const MipMap saw_mip_map{OscWaveform::SAW};
+    for (size_t level = 0; level < MipMap::num_levels; ++level)
+    {
+        const double* entries = saw_mip_map.level(level);
+        assert(entries[-1] == entries[255] && entries[256] == entries[0] && entries[257] == entries[1]);
+    }
+
+    // the phase wraps without any drift: 3 cycles in 64 samples repeat exactly.
+    WTOscillator<double, 256> oscillator{64.0, &sine_wt};
+    oscillator.tune(3.0);
+    std::array<double, 64> first_period{};
+    for (auto& value : first_period)
+    {
+        value = oscillator.receive_output();
+    }
+    for (size_t period = 0; period < 100; ++period)
+    {
+        for (const double value : first_period)
+        {
+            assert(oscillator.receive_output() == value);
+        }
+    }
+
+    // the cubic interpolation reaches the quality of a linear one with an eighth of the table.
+    const double linear_small = sine_oscillator_error<64>(WTInterpolation::LINEAR);
+    const double linear_large = sine_oscillator_error<512>(WTInterpolation::LINEAR);
+    const double cubic_small = sine_oscillator_error<64>(WTInterpolation::CUBIC_HERMITE);
+    assert(linear_large < 2e-5 && linear_small > 1e-3);
+    assert(cubic_small < linear_large);
+
+    // the same for the bank, which renders the partials of ResynthOscs.
+    const double bank_linear_small = sine_bank_error<64>(WTInterpolation::LINEAR);
+    const double bank_linear_large = sine_bank_error<512>(WTInterpolation::LINEAR);
+    const double bank_cubic_small = sine_bank_error<64>(WTInterpolation::CUBIC_HERMITE);
+    assert(bank_linear_large < 2e-5 && bank_linear_small > 1e-3);
+    assert(bank_cubic_small < bank_linear_large);
+
+    // the fixed point phases of the bank wrap without drift as well: 3 cycles of 0.75 entries per sample take 1024
+    // samples, so every partial (a register and a half of them) repeats exactly.
+    OscillatorBank<double, 256, 8> bank{};
+    bank.select_interpolation(WTInterpolation::CUBIC_HERMITE);
+    for (size_t partial = 0; partial < 6; ++partial)
+    {
+        bank.set_partial(partial, 0.75 * static_cast<double>(partial + 1), 1.0 / static_cast<double>(partial + 1));
+    }
+    bank.set_active_partials(6);
+    std::array<double, 1024> first_bank_period{};
+    std::array<double, 1024> bank_period{};
+    bank.process(sine_wt.data(), first_bank_period.data(), first_bank_period.size());
+    for (size_t period = 0; period < 50; ++period)
+    {
+        bank.process(sine_wt.data(), bank_period.data(), bank_period.size());
+        assert(bank_period == first_bank_period);
+    }
+    std::cout << "Test passed." << std::endl;
 }
 
-} // namespace LBTS::Spectral
\ No newline at end of file
+} // namespace LBTS::Spectral